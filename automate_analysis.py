@@ -222,6 +222,31 @@ def getSyst(name, signal_type, exe, doSyst):
     return systs
 
 
+# syst_source of every systematic that only changes the event weight, with the name prefix
+# syst_descriptor::parse (include/syst_descriptor.h) reads it from.
+# Keep in sync with weight_sources in include/swiss_army_class.h
+WEIGHT_SOURCES = [
+    ('tau_id_pt', 'tau_id_pt_'),
+    ('tau_id_vse_vvvloose', 'tau_id_vse_vvvloose'),
+    ('mc_cross_trigger', 'mc_cross_trigger'),
+    ('dy_shape', 'dyShape'),
+    ('ttbar_shape', 'ttbarShape'),
+    ('ggh_rivet', 'ggH_Rivet'),
+    ('vbf_rivet', 'VBF_Rivet'),
+    ('tracking', 'tracking_DM'),
+]
+
+
+def is_weight_syst(syst):
+    """Return True for systematics that only change the event weight.
+
+    In single-pass mode these are stored as evtwt_<syst> branches in the nominal tree
+    instead of getting their own directory. The source is found from the start of the
+    name like syst_descriptor does, so both sides classify a name the same way.
+    """
+    return any([syst.startswith(prefix) for source, prefix in WEIGHT_SOURCES])
+
+
 def run_command(cmd, q, parallel=False):
     """Run the provided command and write the output
 
@@ -257,15 +282,31 @@ def listener(q, fname):
             f.flush()
 
 
-def build_processes(processes, callstring, names, signal_type, exe, output_dir, doSyst):
-    """Create output directories and callstrings then add them to the list of processes."""
+def build_processes(processes, callstring, names, signal_type, exe, output_dir, doSyst, single_pass=False):
+    """Create output directories and callstrings then add them to the list of processes.
+
+    With single_pass, each name gets one command that evaluates the nominal case and all
+    systematics in a single pass over the ntuple (--all-systs) instead of one command per systematic.
+    """
     for name in names:
-        for isyst in getSyst(name, signal_type, exe, doSyst):
+        systs = getSyst(name, signal_type, exe, doSyst)
+        for isyst in systs:
             if isyst == "" and not path.exists('Output/trees/{}/NOMINAL'.format(output_dir)):
                 makedirs('Output/trees/{}/NOMINAL'.format(output_dir))
+            if single_pass and is_weight_syst(isyst):
+                continue
             if isyst != "" and not path.exists('Output/trees/{}/SYST_{}'.format(output_dir, isyst)):
                 makedirs('Output/trees/{}/SYST_{}'.format(output_dir, isyst))
 
+        if single_pass:
+            tocall = callstring + ' -n {} --all-systs'.format(name)
+            shifts = [isyst for isyst in systs if isyst != ""]
+            if len(shifts) > 0:
+                tocall += ' -u {}'.format(','.join(shifts))
+            processes.append(tocall)
+            continue
+
+        for isyst in systs:
             tocall = callstring + ' -n {}'.format(name)
             if isyst != "":
                 tocall += ' -u {}'.format(isyst)
@@ -305,6 +346,35 @@ def run_series(output_dir, processes):
         [run_command(command, ifile, False) for command in processes]
 
 
+def analyzer_options(args):
+    """Options passed on to every analyzer job, locally and on condor."""
+    options = ''
+    if args.workers > 1:
+        options += '-j {} '.format(args.workers)
+    if args.sf_tables:
+        options += '--sf-tables {} '.format(args.sf_tables)
+    if args.cache_dir:
+        options += '--cache-dir {} '.format(args.cache_dir)
+    if args.mirror:
+        options += '--mirror {} '.format(args.mirror)
+    if args.ac_stream:
+        options += '--ac-stream '
+    if args.all_branches:
+        options += '--all-branches '
+    if args.schema:
+        options += '--schema {} '.format(args.schema)
+    return options
+
+
+def condor_path_errors(args):
+    """Condor jobs only see the code tarball and /hdfs, so every path has to be in one of them."""
+    errors = []
+    for option, value in [('--sf-tables', args.sf_tables), ('--cache-dir', args.cache_dir), ('--mirror', args.mirror)]:
+        if value and path.isabs(value) and not value.startswith('/hdfs/'):
+            errors.append('{} {} is not available to condor jobs. Use a path inside this directory or on /hdfs'.format(option, value))
+    return errors
+
+
 def main(args):
     """Build all processes and run them."""
     start = time.time()
@@ -312,6 +382,13 @@ def main(args):
     fileList = [ifile for ifile in glob(args.path+'/*') if '.root' in ifile and valid_sample(ifile)]
 
     if args.condor:
+        if args.single_pass:
+            print '\033[93m[WARNING] --single-pass is not supported with --condor. Submitting one job per systematic.\033[0m'
+        errors = condor_path_errors(args)
+        if errors:
+            for error in errors:
+                print '\033[91m[ERROR] {}\033[0m'.format(error)
+            return
         job_map = {}
         for ifile in fileList:
             sample = ifile.split('/')[-1].split(suffix)[0]
@@ -327,9 +404,9 @@ def main(args):
                     else:
                       syst = 'SYST_' + syst
 
-                    command = '{} -p {} -s {} -d ./ --stype {} -n {} -u {} --condor'.format(
+                    command = '{} -p {} -s {} -d ./ --stype {} -n {} -u {} --condor {}'.format(
                             args.exe, tosample, sample, signal_type,
-                            name, syst.replace('SYST_', ''))
+                            name, syst.replace('SYST_', ''), analyzer_options(args))
 
                     file_map[syst].append({
                         'path': tosample,
@@ -347,7 +424,7 @@ def main(args):
             for syst, configs in systs.iteritems():
                 for config in configs:
                     to_submit.append(config)
-        submit_command(args.output_dir, to_submit, False)
+        submit_command(args.output_dir, to_submit, False, args.workers)
     else:
         try:
             makedirs('Output/trees/{}/logs'.format(args.output_dir))
@@ -364,9 +441,10 @@ def main(args):
             # if 'ZL' not in names: continue
             callstring = './{} -p {} -s {} -d {} --stype {} '.format(args.exe,
                                                                      tosample, sample, args.output_dir, signal_type)
+            callstring += analyzer_options(args)
 
             doSyst = True if args.syst and not 'data' in sample.lower() else False
-            processes = build_processes(processes, callstring, names, signal_type, args.exe, args.output_dir, doSyst)
+            processes = build_processes(processes, callstring, names, signal_type, args.exe, args.output_dir, doSyst, args.single_pass)
         pprint(processes, width=150)
 
         if args.parallel:
@@ -388,4 +466,20 @@ if __name__ == "__main__":
     parser.add_argument('--output-dir', required=True, dest='output_dir',
                         help='name of output directory after Output/trees')
     parser.add_argument('--condor', action='store_true', help='submit jobs to condor')
+    parser.add_argument('--single-pass', action='store_true', dest='single_pass',
+                        help='run all systematics for a sample in one pass over the ntuple')
+    parser.add_argument('--workers', '-j', type=int, default=1,
+                        help='number of threads used by each analyzer job')
+    parser.add_argument('--sf-tables', dest='sf_tables', default='',
+                        help='json file of scale factor tables from sf_compiler')
+    parser.add_argument('--cache-dir', dest='cache_dir', default='',
+                        help='directory to cache remote correction files in')
+    parser.add_argument('--mirror', default='',
+                        help='read correction files from this local mirror instead of the network')
+    parser.add_argument('--ac-stream', action='store_true', dest='ac_stream',
+                        help='read AC weights alongside the events instead of loading them all first')
+    parser.add_argument('--all-branches', action='store_true', dest='all_branches',
+                        help='also write the Higgs+jet variables and ME_* values that the datacards don\'t use')
+    parser.add_argument('--schema', default='',
+                        help='output branch preset from configs/output_schema.json (datacard, nn-training, full)')
     main(parser.parse_args())
@@ -0,0 +1,204 @@
+############################################################
+## Script to benchmark the whole chain on synthetic       ##
+## ntuples: analyzers, fake factors, AC reweighting and   ##
+## datacard templates. Everything runs offline from the  ##
+## correction mirror written by generate-ntuples.         ##
+############################################################
+
+import os
+import json
+import time
+import resource
+import subprocess
+from glob import glob
+from os import makedirs, path
+from automate_analysis import getNames, getSyst, is_weight_syst
+
+
+def ensure_dir(dirname):
+    if not path.exists(dirname):
+        makedirs(dirname)
+
+
+def run_timed(cmd, report, stage, events=0):
+    """Run a command and record its wall time and peak RSS.
+
+    The child's own resource usage is read with wait4, so the peak RSS belongs
+    to this command rather than every child started so far.
+    """
+    print '\033[94m[RUNNING] {}\033[0m'.format(cmd)
+    start = time.time()
+    proc = subprocess.Popen(cmd, shell=True)
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.time() - start
+    code = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+    if code != 0:
+        print '\033[91m[ERROR] returned non-zero exit code while running {}\033[0m'.format(cmd)
+
+    result = {
+        'stage': stage,
+        'command': cmd,
+        'exit_code': code,
+        'wall_s': wall,
+        'cpu_s': usage.ru_utime + usage.ru_stime,
+        'peak_rss_kb': usage.ru_maxrss,
+        'events': events,
+        'events_per_s': events / wall if wall > 0 else 0.,
+    }
+    report['commands'].append(result)
+    return code == 0
+
+
+def analyzer_shifts(samples, exe, doSyst):
+    """Return the shifts the analyzers will be run with, so the ntuples have their branches."""
+    shifts = []
+    for sample in samples:
+        names, signal_type = getNames(sample)
+        for name in names:
+            for syst in getSyst(name, signal_type, exe, doSyst and 'data' not in sample):
+                if syst != '' and syst not in shifts:
+                    shifts.append(syst)
+    return shifts
+
+
+def run_analyzers(args, channel, ntuple_dir, mirror, report):
+    """Run the analyzer on every sample and return the output directory."""
+    exe = './bin/analyze{}_{}'.format(args.year, channel)
+    output_dir = 'benchmark_{}{}'.format(channel, args.year)
+    ensure_dir('Output/trees/{}/logs'.format(output_dir))
+    ensure_dir('Output/trees/{}/NOMINAL'.format(output_dir))
+
+    for sample in args.samples:
+        names, signal_type = getNames(sample)
+        for name in names:
+            systs = getSyst(name, signal_type, exe, args.syst and 'data' not in sample)
+            for syst in systs:
+                if syst != '' and not is_weight_syst(syst):
+                    ensure_dir('Output/trees/{}/SYST_{}'.format(output_dir, syst))
+
+            command = '{} -p {}/ -s {} -d {} --stype {} -n {} -j {} --mirror {}'.format(
+                exe, ntuple_dir, sample, output_dir, signal_type, name, args.workers, mirror)
+            shifts = [syst for syst in systs if syst != '']
+            if len(shifts) > 0:
+                command += ' --all-systs -u {}'.format(','.join(shifts))
+            run_timed(command, report, 'analyzer_{}'.format(channel), args.events)
+
+    return 'Output/trees/{}'.format(output_dir)
+
+
+def run_post_processing(args, channel, tree_dir, out_dir, report):
+    """Merge the analyzer outputs and run create-fakes, ac-reweight and dc_producer on them."""
+    nominal_dir = '{}/{}/nominal'.format(out_dir, channel)
+    fakes_dir = '{}/{}/fakes'.format(out_dir, channel)
+    ac_dir = '{}/{}/ac_reweighted'.format(out_dir, channel)
+    for dirname in [nominal_dir, fakes_dir, ac_dir]:
+        ensure_dir(dirname)
+
+    # one file per process for the datacards, and everything together for the fake factors
+    outputs = glob('{}/NOMINAL/*_output.root'.format(tree_dir))
+    merged = {}
+    for sample in args.samples:
+        names, _ = getNames(sample)
+        for name in names:
+            files = [ifile for ifile in outputs if path.basename(ifile).startswith('{}_{}_'.format(sample, name))]
+            if len(files) > 0:
+                merged.setdefault(name, []).extend(files)
+    for name, files in merged.iteritems():
+        run_timed('hadd -f {}/{}.root {}'.format(nominal_dir, name, ' '.join(files)), report, 'hadd_{}'.format(channel))
+    run_timed('hadd -f {}/pre_jetFakes.root {}'.format(fakes_dir, ' '.join(outputs)), report, 'hadd_{}'.format(channel))
+
+    run_timed('./bin/create-fakes -i {} -p {}/fake_factors/fake_fractions_{}.root -f {}/fake_factors/ -c {}{}'.format(
+        fakes_dir, args.output, channel, args.output, channel, ' -s' if args.syst else ''),
+        report, 'create_fakes_{}'.format(channel))
+    if path.exists('{}/jetFakes.root'.format(fakes_dir)):
+        os.rename('{}/jetFakes.root'.format(fakes_dir), '{}/jetFakes.root'.format(nominal_dir))
+
+    for ifile in outputs:
+        if 'JHU' in ifile and 'ggh125' in ifile:
+            run_timed('./bin/ac-reweight -n {} -t {}_tree -o {}'.format(ifile, channel, ac_dir), report,
+                      'ac_reweight_{}'.format(channel))
+
+    run_timed('./bin/dc_producer -d {}/{} -l {} -c {} -y {}{}'.format(
+        out_dir, channel, channel, args.binning, args.year, ' -s' if args.syst else ''),
+        report, 'dc_producer_{}'.format(channel))
+
+
+def collect_sidecars(tree_dir):
+    """Read the job_timer sidecars written next to each analyzer output."""
+    sidecars = {}
+    for ifile in glob('{}/*/*_output_timing.json'.format(tree_dir)):
+        with open(ifile) as timing_file:
+            sidecars[path.basename(ifile)] = json.load(timing_file)
+    return sidecars
+
+
+def summarize(report):
+    """Print the time spent in each stage."""
+    stages = {}
+    for command in report['commands']:
+        stage = stages.setdefault(command['stage'], {'wall_s': 0., 'events': 0, 'peak_rss_kb': 0, 'failed': 0})
+        stage['wall_s'] += command['wall_s']
+        stage['events'] += command['events']
+        stage['peak_rss_kb'] = max(stage['peak_rss_kb'], command['peak_rss_kb'])
+        stage['failed'] += command['exit_code'] != 0
+    for stage in stages.itervalues():
+        stage['events_per_s'] = stage['events'] / stage['wall_s'] if stage['wall_s'] > 0 else 0.
+    report['stages'] = stages
+
+    print '\n{:<24} {:>10} {:>12} {:>14} {:>8}'.format('stage', 'wall [s]', 'events/s', 'peak RSS [MB]', 'failed')
+    for name in sorted(stages.keys()):
+        stage = stages[name]
+        print '{:<24} {:>10.2f} {:>12.0f} {:>14.1f} {:>8}'.format(
+            name, stage['wall_s'], stage['events_per_s'], stage['peak_rss_kb'] / 1024., stage['failed'])
+    print 'Total wall time: {:.2f} s'.format(report['wall_s'])
+
+
+def main(args):
+    start = time.time()
+    args.samples = args.samples.split(',')
+    args.channels = args.channels.split(',')
+    report = {'year': args.year, 'events': args.events, 'workers': args.workers, 'syst': args.syst,
+              'samples': args.samples, 'commands': [], 'sidecars': {}}
+    ensure_dir(args.output)
+
+    # the ntuples need a branch for every shift any analyzer will run
+    shifts = []
+    for channel in args.channels:
+        exe = './bin/analyze{}_{}'.format(args.year, channel)
+        shifts += [shift for shift in analyzer_shifts(args.samples, exe, args.syst) if shift not in shifts]
+    command = './bin/generate-ntuples -o {} -y {} -n {} -l {} -s {} --seed {}'.format(
+        args.output, args.year, args.events, ','.join(args.channels), ','.join(args.samples), args.seed)
+    if len(shifts) > 0:
+        command += ' -u {}'.format(','.join(shifts))
+    if not run_timed(command, report, 'generate_ntuples'):
+        return
+
+    mirror = path.abspath('{}/mirror'.format(args.output))
+    for channel in args.channels:
+        ntuple_dir = '{}/ntuples/{}/{}'.format(args.output, args.year, channel)
+        tree_dir = run_analyzers(args, channel, ntuple_dir, mirror, report)
+        run_post_processing(args, channel, tree_dir, args.output, report)
+        report['sidecars'][channel] = collect_sidecars(tree_dir)
+
+    report['wall_s'] = time.time() - start
+    report['children_peak_rss_kb'] = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    summarize(report)
+    with open('{}/benchmark_report.json'.format(args.output), 'w') as report_file:
+        json.dump(report, report_file, indent=4)
+    print 'Report written to {}/benchmark_report.json'.format(args.output)
+
+
+if __name__ == "__main__":
+    from argparse import ArgumentParser
+    parser = ArgumentParser()
+    parser.add_argument('--output', '-o', default='benchmark', help='directory for the ntuples, mirror and report')
+    parser.add_argument('--year', '-y', default='2018', help='year to benchmark')
+    parser.add_argument('--events', '-n', type=int, default=10000, help='number of events per sample')
+    parser.add_argument('--channels', '-l', default='mt,et', help='comma-separated list of channels')
+    parser.add_argument('--samples', '-s', default='DYJets,TT,WJets,VV,data,embed,ggh125_JHU_a1-prod,vbf125_powheg',
+                        help='comma-separated list of samples to generate')
+    parser.add_argument('--syst', action='store_true', help='run all systematics in a single pass')
+    parser.add_argument('--workers', '-j', type=int, default=1, help='number of threads used by each analyzer job')
+    parser.add_argument('--binning', '-c', default='baseline', help='binning scenario for dc_producer')
+    parser.add_argument('--seed', type=int, default=12345, help='seed for the ntuple generator')
+    main(parser.parse_args())
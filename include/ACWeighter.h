@@ -5,9 +5,11 @@
 
 #include <algorithm>
 #include <iostream>
-#include <map>
+#include <memory>
 #include <string>
 #include <vector>
+#include "./ac_weight_store.h"
+#include "./correction_cache.h"
 #include "TFile.h"
 #include "TTree.h"
 
@@ -21,6 +23,16 @@ using std::string;
 // a2 - SM like heavy mass anomalous Higgs   //
 // L1, L1Zg - something like a2, not sure    //
 // int - interference term (f05)             //
+//                                           //
+// Weights are kept in an ac_weight_store.   //
+// With a correction cache, the store is     //
+// saved in <cache>/ac_weights and mapped    //
+// by later jobs on the same weight file.    //
+//                                           //
+// In streaming mode only an index of the    //
+// weight tree is kept and each worker reads //
+// the weights of its events with a cursor,  //
+// so memory doesn't grow with the sample.   //
 ///////////////////////////////////////////////
 class ACWeighter {
  public:
@@ -28,13 +40,11 @@ class ACWeighter {
     ~ACWeighter();
 
     void fillWeightMap();
-    std::vector<double> getWeights(Long64_t);
+    void openWeightStream(int);
+    ac_weight_view getWeights(Long64_t, std::size_t worker = 0);
 
  private:
     bool notSignal;
-    Long64_t eventID;
-    TTree *weightTree;
-    TFile *weightTreeFile;
     string ac_prefix;
     string fileName = "root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_AC_weights/";
     string signal_type;
@@ -42,10 +52,14 @@ class ACWeighter {
     int foundEvents, crapEvents;  // hehe
     bool isVBFAC, isggHAC, isWHAC, isZHAC;
     std::vector<string> weightNames;
-    std::map<Long64_t, std::vector<double>> acWeights;
-
-    // variables with weights (for ggH only a1 (SM), a3 (CP-odd), and maxmix (int) is used
-    Double_t wt_a1, wt_a2, wt_a3, wt_L1, wt_L1Zg, wt_a2int, wt_a3int, wt_L1int, wt_L1Zgint;
+    std::vector<string> weightBranches;  // branches read from the weight tree
+    std::vector<int> weightSlots;        // where each branch goes in the 30 weights
+    ac_weight_store acWeights;  // the weights, or only the index when streaming
+    std::vector<std::unique_ptr<ac_weight_cursor>> cursors;  // one per worker when streaming
+
+    bool isAC() const { return (isVBFAC || isggHAC || isWHAC || isZHAC) && !notSignal; }
+    bool loadStore(std::vector<string>, std::vector<int>, string);
+    string storeName(string, string) const;
 };
 
 ACWeighter::ACWeighter(string original, string sample, string _signal_type, string year)
@@ -128,107 +142,92 @@ ACWeighter::ACWeighter(string original, string sample, string _signal_type, stri
         }
     }
 
-    // set the branches
-    if (!notSignal) {
-        weightTreeFile = TFile::Open(fileName.c_str());
-        weightTree = reinterpret_cast<TTree *>(weightTreeFile->Get("weights"));
-
-        weightTree->SetBranchAddress("eventID", &eventID);
-        weightTree->SetBranchAddress("wt_a1", &wt_a1);
-        weightTree->SetBranchAddress("wt_a3", &wt_a3);
-        weightTree->SetBranchAddress("wt_a3int", &wt_a3int);
-        if (!isggHAC) {
-            weightTree->SetBranchAddress("wt_L1", &wt_L1);
-            weightTree->SetBranchAddress("wt_L1Zg", &wt_L1Zg);
-            weightTree->SetBranchAddress("wt_a2", &wt_a2);
-            weightTree->SetBranchAddress("wt_a2int", &wt_a2int);
-            weightTree->SetBranchAddress("wt_L1int", &wt_L1int);
-            weightTree->SetBranchAddress("wt_L1Zgint", &wt_L1Zgint);
+    // only store the weights this sample fills. The 30 weights are
+    // 9 for VBF, 3 for ggH, 9 for WH and 9 for ZH
+    if (isggHAC) {
+        weightBranches = {"wt_a1", "wt_a3", "wt_a3int"};
+        weightSlots = {9, 10, 11};
+    } else if (isVBFAC || isWHAC || isZHAC) {
+        weightBranches = {"wt_a1", "wt_a2", "wt_a3", "wt_L1", "wt_L1Zg", "wt_a2int", "wt_a3int", "wt_L1int", "wt_L1Zgint"};
+        int offset = isVBFAC ? 0 : (isWHAC ? 12 : 21);
+        for (auto i = 0; i < 9; i++) {
+            weightSlots.push_back(offset + i);
         }
     }
 }
 
 void ACWeighter::fillWeightMap() {
-    if ((isVBFAC || isggHAC || isWHAC || isZHAC) && !notSignal) {
-        for (auto i = 0; i < weightTree->GetEntries(); ++i) {
-            weightTree->GetEntry(i);
-            std::vector<double> w;
-            if (isVBFAC) {
-                w.push_back(wt_a1);
-                w.push_back(wt_a2);
-                w.push_back(wt_a3);
-                w.push_back(wt_L1);
-                w.push_back(wt_L1Zg);
-                w.push_back(wt_a2int);
-                w.push_back(wt_a3int);
-                w.push_back(wt_L1int);
-                w.push_back(wt_L1Zgint);
-            } else {
-                for (auto j = 0; j != 9; ++j) {
-                    w.push_back(0);
-                }
-            }
-
-            if (isggHAC) {
-                w.push_back(wt_a1);
-                w.push_back(wt_a3);
-                w.push_back(wt_a3int);
-            } else {
-                for (auto j = 0; j != 3; ++j) {
-                    w.push_back(0);
-                }
-            }
-
-            if (isWHAC) {
-                w.push_back(wt_a1);
-                w.push_back(wt_a2);
-                w.push_back(wt_a3);
-                w.push_back(wt_L1);
-                w.push_back(wt_L1Zg);
-                w.push_back(wt_a2int);
-                w.push_back(wt_a3int);
-                w.push_back(wt_L1int);
-                w.push_back(wt_L1Zgint);
-            } else {
-                for (auto j = 0; j != 9; ++j) {
-                    w.push_back(0);
-                }
-            }
-
-            if (isZHAC) {
-                w.push_back(wt_a1);
-                w.push_back(wt_a2);
-                w.push_back(wt_a3);
-                w.push_back(wt_L1);
-                w.push_back(wt_L1Zg);
-                w.push_back(wt_a2int);
-                w.push_back(wt_a3int);
-                w.push_back(wt_L1int);
-                w.push_back(wt_L1Zgint);
-            } else {
-                for (auto j = 0; j != 9; ++j) {
-                    w.push_back(0);
-                }
-            }
-
-            // total size of weights is 9 + 3 + 9 + 9 = 30 weights!
-            acWeights[eventID] = w;
-        }  // map of weights is complete
+    if (isAC()) {
+        loadStore(weightBranches, weightSlots, ".acw");
     }
 }
 
-std::vector<double> ACWeighter::getWeights(Long64_t currentEventID) {
-    std::vector<double> weights(30, 0);
-    auto it = acWeights.find(currentEventID);
-    if (it != acWeights.end()) {
-        weights = it->second;
-    } else if (notSignal) {
-      return weights;
-    } else {
+// only index the weight tree. Each worker reads its events' weights as it needs them
+void ACWeighter::openWeightStream(int nworkers) {
+    if (!isAC()) {
+        return;
+    }
+    loadStore({}, {}, ".acx");
+    auto weightFile = correction_file(fileName);
+    for (auto i = 0; i < std::max(nworkers, 1); i++) {
+        cursors.push_back(std::unique_ptr<ac_weight_cursor>(new ac_weight_cursor(weightFile, &acWeights, weightBranches, weightSlots)));
+    }
+}
+
+// map a saved store or build it from the weight tree (and save it if there is a correction cache)
+bool ACWeighter::loadStore(std::vector<string> branches, std::vector<int> slots, string extension) {
+    auto weightFile = correction_file(fileName);
+    auto store = storeName(weightFile, extension);
+    if (!store.empty() && acWeights.load(store, slots)) {
+        return true;
+    }
+
+    auto weightTreeFile = TFile::Open(weightFile.c_str());
+    auto weightTree = reinterpret_cast<TTree *>(weightTreeFile->Get("weights"));
+    auto filled = acWeights.fill(weightTree, branches, slots);
+    weightTreeFile->Close();
+
+    if (filled && !store.empty() && cache_utils::make_dirs(correction_cache::get().getCacheDir() + "/ac_weights") && !acWeights.save(store)) {
+        std::cerr << "Unable to save AC weights to " << store << std::endl;
+    }
+    return filled;
+}
+
+// get the AC weights of an event. The view points into the store or the worker's
+// cursor, so it is only valid until the next call for the same worker. worker is
+// only used in streaming mode
+ac_weight_view ACWeighter::getWeights(Long64_t currentEventID, std::size_t worker) {
+    if (notSignal) {
+        return ac_weight_view();
+    }
+
+    if (!cursors.empty()) {
+        auto &cursor = cursors.at(worker);
+        if (!cursor->seek(currentEventID)) {
+          std::cerr << "Unable to find event " << currentEventID << std::endl;
+          throw;
+        }
+        return cursor->view();
+    }
+
+    auto row = acWeights.find(currentEventID);
+    if (row < 0) {
       std::cerr << "Unable to find event " << currentEventID << std::endl;
       throw;
     }
-    return weights;
+    return acWeights.view(row);
+}
+
+// saved store for a local weight file, or an empty string if there is no correction cache.
+// The name depends on the file's size and modification time, so a changed file is read again
+string ACWeighter::storeName(string weightFile, string extension) const {
+    auto cache_dir = correction_cache::get().getCacheDir();
+    struct stat info;
+    if (cache_dir.empty() || cache_utils::is_remote(weightFile) || stat(weightFile.c_str(), &info) != 0) {
+        return "";
+    }
+    auto key = weightFile + ":" + std::to_string(info.st_size) + ":" + std::to_string(info.st_mtime);
+    return cache_dir + "/ac_weights/" + cache_utils::to_hex(cache_utils::hash(key.data(), key.size())) + extension;
 }
 
 ACWeighter::~ACWeighter() {}
@@ -4,77 +4,178 @@
 #define INCLUDE_APPLYFF_H_
 
 #include <algorithm>
+#include <array>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "TF1.h"
 #include "TFile.h"
+#include "./ff_table.h"
+
+/////////////////////////////////////////////////////
+// Purpose: To list the fake factor systematics in //
+// the order get_all_ff writes their weights: the  //
+// nominal weight first, then the up and down      //
+// weights of each systematic.                     //
+/////////////////////////////////////////////////////
+namespace ff_systematics {
+enum : std::size_t {
+    ff_qcd_0jet_unc1,
+    ff_qcd_0jet_unc2,
+    ff_qcd_1jet_unc1,
+    ff_qcd_1jet_unc2,
+    ff_qcd_2jet_unc1,
+    ff_qcd_2jet_unc2,
+    ff_w_0jet_unc1,
+    ff_w_0jet_unc2,
+    ff_w_1jet_unc1,
+    ff_w_1jet_unc2,
+    ff_w_2jet_unc1,
+    ff_w_2jet_unc2,
+    ff_tt_0jet_unc1,
+    ff_tt_0jet_unc2,
+    mtclosure_w_unc1,
+    mtclosure_w_unc2,
+    lptclosure_xtrg_qcd,
+    lptclosure_xtrg_w,
+    lptclosure_xtrg_tt,
+    lptclosure_qcd,
+    lptclosure_w,
+    lptclosure_tt,
+    osssclosure_qcd,
+    size
+};
+
+const std::array<std::string, size> names = {
+    "ff_qcd_0jet_unc1", "ff_qcd_0jet_unc2",    "ff_qcd_1jet_unc1",  "ff_qcd_1jet_unc2",   "ff_qcd_2jet_unc1",
+    "ff_qcd_2jet_unc2", "ff_w_0jet_unc1",      "ff_w_0jet_unc2",    "ff_w_1jet_unc1",     "ff_w_1jet_unc2",
+    "ff_w_2jet_unc1",   "ff_w_2jet_unc2",      "ff_tt_0jet_unc1",   "ff_tt_0jet_unc2",    "mtclosure_w_unc1",
+    "mtclosure_w_unc2", "lptclosure_xtrg_qcd", "lptclosure_xtrg_w", "lptclosure_xtrg_tt", "lptclosure_qcd",
+    "lptclosure_w",     "lptclosure_tt",       "osssclosure_qcd"};
+
+// index of the up and down weights of a systematic
+inline std::size_t up(std::size_t syst) { return 1 + 2 * syst; }
+inline std::size_t down(std::size_t syst) { return 2 + 2 * syst; }
+
+// a systematic and its direction, resolved from their names once
+struct shift {
+    std::size_t syst;  // size for the nominal
+    bool up;
+};
+
+const shift nominal = {size, true};
+
+// unknown names give the nominal, like they did in get_ff
+inline shift resolve(std::string name, std::string dir) {
+    auto found = std::find(names.begin(), names.end(), name);
+    return shift{static_cast<std::size_t>(found - names.begin()), dir == "up"};
+}
+}  // namespace ff_systematics
+
+typedef std::array<Float_t, 11> ff_kinematics;  // same order as the kin of get_ff
+typedef std::array<Float_t, 1 + 2 * ff_systematics::size> ff_weights;
+
+// the inputs of a block of events stored column by column, e.g. read from one TTree cluster
+struct ff_columns {
+    std::vector<Float_t> pt, mt, vis_mass, lpt, dr, met, njets, xtrg, frac_tt, frac_qcd, frac_w;
+
+    std::size_t size() const { return pt.size(); }
+    void resize(std::size_t n) {
+        for (auto column : {&pt, &mt, &vis_mass, &lpt, &dr, &met, &njets, &xtrg, &frac_tt, &frac_qcd, &frac_w}) {
+            column->resize(n);
+        }
+    }
+    ff_kinematics row(std::size_t i) const {
+        return ff_kinematics{pt[i], mt[i], vis_mass[i], lpt[i], dr[i], met[i], njets[i], xtrg[i], frac_tt[i], frac_qcd[i], frac_w[i]};
+    }
+};
 
 class apply_ff {
    private:
     std::string channel, year;
+    bool tabulated;  // false to evaluate every TF1 directly
 
     // input files
     TFile *raw_file, *vis_mass_file, *osss_file, *tpt_file;
 
-    // TF1 from files
-    TF1 *ff_qcd_0jet, *ff_qcd_0jet_unc1_up, *ff_qcd_0jet_unc1_down, *ff_qcd_0jet_unc2_up, *ff_qcd_0jet_unc2_down, *ff_qcd_1jet, *ff_qcd_1jet_unc1_up,
+    // every table made by tabulate, the pointers below point into it
+    std::vector<std::unique_ptr<ff_table>> tables;
+
+    // TF1 from files, tabulated
+    ff_table *ff_qcd_0jet, *ff_qcd_0jet_unc1_up, *ff_qcd_0jet_unc1_down, *ff_qcd_0jet_unc2_up, *ff_qcd_0jet_unc2_down, *ff_qcd_1jet, *ff_qcd_1jet_unc1_up,
         *ff_qcd_1jet_unc1_down, *ff_qcd_1jet_unc2_up, *ff_qcd_1jet_unc2_down, *ff_qcd_2jet, *ff_qcd_2jet_unc1_up, *ff_qcd_2jet_unc1_down,
         *ff_qcd_2jet_unc2_up, *ff_qcd_2jet_unc2_down, *ff_w_0jet, *ff_w_0jet_unc1_up, *ff_w_0jet_unc1_down, *ff_w_0jet_unc2_up, *ff_w_0jet_unc2_down,
         *ff_w_1jet, *ff_w_1jet_unc1_up, *ff_w_1jet_unc1_down, *ff_w_1jet_unc2_up, *ff_w_1jet_unc2_down, *ff_w_2jet, *ff_w_2jet_unc1_up,
         *ff_w_2jet_unc1_down, *ff_w_2jet_unc2_up, *ff_w_2jet_unc2_down, *ff_tt_0jet, *ff_tt_0jet_unc1_up, *ff_tt_0jet_unc1_down, *ff_tt_0jet_unc2_up,
         *ff_tt_0jet_unc2_down;
 
-    TF1 *mVisClosure_QCD_0jet, *mVisClosure_QCD_1jet, *mVisClosure_QCD_2jet, *mVisClosure_W_0jet, *mVisClosure_W_1jet, *mVisClosure_W_2jet,
+    ff_table *mVisClosure_QCD_0jet, *mVisClosure_QCD_1jet, *mVisClosure_QCD_2jet, *mVisClosure_W_0jet, *mVisClosure_W_1jet, *mVisClosure_W_2jet,
         *mVisClosure_TT;
 
-    TF1 *lptClosure_W_taupt30to50, *lptClosure_W_taupt50to70, *lptClosure_W_tauptgt70, *lptClosure_QCD_taupt30to50, *lptClosure_QCD_taupt50to70,
+    ff_table *lptClosure_W_taupt30to50, *lptClosure_W_taupt50to70, *lptClosure_W_tauptgt70, *lptClosure_QCD_taupt30to50, *lptClosure_QCD_taupt50to70,
         *lptClosure_QCD_tauptgt70, *lptClosure_TT_taupt30to50, *lptClosure_TT_taupt50to70, *lptClosure_TT_tauptgt70, *lptClosure_W_xtrg_taupt30to50,
         *lptClosure_W_xtrg_taupt50to70, *lptClosure_W_xtrg_tauptgt70, *lptClosure_QCD_xtrg_taupt30to50, *lptClosure_QCD_xtrg_taupt50to70,
         *lptClosure_QCD_xtrg_tauptgt70, *lptClosure_TT_xtrg_taupt30to50, *lptClosure_TT_xtrg_taupt50to70, *lptClosure_TT_xtrg_tauptgt70;
 
-    TF1 *lptClosure_W_taupt30to40, *lptClosure_W_taupt40to50, *lptClosure_W_tauptgt50, *lptClosure_QCD_taupt30to40, *lptClosure_QCD_taupt40to50,
+    ff_table *lptClosure_W_taupt30to40, *lptClosure_W_taupt40to50, *lptClosure_W_tauptgt50, *lptClosure_QCD_taupt30to40, *lptClosure_QCD_taupt40to50,
         *lptClosure_QCD_tauptgt50, *lptClosure_TT_taupt30to40, *lptClosure_TT_taupt40to50, *lptClosure_TT_tauptgt50, *lptClosure_W_xtrg_taupt30to40,
         *lptClosure_W_xtrg_taupt40to50, *lptClosure_W_xtrg_tauptgt50, *lptClosure_QCD_xtrg_taupt30to40, *lptClosure_QCD_xtrg_taupt40to50,
         *lptClosure_QCD_xtrg_tauptgt50, *lptClosure_TT_xtrg_taupt30to40, *lptClosure_TT_xtrg_taupt40to50, *lptClosure_TT_xtrg_tauptgt50;
 
-    TF1 *OSSSClosure_QCD, *MTClosure_W, *MTClosure_W_unc1_up, *MTClosure_W_unc1_down, *MTClosure_W_unc2_up, *MTClosure_W_unc2_down,
+    ff_table *OSSSClosure_QCD, *MTClosure_W, *MTClosure_W_unc1_up, *MTClosure_W_unc1_down, *MTClosure_W_unc2_up, *MTClosure_W_unc2_down,
         *tauPtCorrection_qcd, *tauPtCorrection_w;
 
-    Float_t raw_qcd(Float_t, Float_t, std::string, std::string);
-    Float_t raw_w(Float_t, Float_t, std::string, std::string);
-    Float_t raw_tt(Float_t, std::string, std::string);
-
-    Float_t lpt_cls_corr_w(Float_t, Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_tt(Float_t, Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_qcd(Float_t, Float_t, Float_t, std::string, std::string);
-
-    Float_t lpt_cls_corr_xtrg_mt_w(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_xtrg_mt_qcd(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_xtrg_mt_tt(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_mt_w(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_mt_qcd(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_mt_tt(Float_t, Float_t, std::string, std::string);
-
-    Float_t lpt_cls_corr_xtrg_et_w(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_xtrg_et_qcd(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_xtrg_et_tt(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_et_w(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_et_qcd(Float_t, Float_t, std::string, std::string);
-    Float_t lpt_cls_corr_et_tt(Float_t, Float_t, std::string, std::string);
-
-    Float_t mt_closure_corr(Float_t, std::string, std::string);
-    Float_t osss_closure_corr(Float_t, std::string, std::string);
+    // the same functions indexed by variation (nominal, unc1_up, unc1_down, unc2_up, unc2_down),
+    // process, cross trigger and tau pT bin, so a systematic picks its function by index
+    std::array<std::array<ff_table *, 5>, 3> raw_qcd_tables, raw_w_tables;  // by njets
+    std::array<ff_table *, 5> raw_tt_tables, mt_closure_tables;
+    std::array<std::array<std::array<ff_table *, 3>, 3>, 2> lpt_closure_tables;  // [xtrg][qcd, w, tt][tau pT bin]
+    std::array<Float_t, 2> lpt_closure_edges;                                    // tau pT between the bins
+
+    // the nominal raw fake factors and closures of an event. The lepton pT and OS/SS
+    // closures are kept in double precision so they can be scaled like in get_ff
+    struct ff_components {
+        Float_t eff_pt, eff_lpt, raw_qcd, raw_w, raw_tt, mt_w, ff_qcd, ff_w, ff_tt;
+        double lpt_qcd, lpt_w, lpt_tt, osss_qcd;
+        std::size_t njets, xtrg;
+        bool in_lpt_bin;
+    };
+
+    // every fake factor is built in the same order as in get_ff to give the same result
+    static Float_t make_qcd(Float_t raw, Float_t lpt, Float_t osss) { return raw * lpt * osss; }
+    static Float_t make_w(Float_t raw, Float_t lpt, Float_t mt) { return raw * lpt * mt; }
+    static Float_t make_tt(Float_t raw, Float_t lpt) { return raw * lpt; }
+
+    ff_table *tabulate(TFile *, std::string, double = 0.);
+    ff_components nominal_components(const ff_kinematics &);
+
+    enum process : std::size_t { qcd, w, tt };  // same order as the lptclosure systematics
+    static std::size_t variation(ff_systematics::shift, std::size_t);
+    int lpt_closure_bin(Float_t);
+
+    Float_t raw_qcd(Float_t, std::size_t, ff_systematics::shift);
+    Float_t raw_w(Float_t, std::size_t, ff_systematics::shift);
+    Float_t raw_tt(Float_t, ff_systematics::shift);
+    Float_t lpt_cls_corr(process, Float_t, Float_t, std::size_t, ff_systematics::shift);
+    Float_t mt_closure_corr(Float_t, ff_systematics::shift);
+    Float_t osss_closure_corr(Float_t, ff_systematics::shift);
 
    public:
-    apply_ff(std::string, std::string);
+    apply_ff(std::string, std::string, bool = true);
     ~apply_ff() {}
 
     Float_t get_ff(std::vector<Float_t>, std::string, std::string);
+    Float_t get_ff(const ff_kinematics &, ff_systematics::shift = ff_systematics::nominal);
+    void get_all_ff(const ff_kinematics &, ff_weights &);
+
+    // batch versions for a block of events, writing one weight (or ff_weights) per event
+    void get_ff(const ff_columns &, Float_t *);
+    void get_all_ff(const ff_columns &, ff_weights *);
 };
 
-apply_ff::apply_ff(std::string path, std::string _channel) : channel(_channel) {
+apply_ff::apply_ff(std::string path, std::string _channel, bool _tabulated) : channel(_channel), tabulated(_tabulated) {
     raw_file = TFile::Open((path + "uncorrected_fakefactors_" + channel + ".root").c_str());
     vis_mass_file = TFile::Open((path + "FF_corrections_1.root").c_str());
     osss_file = TFile::Open((path + "FF_QCDcorrectionOSSS.root").c_str());
@@ -85,508 +186,331 @@ apply_ff::apply_ff(std::string path, std::string _channel) : channel(_channel) {
         std::cerr << "cannot open input FF files" << std::endl;
     }
 
-    // read all TF1's
-    ff_qcd_0jet = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_0jet").c_str()));
-    ff_qcd_0jet_unc1_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_0jet_unc1_up").c_str()));
-    ff_qcd_0jet_unc1_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_0jet_unc1_down").c_str()));
-    ff_qcd_0jet_unc2_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_0jet_unc2_up").c_str()));
-    ff_qcd_0jet_unc2_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_0jet_unc2_down").c_str()));
-
-    ff_qcd_1jet = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_1jet").c_str()));
-    ff_qcd_1jet_unc1_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_1jet_unc1_up").c_str()));
-    ff_qcd_1jet_unc1_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_1jet_unc1_down").c_str()));
-    ff_qcd_1jet_unc2_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_1jet_unc2_up").c_str()));
-    ff_qcd_1jet_unc2_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_1jet_unc2_down").c_str()));
-
-    ff_qcd_2jet = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_2jet").c_str()));
-    ff_qcd_2jet_unc1_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_2jet_unc1_up").c_str()));
-    ff_qcd_2jet_unc1_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_2jet_unc1_down").c_str()));
-    ff_qcd_2jet_unc2_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_2jet_unc2_up").c_str()));
-    ff_qcd_2jet_unc2_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_qcd_2jet_unc2_down").c_str()));
-
-    ff_w_0jet = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_0jet").c_str()));
-    ff_w_0jet_unc1_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_0jet_unc1_up").c_str()));
-    ff_w_0jet_unc1_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_0jet_unc1_down").c_str()));
-    ff_w_0jet_unc2_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_0jet_unc2_up").c_str()));
-    ff_w_0jet_unc2_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_0jet_unc2_down").c_str()));
-
-    ff_w_1jet = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_1jet").c_str()));
-    ff_w_1jet_unc1_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_1jet_unc1_up").c_str()));
-    ff_w_1jet_unc1_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_1jet_unc1_down").c_str()));
-    ff_w_1jet_unc2_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_1jet_unc2_up").c_str()));
-    ff_w_1jet_unc2_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_1jet_unc2_down").c_str()));
-
-    ff_w_2jet = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_2jet").c_str()));
-    ff_w_2jet_unc1_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_2jet_unc1_up").c_str()));
-    ff_w_2jet_unc1_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_2jet_unc1_down").c_str()));
-    ff_w_2jet_unc2_up = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_2jet_unc2_up").c_str()));
-    ff_w_2jet_unc2_down = reinterpret_cast<TF1 *>(raw_file->Get(("rawFF_" + channel + "_w_2jet_unc2_down").c_str()));
-
-    ff_tt_0jet = reinterpret_cast<TF1 *>(raw_file->Get(("mc_rawFF_" + channel + "_tt").c_str()));
-    ff_tt_0jet_unc1_up = reinterpret_cast<TF1 *>(raw_file->Get(("mc_rawFF_" + channel + "_tt_unc1_up").c_str()));
-    ff_tt_0jet_unc1_down = reinterpret_cast<TF1 *>(raw_file->Get(("mc_rawFF_" + channel + "_tt_unc1_down").c_str()));
-    ff_tt_0jet_unc2_up = reinterpret_cast<TF1 *>(raw_file->Get(("mc_rawFF_" + channel + "_tt_unc2_up").c_str()));
-    ff_tt_0jet_unc2_down = reinterpret_cast<TF1 *>(raw_file->Get(("mc_rawFF_" + channel + "_tt_unc2_down").c_str()));
-
-    mVisClosure_QCD_0jet = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_mvis_" + channel + "_0jet_qcd").c_str()));
-    mVisClosure_QCD_1jet = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_mvis_" + channel + "_1jet_qcd").c_str()));
-    mVisClosure_QCD_2jet = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_mvis_" + channel + "_2jet_qcd").c_str()));
-    mVisClosure_W_0jet = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_mvis_" + channel + "_0jet_w").c_str()));
-    mVisClosure_W_1jet = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_mvis_" + channel + "_1jet_w").c_str()));
-    mVisClosure_W_2jet = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_mvis_" + channel + "_2jet_w").c_str()));
-    mVisClosure_TT = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_mvis_" + channel + "_ttmc").c_str()));
+    // read all TF1's and tabulate them over the values get_ff can pass them
+    ff_qcd_0jet = tabulate(raw_file, "rawFF_" + channel + "_qcd_0jet", 100.);
+    ff_qcd_0jet_unc1_up = tabulate(raw_file, "rawFF_" + channel + "_qcd_0jet_unc1_up", 100.);
+    ff_qcd_0jet_unc1_down = tabulate(raw_file, "rawFF_" + channel + "_qcd_0jet_unc1_down", 100.);
+    ff_qcd_0jet_unc2_up = tabulate(raw_file, "rawFF_" + channel + "_qcd_0jet_unc2_up", 100.);
+    ff_qcd_0jet_unc2_down = tabulate(raw_file, "rawFF_" + channel + "_qcd_0jet_unc2_down", 100.);
+
+    ff_qcd_1jet = tabulate(raw_file, "rawFF_" + channel + "_qcd_1jet", 100.);
+    ff_qcd_1jet_unc1_up = tabulate(raw_file, "rawFF_" + channel + "_qcd_1jet_unc1_up", 100.);
+    ff_qcd_1jet_unc1_down = tabulate(raw_file, "rawFF_" + channel + "_qcd_1jet_unc1_down", 100.);
+    ff_qcd_1jet_unc2_up = tabulate(raw_file, "rawFF_" + channel + "_qcd_1jet_unc2_up", 100.);
+    ff_qcd_1jet_unc2_down = tabulate(raw_file, "rawFF_" + channel + "_qcd_1jet_unc2_down", 100.);
+
+    ff_qcd_2jet = tabulate(raw_file, "rawFF_" + channel + "_qcd_2jet", 100.);
+    ff_qcd_2jet_unc1_up = tabulate(raw_file, "rawFF_" + channel + "_qcd_2jet_unc1_up", 100.);
+    ff_qcd_2jet_unc1_down = tabulate(raw_file, "rawFF_" + channel + "_qcd_2jet_unc1_down", 100.);
+    ff_qcd_2jet_unc2_up = tabulate(raw_file, "rawFF_" + channel + "_qcd_2jet_unc2_up", 100.);
+    ff_qcd_2jet_unc2_down = tabulate(raw_file, "rawFF_" + channel + "_qcd_2jet_unc2_down", 100.);
+
+    ff_w_0jet = tabulate(raw_file, "rawFF_" + channel + "_w_0jet", 100.);
+    ff_w_0jet_unc1_up = tabulate(raw_file, "rawFF_" + channel + "_w_0jet_unc1_up", 100.);
+    ff_w_0jet_unc1_down = tabulate(raw_file, "rawFF_" + channel + "_w_0jet_unc1_down", 100.);
+    ff_w_0jet_unc2_up = tabulate(raw_file, "rawFF_" + channel + "_w_0jet_unc2_up", 100.);
+    ff_w_0jet_unc2_down = tabulate(raw_file, "rawFF_" + channel + "_w_0jet_unc2_down", 100.);
+
+    ff_w_1jet = tabulate(raw_file, "rawFF_" + channel + "_w_1jet", 100.);
+    ff_w_1jet_unc1_up = tabulate(raw_file, "rawFF_" + channel + "_w_1jet_unc1_up", 100.);
+    ff_w_1jet_unc1_down = tabulate(raw_file, "rawFF_" + channel + "_w_1jet_unc1_down", 100.);
+    ff_w_1jet_unc2_up = tabulate(raw_file, "rawFF_" + channel + "_w_1jet_unc2_up", 100.);
+    ff_w_1jet_unc2_down = tabulate(raw_file, "rawFF_" + channel + "_w_1jet_unc2_down", 100.);
+
+    ff_w_2jet = tabulate(raw_file, "rawFF_" + channel + "_w_2jet", 100.);
+    ff_w_2jet_unc1_up = tabulate(raw_file, "rawFF_" + channel + "_w_2jet_unc1_up", 100.);
+    ff_w_2jet_unc1_down = tabulate(raw_file, "rawFF_" + channel + "_w_2jet_unc1_down", 100.);
+    ff_w_2jet_unc2_up = tabulate(raw_file, "rawFF_" + channel + "_w_2jet_unc2_up", 100.);
+    ff_w_2jet_unc2_down = tabulate(raw_file, "rawFF_" + channel + "_w_2jet_unc2_down", 100.);
+
+    ff_tt_0jet = tabulate(raw_file, "mc_rawFF_" + channel + "_tt", 100.);
+    ff_tt_0jet_unc1_up = tabulate(raw_file, "mc_rawFF_" + channel + "_tt_unc1_up", 100.);
+    ff_tt_0jet_unc1_down = tabulate(raw_file, "mc_rawFF_" + channel + "_tt_unc1_down", 100.);
+    ff_tt_0jet_unc2_up = tabulate(raw_file, "mc_rawFF_" + channel + "_tt_unc2_up", 100.);
+    ff_tt_0jet_unc2_down = tabulate(raw_file, "mc_rawFF_" + channel + "_tt_unc2_down", 100.);
+
+    mVisClosure_QCD_0jet = tabulate(vis_mass_file, "closure_mvis_" + channel + "_0jet_qcd", 250.);
+    mVisClosure_QCD_1jet = tabulate(vis_mass_file, "closure_mvis_" + channel + "_1jet_qcd", 250.);
+    mVisClosure_QCD_2jet = tabulate(vis_mass_file, "closure_mvis_" + channel + "_2jet_qcd", 250.);
+    mVisClosure_W_0jet = tabulate(vis_mass_file, "closure_mvis_" + channel + "_0jet_w", 250.);
+    mVisClosure_W_1jet = tabulate(vis_mass_file, "closure_mvis_" + channel + "_1jet_w", 250.);
+    mVisClosure_W_2jet = tabulate(vis_mass_file, "closure_mvis_" + channel + "_2jet_w", 250.);
+    mVisClosure_TT = tabulate(vis_mass_file, "closure_mvis_" + channel + "_ttmc", 250.);
 
     if (channel == "mt") {
-        lptClosure_W_taupt30to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to50_" + channel + "_w").c_str()));
-        lptClosure_W_taupt50to70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt50to70_" + channel + "_w").c_str()));
-        lptClosure_W_tauptgt70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt70_" + channel + "_w").c_str()));
-        lptClosure_QCD_taupt30to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to50_" + channel + "_qcd").c_str()));
-        lptClosure_QCD_taupt50to70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt50to70_" + channel + "_qcd").c_str()));
-        lptClosure_QCD_tauptgt70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt70_" + channel + "_qcd").c_str()));
-        lptClosure_TT_taupt30to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to50_" + channel + "_ttmc").c_str()));
-        lptClosure_TT_taupt50to70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt50to70_" + channel + "_ttmc").c_str()));
-        lptClosure_TT_tauptgt70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt70_" + channel + "_ttmc").c_str()));
-
-        lptClosure_W_xtrg_taupt30to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to50_xtrg_" + channel + "_w").c_str()));
-        lptClosure_W_xtrg_taupt50to70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt50to70_xtrg_" + channel + "_w").c_str()));
-        lptClosure_W_xtrg_tauptgt70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt70_xtrg_" + channel + "_w").c_str()));
-        lptClosure_QCD_xtrg_taupt30to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to50_xtrg_" + channel + "_qcd").c_str()));
-        lptClosure_QCD_xtrg_taupt50to70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt50to70_xtrg_" + channel + "_qcd").c_str()));
-        lptClosure_QCD_xtrg_tauptgt70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt70_xtrg_" + channel + "_qcd").c_str()));
-        lptClosure_TT_xtrg_taupt30to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to50_xtrg_" + channel + "_ttmc").c_str()));
-        lptClosure_TT_xtrg_taupt50to70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt50to70_xtrg_" + channel + "_ttmc").c_str()));
-        lptClosure_TT_xtrg_tauptgt70 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt70_xtrg_" + channel + "_ttmc").c_str()));
+        lptClosure_W_taupt30to50 = tabulate(vis_mass_file, "closure_lpt_taupt30to50_" + channel + "_w", 150.);
+        lptClosure_W_taupt50to70 = tabulate(vis_mass_file, "closure_lpt_taupt50to70_" + channel + "_w", 150.);
+        lptClosure_W_tauptgt70 = tabulate(vis_mass_file, "closure_lpt_tauptgt70_" + channel + "_w", 150.);
+        lptClosure_QCD_taupt30to50 = tabulate(vis_mass_file, "closure_lpt_taupt30to50_" + channel + "_qcd", 150.);
+        lptClosure_QCD_taupt50to70 = tabulate(vis_mass_file, "closure_lpt_taupt50to70_" + channel + "_qcd", 150.);
+        lptClosure_QCD_tauptgt70 = tabulate(vis_mass_file, "closure_lpt_tauptgt70_" + channel + "_qcd", 150.);
+        lptClosure_TT_taupt30to50 = tabulate(vis_mass_file, "closure_lpt_taupt30to50_" + channel + "_ttmc", 150.);
+        lptClosure_TT_taupt50to70 = tabulate(vis_mass_file, "closure_lpt_taupt50to70_" + channel + "_ttmc", 150.);
+        lptClosure_TT_tauptgt70 = tabulate(vis_mass_file, "closure_lpt_tauptgt70_" + channel + "_ttmc", 150.);
+
+        lptClosure_W_xtrg_taupt30to50 = tabulate(vis_mass_file, "closure_lpt_taupt30to50_xtrg_" + channel + "_w", 150.);
+        lptClosure_W_xtrg_taupt50to70 = tabulate(vis_mass_file, "closure_lpt_taupt50to70_xtrg_" + channel + "_w", 150.);
+        lptClosure_W_xtrg_tauptgt70 = tabulate(vis_mass_file, "closure_lpt_tauptgt70_xtrg_" + channel + "_w", 150.);
+        lptClosure_QCD_xtrg_taupt30to50 = tabulate(vis_mass_file, "closure_lpt_taupt30to50_xtrg_" + channel + "_qcd", 150.);
+        lptClosure_QCD_xtrg_taupt50to70 = tabulate(vis_mass_file, "closure_lpt_taupt50to70_xtrg_" + channel + "_qcd", 150.);
+        lptClosure_QCD_xtrg_tauptgt70 = tabulate(vis_mass_file, "closure_lpt_tauptgt70_xtrg_" + channel + "_qcd", 150.);
+        lptClosure_TT_xtrg_taupt30to50 = tabulate(vis_mass_file, "closure_lpt_taupt30to50_xtrg_" + channel + "_ttmc", 150.);
+        lptClosure_TT_xtrg_taupt50to70 = tabulate(vis_mass_file, "closure_lpt_taupt50to70_xtrg_" + channel + "_ttmc", 150.);
+        lptClosure_TT_xtrg_tauptgt70 = tabulate(vis_mass_file, "closure_lpt_tauptgt70_xtrg_" + channel + "_ttmc", 150.);
     } else {
-        lptClosure_W_taupt30to40 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to40_" + channel + "_w").c_str()));
-        lptClosure_W_taupt40to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt40to50_" + channel + "_w").c_str()));
-        lptClosure_W_tauptgt50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt50_" + channel + "_w").c_str()));
-        lptClosure_QCD_taupt30to40 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to40_" + channel + "_qcd").c_str()));
-        lptClosure_QCD_taupt40to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt40to50_" + channel + "_qcd").c_str()));
-        lptClosure_QCD_tauptgt50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt50_" + channel + "_qcd").c_str()));
-        lptClosure_TT_taupt30to40 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to40_" + channel + "_ttmc").c_str()));
-        lptClosure_TT_taupt40to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt40to50_" + channel + "_ttmc").c_str()));
-        lptClosure_TT_tauptgt50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt50_" + channel + "_ttmc").c_str()));
-
-        lptClosure_W_xtrg_taupt30to40 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to40_xtrg_" + channel + "_w").c_str()));
-        lptClosure_W_xtrg_taupt40to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt40to50_xtrg_" + channel + "_w").c_str()));
-        lptClosure_W_xtrg_tauptgt50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt50_xtrg_" + channel + "_w").c_str()));
-        lptClosure_QCD_xtrg_taupt30to40 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to40_xtrg_" + channel + "_qcd").c_str()));
-        lptClosure_QCD_xtrg_taupt40to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt40to50_xtrg_" + channel + "_qcd").c_str()));
-        lptClosure_QCD_xtrg_tauptgt50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt50_xtrg_" + channel + "_qcd").c_str()));
-        lptClosure_TT_xtrg_taupt30to40 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt30to40_xtrg_" + channel + "_ttmc").c_str()));
-        lptClosure_TT_xtrg_taupt40to50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_taupt40to50_xtrg_" + channel + "_ttmc").c_str()));
-        lptClosure_TT_xtrg_tauptgt50 = reinterpret_cast<TF1 *>(vis_mass_file->Get(("closure_lpt_tauptgt50_xtrg_" + channel + "_ttmc").c_str()));
+        lptClosure_W_taupt30to40 = tabulate(vis_mass_file, "closure_lpt_taupt30to40_" + channel + "_w", 150.);
+        lptClosure_W_taupt40to50 = tabulate(vis_mass_file, "closure_lpt_taupt40to50_" + channel + "_w", 150.);
+        lptClosure_W_tauptgt50 = tabulate(vis_mass_file, "closure_lpt_tauptgt50_" + channel + "_w", 150.);
+        lptClosure_QCD_taupt30to40 = tabulate(vis_mass_file, "closure_lpt_taupt30to40_" + channel + "_qcd", 150.);
+        lptClosure_QCD_taupt40to50 = tabulate(vis_mass_file, "closure_lpt_taupt40to50_" + channel + "_qcd", 150.);
+        lptClosure_QCD_tauptgt50 = tabulate(vis_mass_file, "closure_lpt_tauptgt50_" + channel + "_qcd", 150.);
+        lptClosure_TT_taupt30to40 = tabulate(vis_mass_file, "closure_lpt_taupt30to40_" + channel + "_ttmc", 150.);
+        lptClosure_TT_taupt40to50 = tabulate(vis_mass_file, "closure_lpt_taupt40to50_" + channel + "_ttmc", 150.);
+        lptClosure_TT_tauptgt50 = tabulate(vis_mass_file, "closure_lpt_tauptgt50_" + channel + "_ttmc", 150.);
+
+        lptClosure_W_xtrg_taupt30to40 = tabulate(vis_mass_file, "closure_lpt_taupt30to40_xtrg_" + channel + "_w", 150.);
+        lptClosure_W_xtrg_taupt40to50 = tabulate(vis_mass_file, "closure_lpt_taupt40to50_xtrg_" + channel + "_w", 150.);
+        lptClosure_W_xtrg_tauptgt50 = tabulate(vis_mass_file, "closure_lpt_tauptgt50_xtrg_" + channel + "_w", 150.);
+        lptClosure_QCD_xtrg_taupt30to40 = tabulate(vis_mass_file, "closure_lpt_taupt30to40_xtrg_" + channel + "_qcd", 150.);
+        lptClosure_QCD_xtrg_taupt40to50 = tabulate(vis_mass_file, "closure_lpt_taupt40to50_xtrg_" + channel + "_qcd", 150.);
+        lptClosure_QCD_xtrg_tauptgt50 = tabulate(vis_mass_file, "closure_lpt_tauptgt50_xtrg_" + channel + "_qcd", 150.);
+        lptClosure_TT_xtrg_taupt30to40 = tabulate(vis_mass_file, "closure_lpt_taupt30to40_xtrg_" + channel + "_ttmc", 150.);
+        lptClosure_TT_xtrg_taupt40to50 = tabulate(vis_mass_file, "closure_lpt_taupt40to50_xtrg_" + channel + "_ttmc", 150.);
+        lptClosure_TT_xtrg_tauptgt50 = tabulate(vis_mass_file, "closure_lpt_tauptgt50_xtrg_" + channel + "_ttmc", 150.);
     }
 
-    OSSSClosure_QCD = reinterpret_cast<TF1 *>(osss_file->Get(("closure_OSSS_dr_flat_" + channel + "_qcd").c_str()));
+    OSSSClosure_QCD = tabulate(osss_file, "closure_OSSS_dr_flat_" + channel + "_qcd");
 
-    MTClosure_W = reinterpret_cast<TF1 *>(osss_file->Get(("closure_mt_" + channel + "_w").c_str()));
-    MTClosure_W_unc1_up = reinterpret_cast<TF1 *>(osss_file->Get(("closure_mt_" + channel + "_w_unc1_up").c_str()));
-    MTClosure_W_unc1_down = reinterpret_cast<TF1 *>(osss_file->Get(("closure_mt_" + channel + "_w_unc1_down").c_str()));
-    MTClosure_W_unc2_up = reinterpret_cast<TF1 *>(osss_file->Get(("closure_mt_" + channel + "_w_unc2_up").c_str()));
-    MTClosure_W_unc2_down = reinterpret_cast<TF1 *>(osss_file->Get(("closure_mt_" + channel + "_w_unc2_down").c_str()));
+    MTClosure_W = tabulate(osss_file, "closure_mt_" + channel + "_w");
+    MTClosure_W_unc1_up = tabulate(osss_file, "closure_mt_" + channel + "_w_unc1_up");
+    MTClosure_W_unc1_down = tabulate(osss_file, "closure_mt_" + channel + "_w_unc1_down");
+    MTClosure_W_unc2_up = tabulate(osss_file, "closure_mt_" + channel + "_w_unc2_up");
+    MTClosure_W_unc2_down = tabulate(osss_file, "closure_mt_" + channel + "_w_unc2_down");
 
-    tauPtCorrection_qcd = reinterpret_cast<TF1 *>(tpt_file->Get("mt_0jet_qcd_taupt_iso"));
-    tauPtCorrection_w = reinterpret_cast<TF1 *>(tpt_file->Get("mt_0jet_w_taupt_iso"));
-}
+    tauPtCorrection_qcd = tabulate(tpt_file, "mt_0jet_qcd_taupt_iso", 100.);
+    tauPtCorrection_w = tabulate(tpt_file, "mt_0jet_w_taupt_iso", 100.);
 
-Float_t apply_ff::raw_w(Float_t pt, Float_t njets, std::string unc, std::string dir) {
-    if (njets == 0) {
-        if (unc == "ff_w_0jet_unc1") {
-            return dir == "up" ? ff_w_0jet_unc1_up->Eval(pt) : ff_w_0jet_unc1_down->Eval(pt);
-        } else if (unc == "ff_w_0jet_unc2") {
-            return dir == "up" ? ff_w_0jet_unc2_up->Eval(pt) : ff_w_0jet_unc2_down->Eval(pt);
-        }
-        return ff_w_0jet->Eval(pt);
-    } else if (njets == 1) {
-        if (unc == "ff_w_1jet_unc1") {
-            return dir == "up" ? ff_w_1jet_unc1_up->Eval(pt) : ff_w_1jet_unc1_down->Eval(pt);
-        } else if (unc == "ff_w_1jet_unc2") {
-            return dir == "up" ? ff_w_1jet_unc2_up->Eval(pt) : ff_w_1jet_unc2_down->Eval(pt);
-        }
-        return ff_w_1jet->Eval(pt);
-    }
+    raw_qcd_tables = {{{ff_qcd_0jet, ff_qcd_0jet_unc1_up, ff_qcd_0jet_unc1_down, ff_qcd_0jet_unc2_up, ff_qcd_0jet_unc2_down},
+                       {ff_qcd_1jet, ff_qcd_1jet_unc1_up, ff_qcd_1jet_unc1_down, ff_qcd_1jet_unc2_up, ff_qcd_1jet_unc2_down},
+                       {ff_qcd_2jet, ff_qcd_2jet_unc1_up, ff_qcd_2jet_unc1_down, ff_qcd_2jet_unc2_up, ff_qcd_2jet_unc2_down}}};
+    raw_w_tables = {{{ff_w_0jet, ff_w_0jet_unc1_up, ff_w_0jet_unc1_down, ff_w_0jet_unc2_up, ff_w_0jet_unc2_down},
+                     {ff_w_1jet, ff_w_1jet_unc1_up, ff_w_1jet_unc1_down, ff_w_1jet_unc2_up, ff_w_1jet_unc2_down},
+                     {ff_w_2jet, ff_w_2jet_unc1_up, ff_w_2jet_unc1_down, ff_w_2jet_unc2_up, ff_w_2jet_unc2_down}}};
+    raw_tt_tables = {ff_tt_0jet, ff_tt_0jet_unc1_up, ff_tt_0jet_unc1_down, ff_tt_0jet_unc2_up, ff_tt_0jet_unc2_down};
+    mt_closure_tables = {MTClosure_W, MTClosure_W_unc1_up, MTClosure_W_unc1_down, MTClosure_W_unc2_up, MTClosure_W_unc2_down};
 
-    // must be 2+ jets
-    if (unc == "ff_w_2jet_unc1") {
-        return dir == "up" ? ff_w_2jet_unc1_up->Eval(pt) : ff_w_2jet_unc1_down->Eval(pt);
-    } else if (unc == "ff_w_2jet_unc2") {
-        return dir == "up" ? ff_w_2jet_unc2_up->Eval(pt) : ff_w_2jet_unc2_down->Eval(pt);
+    if (channel == "mt") {
+        lpt_closure_edges = {50., 70.};
+        lpt_closure_tables = {{{{{lptClosure_QCD_taupt30to50, lptClosure_QCD_taupt50to70, lptClosure_QCD_tauptgt70},
+                                 {lptClosure_W_taupt30to50, lptClosure_W_taupt50to70, lptClosure_W_tauptgt70},
+                                 {lptClosure_TT_taupt30to50, lptClosure_TT_taupt50to70, lptClosure_TT_tauptgt70}}},
+                               {{{lptClosure_QCD_xtrg_taupt30to50, lptClosure_QCD_xtrg_taupt50to70, lptClosure_QCD_xtrg_tauptgt70},
+                                 {lptClosure_W_xtrg_taupt30to50, lptClosure_W_xtrg_taupt50to70, lptClosure_W_xtrg_tauptgt70},
+                                 {lptClosure_TT_xtrg_taupt30to50, lptClosure_TT_xtrg_taupt50to70, lptClosure_TT_xtrg_tauptgt70}}}}};
+    } else {
+        lpt_closure_edges = {40., 50.};
+        lpt_closure_tables = {{{{{lptClosure_QCD_taupt30to40, lptClosure_QCD_taupt40to50, lptClosure_QCD_tauptgt50},
+                                 {lptClosure_W_taupt30to40, lptClosure_W_taupt40to50, lptClosure_W_tauptgt50},
+                                 {lptClosure_TT_taupt30to40, lptClosure_TT_taupt40to50, lptClosure_TT_tauptgt50}}},
+                               {{{lptClosure_QCD_xtrg_taupt30to40, lptClosure_QCD_xtrg_taupt40to50, lptClosure_QCD_xtrg_tauptgt50},
+                                 {lptClosure_W_xtrg_taupt30to40, lptClosure_W_xtrg_taupt40to50, lptClosure_W_xtrg_tauptgt50},
+                                 {lptClosure_TT_xtrg_taupt30to40, lptClosure_TT_xtrg_taupt40to50, lptClosure_TT_xtrg_tauptgt50}}}}};
     }
-    return ff_w_2jet->Eval(pt);
 }
 
-Float_t apply_ff::raw_qcd(Float_t pt, Float_t njets, std::string unc, std::string dir) {
-    if (njets == 0) {
-        if (unc == "ff_qcd_0jet_unc1") {
-            return dir == "up" ? ff_qcd_0jet_unc1_up->Eval(pt) : ff_qcd_0jet_unc1_down->Eval(pt);
-        } else if (unc == "ff_qcd_0jet_unc2") {
-            return dir == "up" ? ff_qcd_0jet_unc2_up->Eval(pt) : ff_qcd_0jet_unc2_down->Eval(pt);
-        }
-        return ff_qcd_0jet->Eval(pt);
-    } else if (njets == 1) {
-        if (unc == "ff_qcd_1jet_unc1") {
-            return dir == "up" ? ff_qcd_1jet_unc1_up->Eval(pt) : ff_qcd_1jet_unc1_down->Eval(pt);
-        } else if (unc == "ff_qcd_1jet_unc2") {
-            return dir == "up" ? ff_qcd_1jet_unc2_up->Eval(pt) : ff_qcd_1jet_unc2_down->Eval(pt);
-        }
-
-        return ff_qcd_1jet->Eval(pt);
+// tabulate a TF1 in [0, max] (the clamped range get_ff uses) or over the range of
+// the TF1 when the input isn't clamped. Tables that don't reproduce the TF1 fall
+// back to evaluating it, and so do all tables when tabulated is false
+ff_table *apply_ff::tabulate(TFile *file, std::string name, double max) {
+    auto function = dynamic_cast<TF1 *>(file->Get(name.c_str()));
+    if (function == nullptr) {
+        return nullptr;
     }
 
-    // must be 2+ jets
-    if (unc == "ff_qcd_2jet_unc1") {
-        return dir == "up" ? ff_qcd_2jet_unc1_up->Eval(pt) : ff_qcd_2jet_unc1_down->Eval(pt);
-    } else if (unc == "ff_qcd_2jet_unc2") {
-        return dir == "up" ? ff_qcd_2jet_unc2_up->Eval(pt) : ff_qcd_2jet_unc2_down->Eval(pt);
+    auto nbins = tabulated ? 1000 : 0;
+    if (max > 0) {
+        tables.emplace_back(new ff_table(function, 0., max, nbins));
+    } else {
+        tables.emplace_back(new ff_table(function, function->GetXmin(), function->GetXmax(), nbins));
     }
-    return ff_qcd_2jet->Eval(pt);
-}
-
-Float_t apply_ff::raw_tt(Float_t pt, std::string unc, std::string dir) {
-    if (unc == "ff_tt_0jet_unc1") {
-        return dir == "up" ? ff_tt_0jet_unc1_up->Eval(pt) : ff_tt_0jet_unc1_down->Eval(pt);
-    } else if (unc == "ff_tt_0jet_unc2") {
-        return dir == "up" ? ff_tt_0jet_unc2_up->Eval(pt) : ff_tt_0jet_unc2_down->Eval(pt);
+    if (tabulated && !tables.back()->isValid()) {
+        std::cerr << "Unable to tabulate " << name << " (max. deviation " << tables.back()->getDeviation() << "), using the TF1 instead" << std::endl;
     }
-    return ff_tt_0jet->Eval(pt);
+    return tables.back().get();
 }
 
-Float_t apply_ff::lpt_cls_corr_w(Float_t pt, Float_t lpt, Float_t xtrg, std::string unc, std::string dir) {
-    // call sub-functions so that if mt/et synchronize at some point we can continue to just call
-    // this function to handle things
-    if (channel == "mt") {
-        return xtrg ? lpt_cls_corr_xtrg_mt_w(pt, lpt, unc, dir) : lpt_cls_corr_mt_w(pt, lpt, unc, dir);
-    } else {
-        return xtrg ? lpt_cls_corr_xtrg_et_w(pt, lpt, unc, dir) : lpt_cls_corr_et_w(pt, lpt, unc, dir);
+// index into the *_tables arrays for the shift of a raw fake factor or m_T closure, given
+// the unc1 systematic of the function. Any other shift gives the nominal
+std::size_t apply_ff::variation(ff_systematics::shift shift, std::size_t unc1) {
+    if (shift.syst == unc1 || shift.syst == unc1 + 1) {
+        return 1 + 2 * (shift.syst - unc1) + (shift.up ? 0 : 1);
     }
+    return 0;
 }
 
-Float_t apply_ff::lpt_cls_corr_tt(Float_t pt, Float_t lpt, Float_t xtrg, std::string unc, std::string dir) {
-    // call sub-functions so that if mt/et synchronize at some point we can continue to just call
-    // this function to handle things
-    if (channel == "mt") {
-        return xtrg ? lpt_cls_corr_xtrg_mt_tt(pt, lpt, unc, dir) : lpt_cls_corr_mt_tt(pt, lpt, unc, dir);
-    } else {
-        return xtrg ? lpt_cls_corr_xtrg_et_tt(pt, lpt, unc, dir) : lpt_cls_corr_et_tt(pt, lpt, unc, dir);
+// tau pT bin of the lepton pT closures, -1 if it isn't in any of them
+int apply_ff::lpt_closure_bin(Float_t pt) {
+    if (pt <= 30.) {
+        return -1;
     }
+    return pt <= lpt_closure_edges[0] ? 0 : (pt <= lpt_closure_edges[1] ? 1 : 2);
 }
 
-Float_t apply_ff::lpt_cls_corr_qcd(Float_t pt, Float_t lpt, Float_t xtrg, std::string unc, std::string dir) {
-    // call sub-functions so that if mt/et synchronize at some point we can continue to just call
-    // this function to handle things
-    if (channel == "mt") {
-        return xtrg ? lpt_cls_corr_xtrg_mt_qcd(pt, lpt, unc, dir) : lpt_cls_corr_mt_qcd(pt, lpt, unc, dir);
-    } else {
-        return xtrg ? lpt_cls_corr_xtrg_et_qcd(pt, lpt, unc, dir) : lpt_cls_corr_et_qcd(pt, lpt, unc, dir);
-    }
+Float_t apply_ff::raw_qcd(Float_t pt, std::size_t njets, ff_systematics::shift shift) {
+    return raw_qcd_tables[njets][variation(shift, ff_systematics::ff_qcd_0jet_unc1 + 2 * njets)]->Eval(pt);
 }
 
-Float_t apply_ff::lpt_cls_corr_mt_qcd(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_qcd") {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_QCD_taupt30to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_QCD_taupt50to70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 70.) {
-            return lptClosure_QCD_tauptgt70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_QCD_taupt30to50->Eval(lpt);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_QCD_taupt50to70->Eval(lpt);
-        } else if (pt > 70.) {
-            return lptClosure_QCD_tauptgt70->Eval(lpt);
-        }
-    }
-
-    return 1.;
+Float_t apply_ff::raw_w(Float_t pt, std::size_t njets, ff_systematics::shift shift) {
+    return raw_w_tables[njets][variation(shift, ff_systematics::ff_w_0jet_unc1 + 2 * njets)]->Eval(pt);
 }
 
-Float_t apply_ff::lpt_cls_corr_mt_w(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_w") {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_W_taupt30to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_W_taupt50to70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 70.) {
-            return lptClosure_W_tauptgt70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_W_taupt30to50->Eval(lpt);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_W_taupt50to70->Eval(lpt);
-        } else if (pt > 70.) {
-            return lptClosure_W_tauptgt70->Eval(lpt);
-        }
-    }
-
-    return 1.;
+Float_t apply_ff::raw_tt(Float_t pt, ff_systematics::shift shift) {
+    return raw_tt_tables[variation(shift, ff_systematics::ff_tt_0jet_unc1)]->Eval(pt);
 }
 
-Float_t apply_ff::lpt_cls_corr_mt_tt(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_tt") {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_TT_taupt30to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_TT_taupt50to70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 70.) {
-            return lptClosure_TT_tauptgt70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_TT_taupt30to50->Eval(lpt);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_TT_taupt50to70->Eval(lpt);
-        } else if (pt > 70.) {
-            return lptClosure_TT_tauptgt70->Eval(lpt);
-        }
+// lepton pT closure for the channel, cross trigger and tau pT bin. Outside of the bins there is no correction
+Float_t apply_ff::lpt_cls_corr(process proc, Float_t pt, Float_t lpt, std::size_t xtrg, ff_systematics::shift shift) {
+    auto bin = lpt_closure_bin(pt);
+    if (bin < 0) {
+        return 1.;
     }
 
-    return 1.;
-}
-
-Float_t apply_ff::lpt_cls_corr_xtrg_mt_qcd(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_xtrg_qcd") {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_QCD_xtrg_taupt30to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_QCD_xtrg_taupt50to70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 70.) {
-            return lptClosure_QCD_xtrg_tauptgt70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_QCD_xtrg_taupt30to50->Eval(lpt);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_QCD_xtrg_taupt50to70->Eval(lpt);
-        } else if (pt > 70.) {
-            return lptClosure_QCD_xtrg_tauptgt70->Eval(lpt);
-        }
+    auto corr = lpt_closure_tables[xtrg][proc][bin]->Eval(lpt);
+    if (shift.syst == (xtrg ? ff_systematics::lptclosure_xtrg_qcd : ff_systematics::lptclosure_qcd) + proc) {
+        return corr * (shift.up ? 1.1 : 0.9);
     }
-
-    return 1.;
+    return corr;
 }
 
-Float_t apply_ff::lpt_cls_corr_xtrg_mt_w(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_xtrg_w") {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_W_xtrg_taupt30to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_W_xtrg_taupt50to70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 70.) {
-            return lptClosure_W_xtrg_tauptgt70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_W_xtrg_taupt30to50->Eval(lpt);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_W_xtrg_taupt50to70->Eval(lpt);
-        } else if (pt > 70.) {
-            return lptClosure_W_xtrg_tauptgt70->Eval(lpt);
-        }
-    }
-
-    return 1.;
+Float_t apply_ff::mt_closure_corr(Float_t mt, ff_systematics::shift shift) {
+    return mt_closure_tables[variation(shift, ff_systematics::mtclosure_w_unc1)]->Eval(mt);
 }
 
-Float_t apply_ff::lpt_cls_corr_xtrg_mt_tt(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_xtrg_tt") {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_TT_xtrg_taupt30to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_TT_xtrg_taupt50to70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 70.) {
-            return lptClosure_TT_xtrg_tauptgt70->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 50.) {
-            return lptClosure_TT_xtrg_taupt30to50->Eval(lpt);
-        } else if (pt > 50. && pt <= 70.) {
-            return lptClosure_TT_xtrg_taupt50to70->Eval(lpt);
-        } else if (pt > 70.) {
-            return lptClosure_TT_xtrg_tauptgt70->Eval(lpt);
-        }
+Float_t apply_ff::osss_closure_corr(Float_t dr, ff_systematics::shift shift) {
+    if (shift.syst == ff_systematics::osssclosure_qcd) {
+        return OSSSClosure_QCD->Eval(dr) * (shift.up ? 1.1 : 0.9);
     }
-
-    return 1.;
+    return OSSSClosure_QCD->Eval(dr);
 }
 
-Float_t apply_ff::lpt_cls_corr_et_qcd(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_qcd") {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_QCD_taupt30to40->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_QCD_taupt40to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50.) {
-            return lptClosure_QCD_tauptgt50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_QCD_taupt30to40->Eval(lpt);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_QCD_taupt40to50->Eval(lpt);
-        } else if (pt > 50.) {
-            return lptClosure_QCD_tauptgt50->Eval(lpt);
-        }
-    }
-
-    return 1.;
+// names are resolved on every call, so loops over events should resolve
+// the shift once and call the ff_kinematics version
+Float_t apply_ff::get_ff(std::vector<Float_t> kin, std::string unc = "", std::string dir = "") {
+    // kin = pt(0), mt(1), mvis(2), lpt(3), dr(4), met(5), njets(6), xtrg(7), frac_tt(8), frac_qcd(9), frac_w(10)
+    ff_kinematics event_kin;
+    std::copy_n(kin.begin(), event_kin.size(), event_kin.begin());
+    return get_ff(event_kin, ff_systematics::resolve(unc, dir));
 }
 
-Float_t apply_ff::lpt_cls_corr_et_w(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_w") {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_W_taupt30to40->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_W_taupt40to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50.) {
-            return lptClosure_W_tauptgt50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_W_taupt30to40->Eval(lpt);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_W_taupt40to50->Eval(lpt);
-        } else if (pt > 50.) {
-            return lptClosure_W_tauptgt50->Eval(lpt);
-        }
-    }
+Float_t apply_ff::get_ff(const ff_kinematics &kin, ff_systematics::shift shift) {
+    Float_t eff_pt(std::min(static_cast<Float_t>(100), kin[0]));
+    Float_t eff_lpt(std::min(static_cast<Float_t>(150), kin[3]));
+    std::size_t njets(kin[6] == 0 ? 0 : (kin[6] == 1 ? 1 : 2));
+    std::size_t xtrg(kin[7] ? 1 : 0);
 
-    return 1.;
-}
+    // get raw fake factors
+    Float_t ff_qcd(raw_qcd(eff_pt, njets, shift)), ff_w(raw_w(eff_pt, njets, shift)), ff_tt(raw_tt(eff_pt, shift));
 
-Float_t apply_ff::lpt_cls_corr_et_tt(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_tt") {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_TT_taupt30to40->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_TT_taupt40to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50.) {
-            return lptClosure_TT_tauptgt50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_TT_taupt30to40->Eval(lpt);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_TT_taupt40to50->Eval(lpt);
-        } else if (pt > 50.) {
-            return lptClosure_TT_tauptgt50->Eval(lpt);
-        }
-    }
+    // lepton pT closure (depends on channel and cross trigger)
+    ff_w *= lpt_cls_corr(w, eff_pt, eff_lpt, xtrg, shift);
+    ff_tt *= lpt_cls_corr(tt, eff_pt, eff_lpt, xtrg, shift);
+    ff_qcd *= lpt_cls_corr(qcd, eff_pt, eff_lpt, xtrg, shift);
 
-    return 1.;
+    // other closure corrections
+    ff_w *= mt_closure_corr(kin[1], shift);
+    ff_qcd *= osss_closure_corr(kin[4], shift);
+
+    return kin[8] * ff_tt + kin[9] * ff_qcd + kin[10] * ff_w;
 }
 
-Float_t apply_ff::lpt_cls_corr_xtrg_et_qcd(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_xtrg_qcd") {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_QCD_xtrg_taupt30to40->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_QCD_xtrg_taupt40to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50.) {
-            return lptClosure_QCD_xtrg_tauptgt50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_QCD_xtrg_taupt30to40->Eval(lpt);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_QCD_xtrg_taupt40to50->Eval(lpt);
-        } else if (pt > 50.) {
-            return lptClosure_QCD_xtrg_tauptgt50->Eval(lpt);
-        }
+// Evaluate the raw fake factors and closures of one event at their nominal values
+apply_ff::ff_components apply_ff::nominal_components(const ff_kinematics &kin) {
+    ff_components c;
+    c.eff_pt = std::min(static_cast<Float_t>(100), kin[0]);
+    c.eff_lpt = std::min(static_cast<Float_t>(150), kin[3]);
+    c.njets = kin[6] == 0 ? 0 : (kin[6] == 1 ? 1 : 2);
+    c.xtrg = kin[7] ? 1 : 0;
+
+    c.raw_qcd = raw_qcd_tables[c.njets][0]->Eval(c.eff_pt);
+    c.raw_w = raw_w_tables[c.njets][0]->Eval(c.eff_pt);
+    c.raw_tt = raw_tt_tables[0]->Eval(c.eff_pt);
+    c.lpt_qcd = c.lpt_w = c.lpt_tt = 1.;
+    auto bin = lpt_closure_bin(c.eff_pt);
+    c.in_lpt_bin = bin >= 0;
+    if (c.in_lpt_bin) {
+        c.lpt_qcd = lpt_closure_tables[c.xtrg][qcd][bin]->Eval(c.eff_lpt);
+        c.lpt_w = lpt_closure_tables[c.xtrg][w][bin]->Eval(c.eff_lpt);
+        c.lpt_tt = lpt_closure_tables[c.xtrg][tt][bin]->Eval(c.eff_lpt);
     }
+    c.mt_w = mt_closure_tables[0]->Eval(kin[1]);
+    c.osss_qcd = OSSSClosure_QCD->Eval(kin[4]);
 
-    return 1.;
+    c.ff_qcd = make_qcd(c.raw_qcd, c.lpt_qcd, c.osss_qcd);
+    c.ff_w = make_w(c.raw_w, c.lpt_w, c.mt_w);
+    c.ff_tt = make_tt(c.raw_tt, c.lpt_tt);
+    return c;
 }
 
-Float_t apply_ff::lpt_cls_corr_xtrg_et_w(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_xtrg_w") {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_W_xtrg_taupt30to40->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_W_xtrg_taupt40to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50.) {
-            return lptClosure_W_xtrg_tauptgt50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_W_xtrg_taupt30to40->Eval(lpt);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_W_xtrg_taupt40to50->Eval(lpt);
-        } else if (pt > 50.) {
-            return lptClosure_W_xtrg_tauptgt50->Eval(lpt);
+// Fill the nominal weight and the up and down weights of every systematic (same as calling get_ff
+// for each of them). Each function is evaluated once at the nominal values and a systematic only
+// replaces the one factor it changes.
+void apply_ff::get_all_ff(const ff_kinematics &kin, ff_weights &weights) {
+    using namespace ff_systematics;
+    auto c = nominal_components(kin);
+    auto combine = [&kin](Float_t ff_qcd, Float_t ff_w, Float_t ff_tt) { return kin[8] * ff_tt + kin[9] * ff_qcd + kin[10] * ff_w; };
+    weights[0] = combine(c.ff_qcd, c.ff_w, c.ff_tt);
+
+    // raw fake factor uncertainties only apply to the event's jet multiplicity
+    for (std::size_t unc = 0; unc < 2; unc++) {
+        for (std::size_t j = 0; j < 3; j++) {
+            auto syst_qcd(ff_qcd_0jet_unc1 + 2 * j + unc), syst_w(ff_w_0jet_unc1 + 2 * j + unc);
+            if (j == c.njets) {
+                weights[up(syst_qcd)] = combine(make_qcd(raw_qcd_tables[j][1 + 2 * unc]->Eval(c.eff_pt), c.lpt_qcd, c.osss_qcd), c.ff_w, c.ff_tt);
+                weights[down(syst_qcd)] = combine(make_qcd(raw_qcd_tables[j][2 + 2 * unc]->Eval(c.eff_pt), c.lpt_qcd, c.osss_qcd), c.ff_w, c.ff_tt);
+                weights[up(syst_w)] = combine(c.ff_qcd, make_w(raw_w_tables[j][1 + 2 * unc]->Eval(c.eff_pt), c.lpt_w, c.mt_w), c.ff_tt);
+                weights[down(syst_w)] = combine(c.ff_qcd, make_w(raw_w_tables[j][2 + 2 * unc]->Eval(c.eff_pt), c.lpt_w, c.mt_w), c.ff_tt);
+            } else {
+                weights[up(syst_qcd)] = weights[down(syst_qcd)] = weights[up(syst_w)] = weights[down(syst_w)] = weights[0];
+            }
         }
+        weights[up(ff_tt_0jet_unc1 + unc)] = combine(c.ff_qcd, c.ff_w, make_tt(raw_tt_tables[1 + 2 * unc]->Eval(c.eff_pt), c.lpt_tt));
+        weights[down(ff_tt_0jet_unc1 + unc)] = combine(c.ff_qcd, c.ff_w, make_tt(raw_tt_tables[2 + 2 * unc]->Eval(c.eff_pt), c.lpt_tt));
+        weights[up(mtclosure_w_unc1 + unc)] = combine(c.ff_qcd, make_w(c.raw_w, c.lpt_w, mt_closure_tables[1 + 2 * unc]->Eval(kin[1])), c.ff_tt);
+        weights[down(mtclosure_w_unc1 + unc)] = combine(c.ff_qcd, make_w(c.raw_w, c.lpt_w, mt_closure_tables[2 + 2 * unc]->Eval(kin[1])), c.ff_tt);
     }
 
-    return 1.;
-}
-
-Float_t apply_ff::lpt_cls_corr_xtrg_et_tt(Float_t pt, Float_t lpt, std::string unc, std::string dir) {
-    if (unc == "lptclosure_xtrg_tt") {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_TT_xtrg_taupt30to40->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_TT_xtrg_taupt40to50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        } else if (pt > 50.) {
-            return lptClosure_TT_xtrg_tauptgt50->Eval(lpt) * (dir == "up" ? 1.1 : 0.9);
-        }
-    } else {
-        if (pt > 30. && pt <= 40.) {
-            return lptClosure_TT_xtrg_taupt30to40->Eval(lpt);
-        } else if (pt > 40. && pt <= 50.) {
-            return lptClosure_TT_xtrg_taupt40to50->Eval(lpt);
-        } else if (pt > 50.) {
-            return lptClosure_TT_xtrg_tauptgt50->Eval(lpt);
+    // lepton pT closures only vary for the event's trigger and when the tau pT is in one of the bins
+    for (std::size_t trigger = 0; trigger < 2; trigger++) {
+        auto syst(trigger == 1 ? lptclosure_xtrg_qcd : lptclosure_qcd);
+        if (trigger == c.xtrg && c.in_lpt_bin) {
+            weights[up(syst)] = combine(make_qcd(c.raw_qcd, c.lpt_qcd * 1.1, c.osss_qcd), c.ff_w, c.ff_tt);
+            weights[down(syst)] = combine(make_qcd(c.raw_qcd, c.lpt_qcd * 0.9, c.osss_qcd), c.ff_w, c.ff_tt);
+            weights[up(syst + 1)] = combine(c.ff_qcd, make_w(c.raw_w, c.lpt_w * 1.1, c.mt_w), c.ff_tt);
+            weights[down(syst + 1)] = combine(c.ff_qcd, make_w(c.raw_w, c.lpt_w * 0.9, c.mt_w), c.ff_tt);
+            weights[up(syst + 2)] = combine(c.ff_qcd, c.ff_w, make_tt(c.raw_tt, c.lpt_tt * 1.1));
+            weights[down(syst + 2)] = combine(c.ff_qcd, c.ff_w, make_tt(c.raw_tt, c.lpt_tt * 0.9));
+        } else {
+            std::fill(weights.begin() + up(syst), weights.begin() + down(syst + 2) + 1, weights[0]);
         }
     }
 
-    return 1.;
+    weights[up(osssclosure_qcd)] = combine(make_qcd(c.raw_qcd, c.lpt_qcd, c.osss_qcd * 1.1), c.ff_w, c.ff_tt);
+    weights[down(osssclosure_qcd)] = combine(make_qcd(c.raw_qcd, c.lpt_qcd, c.osss_qcd * 0.9), c.ff_w, c.ff_tt);
 }
 
-Float_t apply_ff::mt_closure_corr(Float_t mt, std::string unc, std::string dir) {
-    if (unc == "mtclosure_w_unc1") {
-        return dir == "up" ? MTClosure_W_unc1_up->Eval(mt) : MTClosure_W_unc1_down->Eval(mt);
-    } else if (unc == "mtclosure_w_unc2") {
-        return dir == "up" ? MTClosure_W_unc2_up->Eval(mt) : MTClosure_W_unc2_down->Eval(mt);
+// Nominal weights of a block of events, same as calling get_ff for each of them
+void apply_ff::get_ff(const ff_columns &columns, Float_t *weights) {
+    for (std::size_t i = 0; i < columns.size(); i++) {
+        auto c = nominal_components(columns.row(i));
+        weights[i] = columns.frac_tt[i] * c.ff_tt + columns.frac_qcd[i] * c.ff_qcd + columns.frac_w[i] * c.ff_w;
     }
-
-    return MTClosure_W->Eval(mt);
 }
 
-Float_t apply_ff::osss_closure_corr(Float_t dr, std::string unc, std::string dir) {
-    if (unc == "osssclosure_qcd") {
-        return OSSSClosure_QCD->Eval(dr) * (dir == "up" ? 1.1 : 0.9);
+// All weights of a block of events, same as calling get_all_ff for each of them
+void apply_ff::get_all_ff(const ff_columns &columns, ff_weights *weights) {
+    for (std::size_t i = 0; i < columns.size(); i++) {
+        get_all_ff(columns.row(i), weights[i]);
     }
-
-    return OSSSClosure_QCD->Eval(dr);
-}
-
-Float_t apply_ff::get_ff(std::vector<Float_t> kin, std::string unc = "", std::string dir = "") {
-    // kin = pt(0), mt(1), mvis(2), lpt(3), dr(4), met(5), njets(6), xtrg(7), frac_tt(8), frac_qcd(9), frac_w(10)
-    Float_t eff_pt(std::min(static_cast<Float_t>(100), kin.at(0)));
-    Float_t eff_mvis(std::min(static_cast<Float_t>(250), kin.at(2)));
-    Float_t eff_lpt(std::min(static_cast<Float_t>(150), kin.at(3)));
-    Float_t eff_met(std::max(static_cast<Float_t>(0), kin.at(5)));
-
-    // get raw fake factors
-    Float_t ff_qcd(1.), ff_w(1.), ff_tt(1.);
-    ff_qcd = raw_qcd(eff_pt, kin.at(6), unc, dir);
-    ff_w = raw_w(eff_pt, kin.at(6), unc, dir);
-    ff_tt = raw_tt(eff_pt, unc, dir);
-
-    // lepton pT closure (depends on channel and cross trigger)
-    ff_w *= lpt_cls_corr_w(eff_pt, eff_lpt, kin.at(7), unc, dir);
-    ff_tt *= lpt_cls_corr_tt(eff_pt, eff_lpt, kin.at(7), unc, dir);
-    ff_qcd *= lpt_cls_corr_qcd(eff_pt, eff_lpt, kin.at(7), unc, dir);
-
-    // other closure corrections
-    ff_w *= mt_closure_corr(kin.at(1), unc, dir);
-    ff_qcd *= osss_closure_corr(kin.at(4), unc, dir);
-    
-    return kin.at(8) * ff_tt + kin.at(9) * ff_qcd + kin.at(10) * ff_w;
 }
 
 #endif  // INCLUDE_APPLYFF_H_
@@ -19,6 +19,7 @@ class CLParser {
     bool Flag(const std::string&);
     std::string Option(const std::string&);
     std::vector<std::string> MultiOption(const std::string&, int, int);
+    std::vector<std::string> ListOption(const std::string&, char);
     unsigned int *rand_seed;
 };
 
@@ -60,5 +61,21 @@ std::vector<std::string> CLParser::MultiOption(const std::string &flag, int dept
     return opts;
 }
 
+// parse options containing a separated list of arguments (i.e. -u JetJER_Up,JetJER_Down)
+std::vector<std::string> CLParser::ListOption(const std::string &flag, char sep = ',') {
+    std::vector<std::string> items;
+    auto option = Option(flag);
+    std::size_t start(0), stop(0);
+    while (!option.empty() && stop != std::string::npos) {
+        stop = option.find(sep, start);
+        auto item = option.substr(start, stop == std::string::npos ? std::string::npos : stop - start);
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+        start = stop + 1;
+    }
+    return items;
+}
+
 #endif  // INCLUDE_CLPARSER_H_
 
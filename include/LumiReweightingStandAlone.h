@@ -23,6 +23,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include "./correction_cache.h"
 #include "TFile.h"
 #include "TH1F.h"
 #include "TH3.h"
@@ -117,8 +118,8 @@ class LumiReWeighting {
 
     LumiReWeighting(std::string generatedFile, std::string dataFile, std::string GenHistName, std::string DataHistName)
         : generatedFileName_(generatedFile), dataFileName_(dataFile), GenHistName_(GenHistName), DataHistName_(DataHistName) {
-        generatedFile_ = TFile::Open(generatedFileName_.c_str());  // MC distribution
-        dataFile_ = TFile::Open(dataFileName_.c_str());            // Data distribution
+        generatedFile_ = TFile::Open(correction_file(generatedFileName_).c_str());  // MC distribution
+        dataFile_ = TFile::Open(correction_file(dataFileName_).c_str());            // Data distribution
 
         Data_distr_ = new TH1F(*(static_cast<TH1F*>(dataFile_->Get(DataHistName_.c_str())->Clone())));
         MC_distr_ = new TH1F(*(static_cast<TH1F*>(generatedFile_->Get(GenHistName_.c_str())->Clone())));
@@ -371,7 +372,7 @@ class LumiReWeighting {
     }
 
     void weight3D_set(std::string WeightFileName) {
-        TFile* infile = TFile::Open(WeightFileName.c_str());
+        TFile* infile = TFile::Open(correction_file(WeightFileName).c_str());
         TH1F* WHist = static_cast<TH1F*>(infile->Get("WHist"));
 
         // Check if the histogram exists
@@ -0,0 +1,363 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_AC_WEIGHT_STORE_H_
+#define INCLUDE_AC_WEIGHT_STORE_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "TBranch.h"
+#include "TFile.h"
+#include "TTree.h"
+
+//////////////////////////////////////////////////////
+// Purpose: To store the AC weights of a signal     //
+// sample compactly. Event IDs are kept in one      //
+// sorted array and the weights in one column-major //
+// block with only the columns the sample uses, so  //
+// an event costs 8 bytes plus 8 per column and a   //
+// lookup is an interpolation search on the IDs.    //
+//                                                  //
+// A store can be saved to a flat binary file and   //
+// memory-mapped back, so repeated jobs on a sample //
+// skip reading the weight tree and parallel jobs   //
+// share the pages.                                 //
+//                                                  //
+// The tree entry of each event is kept too, so a   //
+// store without weight columns is an index of the  //
+// weight tree. ac_weight_cursor uses it to read    //
+// the weights of one event at a time.              //
+//////////////////////////////////////////////////////
+
+// the weights of one event, pointing into a store or a cursor. Column c goes in
+// output slot slot(c). A default view has no columns
+class ac_weight_view {
+ private:
+    const double *values;
+    std::size_t stride, ncolumns;
+    const int *slots;
+
+ public:
+    ac_weight_view() : values(nullptr), stride(0), ncolumns(0), slots(nullptr) {}
+    ac_weight_view(const double *_values, std::size_t _stride, std::size_t _ncolumns, const int *_slots)
+        : values(_values), stride(_stride), ncolumns(_ncolumns), slots(_slots) {}
+
+    std::size_t size() const { return ncolumns; }
+    int slot(std::size_t column) const { return slots[column]; }
+    double operator[](std::size_t column) const { return values[column * stride]; }
+};
+
+class ac_weight_store {
+ private:
+    // layout of a saved store: header, then the IDs, the entries and the weights
+    struct file_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t ncolumns;
+        uint64_t nrows;
+        int32_t slots[32];
+    };
+    static const char *magic() { return "ACWSTORE"; }
+    static const uint32_t version = 2;
+
+    std::size_t nrows;
+    std::vector<int> slots;  // output slot of each column
+    const Long64_t *ids;
+    const Long64_t *entries;  // entry of each row in the weight tree
+    const double *weights;    // column c of row r is weights[c * nrows + r]
+
+    // either the store owns the arrays or they point into a mapped file
+    std::vector<Long64_t> id_storage, entry_storage;
+    std::vector<double> weight_storage;
+    void *mapping;
+    std::size_t mapping_size;
+
+    void unmap();
+
+ public:
+    ac_weight_store() : nrows(0), ids(nullptr), entries(nullptr), weights(nullptr), mapping(nullptr), mapping_size(0) {}
+    ~ac_weight_store() { unmap(); }
+    ac_weight_store(const ac_weight_store &) = delete;
+    ac_weight_store &operator=(const ac_weight_store &) = delete;
+
+    bool fill(TTree *, std::vector<std::string>, std::vector<int>);
+    bool load(std::string, std::vector<int>);
+    bool save(std::string) const;
+
+    long find(Long64_t) const;
+    std::size_t size() const { return nrows; }
+    std::size_t columns() const { return slots.size(); }
+    int slot(std::size_t column) const { return slots[column]; }
+    Long64_t entry(std::size_t row) const { return entries[row]; }
+    double weight(std::size_t row, std::size_t column) const { return weights[column * nrows + row]; }
+    ac_weight_view view(std::size_t row) const { return ac_weight_view(weights + row, nrows, slots.size(), slots.data()); }
+};
+
+// read the eventID branch and the given weight branches into the store. Each
+// branch is put in the matching output slot. With no branches, only the index
+// is built. If an event is in the tree more than once, the last entry is used
+bool ac_weight_store::fill(TTree *tree, std::vector<std::string> branches, std::vector<int> _slots) {
+    unmap();
+    slots = _slots;
+    if (slots.size() != branches.size() || slots.size() > 32) {
+        std::cerr << "Invalid AC weight store layout" << std::endl;
+        return false;
+    }
+
+    // only read the branches we store
+    Long64_t eventID;
+    std::vector<Double_t> row(branches.size());
+    tree->SetBranchStatus("*", 0);
+    tree->SetBranchStatus("eventID", 1);
+    tree->SetBranchAddress("eventID", &eventID);
+    for (std::size_t c = 0; c < branches.size(); c++) {
+        tree->SetBranchStatus(branches.at(c).c_str(), 1);
+        tree->SetBranchAddress(branches.at(c).c_str(), &row.at(c));
+    }
+
+    auto nentries = tree->GetEntries();
+    std::vector<Long64_t> unsorted_ids(nentries);
+    std::vector<double> unsorted_weights(nentries * branches.size());
+    for (Long64_t i = 0; i < nentries; i++) {
+        tree->GetEntry(i);
+        unsorted_ids[i] = eventID;
+        for (std::size_t c = 0; c < branches.size(); c++) {
+            unsorted_weights[c * nentries + i] = row[c];
+        }
+    }
+    tree->ResetBranchAddresses();
+
+    // sort by event ID, keeping the last of any duplicates
+    std::vector<Long64_t> order(nentries);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&unsorted_ids](Long64_t a, Long64_t b) { return unsorted_ids[a] < unsorted_ids[b]; });
+    std::vector<Long64_t> unique;
+    for (std::size_t i = 0; i < order.size(); i++) {
+        if (i + 1 < order.size() && unsorted_ids[order[i + 1]] == unsorted_ids[order[i]]) {
+            continue;
+        }
+        unique.push_back(order[i]);
+    }
+
+    nrows = unique.size();
+    id_storage.resize(nrows);
+    entry_storage.resize(nrows);
+    weight_storage.resize(nrows * slots.size());
+    for (std::size_t r = 0; r < nrows; r++) {
+        id_storage[r] = unsorted_ids[unique[r]];
+        entry_storage[r] = unique[r];
+        for (std::size_t c = 0; c < slots.size(); c++) {
+            weight_storage[c * nrows + r] = unsorted_weights[c * nentries + unique[r]];
+        }
+    }
+    ids = id_storage.data();
+    entries = entry_storage.data();
+    weights = weight_storage.data();
+    return true;
+}
+
+// memory-map a saved store. Fails if the file is missing, truncated or was saved
+// with a different set of slots
+bool ac_weight_store::load(std::string filename, std::vector<int> expected_slots) {
+    auto fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(file_header)) {
+        close(fd);
+        return false;
+    }
+    auto mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    auto header = reinterpret_cast<const file_header *>(mapped);
+    auto expected_size = sizeof(file_header) + header->nrows * sizeof(Long64_t) * (2 + header->ncolumns);
+    bool valid = std::strncmp(header->magic, magic(), sizeof(header->magic)) == 0 && header->version == version &&
+                 header->ncolumns == expected_slots.size() && static_cast<std::size_t>(info.st_size) == expected_size &&
+                 std::equal(expected_slots.begin(), expected_slots.end(), header->slots);
+    if (!valid) {
+        munmap(mapped, info.st_size);
+        return false;
+    }
+
+    unmap();
+    id_storage.clear();
+    entry_storage.clear();
+    weight_storage.clear();
+    mapping = mapped;
+    mapping_size = info.st_size;
+    nrows = header->nrows;
+    slots = expected_slots;
+    ids = reinterpret_cast<const Long64_t *>(reinterpret_cast<const char *>(mapped) + sizeof(file_header));
+    entries = ids + nrows;
+    weights = reinterpret_cast<const double *>(entries + nrows);
+    return true;
+}
+
+// write the store to a temporary file and rename it into place, so concurrent
+// jobs never map a partial file
+bool ac_weight_store::save(std::string filename) const {
+    file_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic(), sizeof(header.magic));
+    header.version = version;
+    header.ncolumns = slots.size();
+    header.nrows = nrows;
+    std::copy(slots.begin(), slots.end(), header.slots);
+
+    auto temp = filename + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(ids), nrows * sizeof(Long64_t));
+        out.write(reinterpret_cast<const char *>(entries), nrows * sizeof(Long64_t));
+        out.write(reinterpret_cast<const char *>(weights), nrows * slots.size() * sizeof(double));
+        if (!out.good()) {
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// row of an event, or -1 if it isn't in the store. Event IDs are close to uniform
+// within a sample, so a few interpolation steps narrow the range before the
+// binary search
+long ac_weight_store::find(Long64_t id) const {
+    std::size_t low(0), high(nrows);  // search [low, high)
+    for (int step = 0; step < 4 && high - low > 64; step++) {
+        auto first = ids[low], last = ids[high - 1];
+        if (id < first || id > last) {
+            return -1;
+        }
+        auto guess = low + static_cast<std::size_t>(static_cast<double>(id - first) / (last - first) * (high - 1 - low));
+        if (ids[guess] < id) {
+            low = guess + 1;
+        } else if (ids[guess] > id) {
+            high = guess;
+        } else {
+            return guess;
+        }
+    }
+    auto found = std::lower_bound(ids + low, ids + high, id);
+    return found != ids + high && *found == id ? found - ids : -1;
+}
+
+void ac_weight_store::unmap() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+}
+
+// reads the weights of one event at a time from the weight tree, so memory
+// doesn't grow with the size of the sample. Events are usually requested in the
+// order of the weight tree, so the next entry is tried before the index
+class ac_weight_cursor {
+ private:
+    const ac_weight_store *index;
+    TFile *file;
+    TTree *tree;
+    TBranch *id_branch;
+    Long64_t entry, entries, eventID, loadedID;
+    std::vector<int> slots;
+    std::vector<Double_t> row;
+
+    bool load(Long64_t);
+
+ public:
+    ac_weight_cursor(std::string, const ac_weight_store *, std::vector<std::string>, std::vector<int>);
+    ~ac_weight_cursor();
+    ac_weight_cursor(const ac_weight_cursor &) = delete;
+    ac_weight_cursor &operator=(const ac_weight_cursor &) = delete;
+
+    bool seek(Long64_t);
+    std::size_t columns() const { return slots.size(); }
+    int slot(std::size_t column) const { return slots[column]; }
+    double weight(std::size_t column) const { return row[column]; }
+    ac_weight_view view() const { return ac_weight_view(row.data(), 1, slots.size(), slots.data()); }
+};
+
+ac_weight_cursor::ac_weight_cursor(std::string filename, const ac_weight_store *_index, std::vector<std::string> branches,
+                                   std::vector<int> _slots)
+    : index(_index),
+      file(TFile::Open(filename.c_str())),
+      tree(nullptr),
+      id_branch(nullptr),
+      entry(-1),
+      entries(0),
+      eventID(-1),
+      loadedID(-1),
+      slots(_slots),
+      row(_slots.size()) {
+    if (!file || file->IsZombie()) {
+        std::cerr << "Unable to open AC weights " << filename << std::endl;
+        return;
+    }
+    tree = reinterpret_cast<TTree *>(file->Get("weights"));
+    tree->SetBranchStatus("*", 0);
+    tree->SetBranchStatus("eventID", 1);
+    tree->SetBranchAddress("eventID", &eventID);
+    for (std::size_t c = 0; c < branches.size(); c++) {
+        tree->SetBranchStatus(branches.at(c).c_str(), 1);
+        tree->SetBranchAddress(branches.at(c).c_str(), &row.at(c));
+    }
+    id_branch = tree->GetBranch("eventID");
+    entries = tree->GetEntries();
+}
+
+ac_weight_cursor::~ac_weight_cursor() {
+    if (file) {
+        file->Close();
+    }
+}
+
+// load the weights of an event. Returns false if it isn't in the weight tree
+bool ac_weight_cursor::seek(Long64_t id) {
+    if (!tree) {
+        return false;
+    } else if (id == loadedID) {
+        return true;
+    }
+
+    // only read the event ID of the next entry until it matches
+    if (entry + 1 < entries) {
+        id_branch->GetEntry(entry + 1);
+        if (eventID == id) {
+            return load(entry + 1);
+        }
+    }
+
+    auto found = index->find(id);
+    return found >= 0 && load(index->entry(found));
+}
+
+bool ac_weight_cursor::load(Long64_t next) {
+    tree->GetEntry(next);
+    entry = next;
+    loadedID = eventID;
+    return true;
+}
+
+#endif  // INCLUDE_AC_WEIGHT_STORE_H_
@@ -0,0 +1,213 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_BRANCH_MANIFEST_H_
+#define INCLUDE_BRANCH_MANIFEST_H_
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "TBranch.h"
+#include "TTree.h"
+
+// ROOT leaf type code for each type a factory binds
+namespace manifest_utils {
+char leaf_type(Float_t *) { return 'F'; }
+char leaf_type(Double_t *) { return 'D'; }
+char leaf_type(Int_t *) { return 'I'; }
+char leaf_type(UInt_t *) { return 'i'; }
+char leaf_type(Long64_t *) { return 'L'; }
+char leaf_type(ULong64_t *) { return 'l'; }
+char leaf_type(Bool_t *) { return 'O'; }
+}  // namespace manifest_utils
+
+//////////////////////////////////////////////////////
+// Purpose: To record every input branch a factory  //
+// reads. The analyzer merges the manifests of all  //
+// factories, disables every other branch in the    //
+// ntuple and only caches the branches in use, so   //
+// GetEntry doesn't decompress unused branches.     //
+//                                                  //
+// Branches that are only needed once an event has  //
+// passed the preselection can be deferred. Events  //
+// are then read in two stages: load() reads the    //
+// selection branches and load_deferred() reads the //
+// rest for the events that survive.                //
+//                                                  //
+// The leaf type of each branch is recorded too, so //
+// tools like generate-ntuples can write a tree     //
+// with exactly the branches the factories read.    //
+//////////////////////////////////////////////////////
+class branch_manifest {
+ private:
+    std::vector<std::string> names, deferred;
+    std::vector<char> types;  // ROOT leaf type code of each branch in names
+    std::vector<TBranch *> selection_branches, deferred_branches;
+    TTree *tree;
+    Long64_t local_entry;
+
+    bool is_deferred(std::string name) const { return std::find(deferred.begin(), deferred.end(), name) != deferred.end(); }
+
+ public:
+    branch_manifest() : tree(nullptr), local_entry(-1) {}
+    ~branch_manifest() {}
+
+    template <typename T>
+    void bind(TTree *, std::string, T *);
+    template <typename T>
+    void defer(TTree *, std::string, T *);
+    void add(std::string, char type = 'F');
+    void add(const std::vector<std::string> &, char type = 'F');
+    void add(const branch_manifest &);
+    void defer(std::string, char type = 'F');
+    void defer(const std::vector<std::string> &, char type = 'F');
+    const std::vector<std::string> &getBranches() const { return names; }
+    char getType(std::string) const;
+    const std::vector<std::string> &getDeferredBranches() const { return deferred; }
+
+    void enable(TTree *);
+    Long64_t cache(TTree *);
+    void stage(TTree *);
+    Long64_t load(Long64_t);
+    Long64_t load_deferred();
+};
+
+// set the branch address and remember the branch
+template <typename T>
+void branch_manifest::bind(TTree *input, std::string name, T *address) {
+    input->SetBranchAddress(name.c_str(), address);
+    add(name, manifest_utils::leaf_type(address));
+}
+
+// set the branch address and only read the branch after the preselection
+template <typename T>
+void branch_manifest::defer(TTree *input, std::string name, T *address) {
+    input->SetBranchAddress(name.c_str(), address);
+    defer(name, manifest_utils::leaf_type(address));
+}
+
+void branch_manifest::add(std::string name, char type) {
+    if (std::find(names.begin(), names.end(), name) == names.end()) {
+        names.push_back(name);
+        types.push_back(type);
+    }
+}
+
+void branch_manifest::add(const std::vector<std::string> &others, char type) {
+    for (auto &name : others) {
+        add(name, type);
+    }
+}
+
+void branch_manifest::add(const branch_manifest &other) {
+    for (std::size_t i = 0; i < other.names.size(); i++) {
+        add(other.names.at(i), other.types.at(i));
+    }
+    for (auto &name : other.deferred) {
+        defer(name, other.getType(name));
+    }
+}
+
+void branch_manifest::defer(std::string name, char type) {
+    add(name, type);
+    if (!is_deferred(name)) {
+        deferred.push_back(name);
+    }
+}
+
+void branch_manifest::defer(const std::vector<std::string> &others, char type) {
+    for (auto &name : others) {
+        defer(name, type);
+    }
+}
+
+// leaf type code of a branch in the manifest, or 0 if it isn't in the manifest
+char branch_manifest::getType(std::string name) const {
+    auto found = std::find(names.begin(), names.end(), name);
+    return found == names.end() ? 0 : types.at(found - names.begin());
+}
+
+// disable every branch in the tree except the ones in the manifest
+void branch_manifest::enable(TTree *input) {
+    input->SetBranchStatus("*", 0);
+    for (auto &name : names) {
+        input->SetBranchStatus(name.c_str(), 1);
+    }
+}
+
+// size the TTreeCache to hold one cluster of the branches in the manifest and
+// register exactly those branches with it. Returns the cache size in bytes
+Long64_t branch_manifest::cache(TTree *input) {
+    Long64_t nentries = input->GetEntries();
+    if (nentries == 0) {
+        return 0;
+    }
+
+    auto clusters = input->GetClusterIterator(0);
+    Long64_t first = clusters.Next();
+    Long64_t cluster_entries = std::min(clusters.GetNextEntry(), nentries) - first;
+
+    Long64_t zip_bytes(0);
+    for (auto &name : names) {
+        auto branch = input->GetBranch(name.c_str());
+        if (branch) {
+            zip_bytes += branch->GetZipBytes();
+        }
+    }
+
+    // leave some headroom for baskets that straddle cluster boundaries
+    Long64_t cache_size = std::max(2 * zip_bytes * cluster_entries / nentries, Long64_t(1024 * 1024));
+    input->SetCacheSize(cache_size);
+    for (auto &name : names) {
+        input->AddBranchToCache(name.c_str(), true);
+    }
+    input->StopCacheLearningPhase();
+    return cache_size;
+}
+
+// find the branches to read in each stage. Must be called after all addresses are set
+void branch_manifest::stage(TTree *input) {
+    tree = input;
+    selection_branches.clear();
+    deferred_branches.clear();
+    for (auto &name : names) {
+        auto branch = input->GetBranch(name.c_str());
+        if (!branch) {
+            continue;
+        }
+        if (is_deferred(name)) {
+            deferred_branches.push_back(branch);
+        } else {
+            selection_branches.push_back(branch);
+        }
+    }
+}
+
+// read the selection branches for this entry. Returns the number of bytes decompressed
+Long64_t branch_manifest::load(Long64_t entry) {
+    local_entry = tree->LoadTree(entry);
+    if (local_entry < 0) {
+        return 0;
+    }
+
+    Long64_t bytes(0);
+    for (auto branch : selection_branches) {
+        bytes += branch->GetEntry(local_entry);
+    }
+    return bytes;
+}
+
+// read the deferred branches for the entry given to the last call to load
+Long64_t branch_manifest::load_deferred() {
+    if (local_entry < 0) {
+        return 0;
+    }
+
+    Long64_t bytes(0);
+    for (auto branch : deferred_branches) {
+        bytes += branch->GetEntry(local_entry);
+    }
+    return bytes;
+}
+
+#endif  // INCLUDE_BRANCH_MANIFEST_H_
@@ -0,0 +1,47 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_CLUSTER_RANGES_H_
+#define INCLUDE_CLUSTER_RANGES_H_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "TTree.h"
+
+typedef std::vector<std::pair<Long64_t, Long64_t>> entry_ranges;
+
+//////////////////////////////////////////////////////
+// Purpose: To split a TTree into contiguous entry  //
+// ranges [first, last) for parallel processing.    //
+// Ranges always start and stop on cluster          //
+// boundaries so no two workers decompress the same //
+// baskets. Each range holds roughly the same       //
+// number of entries.                               //
+//////////////////////////////////////////////////////
+entry_ranges get_cluster_ranges(TTree *tree, int nranges) {
+    entry_ranges ranges;
+    Long64_t nentries = tree->GetEntries();
+    if (nranges < 2 || nentries < nranges) {
+        ranges.push_back({0, nentries});
+        return ranges;
+    }
+
+    // close a range once it reaches its share of the entries
+    Long64_t first(0), start(0);
+    auto clusters = tree->GetClusterIterator(0);
+    while ((start = clusters.Next()) < nentries) {
+        Long64_t stop = std::min(clusters.GetNextEntry(), nentries);
+        if (ranges.size() + 1 < static_cast<std::size_t>(nranges) && stop * nranges >= nentries * static_cast<Long64_t>(ranges.size() + 1)) {
+            ranges.push_back({first, stop});
+            first = stop;
+        }
+    }
+
+    if (first < nentries) {
+        ranges.push_back({first, nentries});
+    }
+    return ranges;
+}
+
+#endif  // INCLUDE_CLUSTER_RANGES_H_
@@ -0,0 +1,278 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_CORRECTION_CACHE_H_
+#define INCLUDE_CORRECTION_CACHE_H_
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "TFile.h"
+
+//////////////////////////////////////////////////////
+// Purpose: To resolve the remote correction files  //
+// (pileup, scale factors, NNLOPS, AC weights) to   //
+// local copies so jobs don't all open them over    //
+// xrootd.                                          //
+//                                                  //
+// With a cache directory, each file is downloaded  //
+// once into objects/<content hash>.root and the    //
+// url is mapped to the hash in urls/<url hash>.    //
+// Both are written to a temporary file and renamed //
+// into place, so concurrent jobs never see a       //
+// partial file. A lock file keeps concurrent jobs  //
+// from downloading the same file at once, and a    //
+// lock older than lock_timeout is taken over.      //
+//                                                  //
+// With a mirror directory, files are read from     //
+// <mirror>/<path in url> and nothing is opened     //
+// over the network.                                //
+//                                                  //
+// Defaults come from the HTT_CORRECTION_CACHE and  //
+// HTT_CORRECTION_MIRROR environment variables.     //
+//////////////////////////////////////////////////////
+class correction_cache {
+ private:
+    std::string cache_dir, mirror_dir;
+    int lock_timeout;  // seconds to wait for another job's download before doing it ourselves
+
+    correction_cache();
+    std::string from_mirror(std::string) const;
+    std::string from_cache(std::string) const;
+    std::string read_index(std::string) const;
+    bool write_atomic(std::string, std::string) const;
+
+ public:
+    static correction_cache &get();
+    correction_cache(const correction_cache &) = delete;
+    correction_cache &operator=(const correction_cache &) = delete;
+
+    void configure(std::string, std::string);
+    std::string getCacheDir() const { return cache_dir; }
+    std::string getMirrorDir() const { return mirror_dir; }
+    bool isOffline() const { return !mirror_dir.empty(); }
+    std::string resolve(std::string);
+};
+
+namespace cache_utils {
+
+bool is_remote(std::string path) { return path.find("root://") == 0; }
+
+// 64-bit FNV-1a
+uint64_t hash(const char *data, std::size_t size, uint64_t seed = 14695981039346656037ull) {
+    for (std::size_t i = 0; i < size; i++) {
+        seed ^= static_cast<unsigned char>(data[i]);
+        seed *= 1099511628211ull;
+    }
+    return seed;
+}
+
+std::string to_hex(uint64_t value) {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+// hash of the file contents. Returns an empty string if the file can't be read
+std::string hash_file(std::string filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.good()) {
+        return "";
+    }
+    uint64_t value(14695981039346656037ull);
+    char buffer[1 << 16];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+        value = hash(buffer, file.gcount(), value);
+    }
+    return to_hex(value);
+}
+
+bool exists(std::string path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+// true if the file was last modified more than seconds ago
+bool older_than(std::string path, int seconds) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && std::difftime(std::time(nullptr), info.st_mtime) > seconds;
+}
+
+// equivalent of mkdir -p
+bool make_dirs(std::string path) {
+    for (std::size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+        auto dir = path.substr(0, pos);
+        if (mkdir(dir.c_str(), 0755) != 0 && !exists(dir)) {
+            return false;
+        }
+        if (pos == std::string::npos) {
+            return true;
+        }
+    }
+}
+
+// "root://host:port//store/..." -> "store/..."
+std::string url_path(std::string url) {
+    auto host_end = url.find('/', std::string("root://").size());
+    if (host_end == std::string::npos) {
+        return "";
+    }
+    return url.substr(url.find_first_not_of('/', host_end));
+}
+
+// name that is unique to this process and call
+std::string unique_suffix() {
+    static int counter(0);
+    return std::to_string(getpid()) + "." + std::to_string(counter++);
+}
+
+}  // namespace cache_utils
+
+correction_cache::correction_cache() : lock_timeout(600) {
+    auto env_cache = std::getenv("HTT_CORRECTION_CACHE");
+    auto env_mirror = std::getenv("HTT_CORRECTION_MIRROR");
+    configure(env_cache ? env_cache : "", env_mirror ? env_mirror : "");
+}
+
+correction_cache &correction_cache::get() {
+    static correction_cache cache;
+    return cache;
+}
+
+// override the cache and/or mirror directory. Empty strings keep the current setting
+void correction_cache::configure(std::string _cache_dir, std::string _mirror_dir) {
+    if (!_cache_dir.empty()) {
+        cache_dir = _cache_dir;
+    }
+    if (!_mirror_dir.empty()) {
+        mirror_dir = _mirror_dir;
+    }
+}
+
+// get the path to open for a correction file. Local paths and remote paths without
+// a cache or mirror are returned unchanged. Not thread-safe, so resolve all files
+// before starting any workers
+std::string correction_cache::resolve(std::string url) {
+    if (!cache_utils::is_remote(url)) {
+        return url;
+    } else if (isOffline()) {
+        return from_mirror(url);
+    } else if (!cache_dir.empty()) {
+        return from_cache(url);
+    }
+    return url;
+}
+
+std::string correction_cache::from_mirror(std::string url) const {
+    auto local = mirror_dir + "/" + cache_utils::url_path(url);
+    if (!cache_utils::exists(local)) {
+        std::cerr << "Correction file " << url << " is not in the mirror. Expected it at " << local << std::endl;
+    }
+    return local;
+}
+
+std::string correction_cache::from_cache(std::string url) const {
+    auto key = cache_utils::to_hex(cache_utils::hash(url.data(), url.size()));
+    auto index = cache_dir + "/urls/" + key;
+    if (!cache_utils::make_dirs(cache_dir + "/urls") || !cache_utils::make_dirs(cache_dir + "/objects") ||
+        !cache_utils::make_dirs(cache_dir + "/tmp")) {
+        std::cerr << "Unable to create correction cache in " << cache_dir << ". Reading " << url << " remotely" << std::endl;
+        return url;
+    }
+
+    // already cached
+    auto object = read_index(index);
+    if (!object.empty()) {
+        return object;
+    }
+
+    // only one job downloads a file at a time. The others wait for the index to appear.
+    // A lock older than the timeout was left by a job that died, so it is moved out of the
+    // way (only one job can rename it) and the waiting jobs race to create a new one.
+    // If a slow download is taken for a dead one, the file is only downloaded twice
+    auto lock = cache_dir + "/tmp/" + key + ".lock";
+    auto start = std::chrono::steady_clock::now();
+    int lock_fd;
+    while ((lock_fd = open(lock.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644)) < 0) {
+        if (cache_utils::older_than(lock, lock_timeout)) {
+            auto stale = lock + "." + cache_utils::unique_suffix() + ".stale";
+            if (std::rename(lock.c_str(), stale.c_str()) == 0) {
+                std::cerr << "Removing the stale lock on " << url << " left by another job" << std::endl;
+                std::remove(stale.c_str());
+                continue;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        object = read_index(index);
+        if (!object.empty()) {
+            return object;
+        }
+        if (std::chrono::steady_clock::now() - start > std::chrono::seconds(lock_timeout)) {
+            std::cerr << "Timed out waiting for another job to cache " << url << ". Downloading it again" << std::endl;
+            break;
+        }
+    }
+
+    // download to a temporary file and rename it to its content hash
+    auto download = cache_dir + "/tmp/" + key + "." + cache_utils::unique_suffix() + ".root";
+    if (!TFile::Cp(url.c_str(), download.c_str(), false)) {
+        std::cerr << "Unable to copy " << url << " into the correction cache. Reading it remotely" << std::endl;
+        std::remove(download.c_str());
+        object = url;
+    } else {
+        object = cache_dir + "/objects/" + cache_utils::hash_file(download) + ".root";
+        if (std::rename(download.c_str(), object.c_str()) != 0 || !write_atomic(index, object)) {
+            std::cerr << "Unable to add " << url << " to the correction cache" << std::endl;
+            std::remove(download.c_str());
+            object = cache_utils::exists(object) ? object : url;
+        }
+    }
+
+    if (lock_fd >= 0) {
+        close(lock_fd);
+        std::remove(lock.c_str());
+    }
+    return object;
+}
+
+// get the cached file for an index entry. Returns an empty string if it isn't cached
+std::string correction_cache::read_index(std::string index) const {
+    std::ifstream index_file(index);
+    std::string object;
+    if (!index_file.good() || !std::getline(index_file, object) || !cache_utils::exists(object)) {
+        return "";
+    }
+    return object;
+}
+
+// write the file contents to a temporary file and rename it into place
+bool correction_cache::write_atomic(std::string filename, std::string contents) const {
+    auto temp = cache_dir + "/tmp/index." + cache_utils::unique_suffix();
+    {
+        std::ofstream temp_file(temp, std::ios::out | std::ios::trunc);
+        temp_file << contents << std::endl;
+        if (!temp_file.good()) {
+            return false;
+        }
+    }
+    if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// path to open for a correction file
+std::string correction_file(std::string url) { return correction_cache::get().resolve(url); }
+
+#endif  // INCLUDE_CORRECTION_CACHE_H_
@@ -6,7 +6,9 @@
 #include <cmath>
 #include <string>
 #include <vector>
-#include "TLorentzVector.h"
+#include "./branch_manifest.h"
+#include "./four_vector.h"
+#include "./syst_descriptor.h"
 #include "TTree.h"
 
 class electron_factory;  // forward declare so it can befriend electrons
@@ -21,7 +23,7 @@ class electron {
     std::string name = "electron";
     Int_t gen_match;
     Float_t pt, eta, phi, mass, charge, px, py, pz, iso, gen_pt, gen_eta, gen_phi, gen_energy;
-    TLorentzVector p4;
+    four_vector p4;
 
  public:
     electron(Float_t, Float_t, Float_t, Float_t, Float_t);
@@ -29,7 +31,7 @@ class electron {
 
     // getters
     std::string getName() { return name; }
-    TLorentzVector getP4() { return p4; }
+    four_vector getP4() { return p4; }
     Float_t getPt() { return p4.Pt(); }
     Float_t getEta() { return p4.Eta(); }
     Float_t getPhi() { return p4.Phi(); }
@@ -43,7 +45,7 @@ class electron {
     Int_t getCharge() { return charge; }
 };
 
-// initialize member data and set TLorentzVector
+// initialize member data and set the four-vector
 electron::electron(Float_t Pt, Float_t Eta, Float_t Phi, Float_t M, Float_t Charge)
     : pt(Pt), eta(Eta), phi(Phi), mass(M), charge(Charge) {
     p4.SetPtEtaPhiM(pt, eta, phi, mass);
@@ -55,38 +57,47 @@ electron::electron(Float_t Pt, Float_t Eta, Float_t Phi, Float_t M, Float_t Char
 /////////////////////////////////////////////////
 class electron_factory {
  private:
-    std::string syst;
+    std::vector<syst_descriptor> systs;  // parsed once, selected with setSyst
+    std::size_t active;
     Int_t gen_match_1;
     Float_t px_1, py_1, pz_1, pt_1, eta_1, phi_1, m_1, e_1, q_1, mt_1, iso_1, eGenPt, eGenEta, eGenPhi, eGenEnergy;
     Float_t eCorrectedEt, eEnergyScaleUp, eEnergyScaleDown, eEnergySigmaUp, eEnergySigmaDown;
+    branch_manifest manifest;  // every input branch that is read
 
  public:
     electron_factory(TTree*, int, std::string);
+    electron_factory(TTree*, int, std::vector<std::string>);
     virtual ~electron_factory() {}
+    void setSyst(std::size_t idx) { active = idx; }
+    const branch_manifest &getManifest() const { return manifest; }
     electron run_factory();
 };
 
 // read data from tree into member variables
-electron_factory::electron_factory(TTree* input, int era, std::string _syst) : syst(_syst) {
-    input->SetBranchAddress("px_1", &px_1);
-    input->SetBranchAddress("py_1", &py_1);
-    input->SetBranchAddress("pz_1", &pz_1);
-    input->SetBranchAddress("pt_1", &pt_1);
-    input->SetBranchAddress("eta_1", &eta_1);
-    input->SetBranchAddress("phi_1", &phi_1);
-    input->SetBranchAddress("m_1", &m_1);
-    input->SetBranchAddress("q_1", &q_1);
-    input->SetBranchAddress("eRelPFIsoRho", &iso_1);
-    input->SetBranchAddress("gen_match_1", &gen_match_1);
-    input->SetBranchAddress("eGenPt", &eGenPt);
-    input->SetBranchAddress("eGenEta", &eGenEta);
-    input->SetBranchAddress("eGenPhi", &eGenPhi);
-    input->SetBranchAddress("eGenEnergy", &eGenEnergy);
-    input->SetBranchAddress("eCorrectedEt", &eCorrectedEt);
-    input->SetBranchAddress("eEnergyScaleUp", &eEnergyScaleUp);
-    input->SetBranchAddress("eEnergyScaleDown", &eEnergyScaleDown);
-    input->SetBranchAddress("eEnergySigmaUp", &eEnergySigmaUp);
-    input->SetBranchAddress("eEnergySigmaDown", &eEnergySigmaDown);
+electron_factory::electron_factory(TTree* input, int era, std::string _syst) : electron_factory(input, era, std::vector<std::string>{_syst}) {}
+
+// read data for several systematic shifts at once. Shifts are selected with setSyst
+electron_factory::electron_factory(TTree* input, int era, std::vector<std::string> _systs)
+    : systs(_systs.begin(), _systs.end()), active(0) {
+    manifest.bind(input, "px_1", &px_1);
+    manifest.bind(input, "py_1", &py_1);
+    manifest.bind(input, "pz_1", &pz_1);
+    manifest.bind(input, "pt_1", &pt_1);
+    manifest.bind(input, "eta_1", &eta_1);
+    manifest.bind(input, "phi_1", &phi_1);
+    manifest.bind(input, "m_1", &m_1);
+    manifest.bind(input, "q_1", &q_1);
+    manifest.bind(input, "eRelPFIsoRho", &iso_1);
+    manifest.bind(input, "gen_match_1", &gen_match_1);
+    manifest.bind(input, "eGenPt", &eGenPt);
+    manifest.bind(input, "eGenEta", &eGenEta);
+    manifest.bind(input, "eGenPhi", &eGenPhi);
+    manifest.bind(input, "eGenEnergy", &eGenEnergy);
+    manifest.bind(input, "eCorrectedEt", &eCorrectedEt);
+    manifest.bind(input, "eEnergyScaleUp", &eEnergyScaleUp);
+    manifest.bind(input, "eEnergyScaleDown", &eEnergyScaleDown);
+    manifest.bind(input, "eEnergySigmaUp", &eEnergySigmaUp);
+    manifest.bind(input, "eEnergySigmaDown", &eEnergySigmaDown);
 }
 
 // create electron object and set member data
@@ -103,14 +114,11 @@ electron electron_factory::run_factory() {
     el.gen_energy = eGenEnergy;
 
     // Electron energy scale systematics (eCorrectedEt is already applied so divide it out)
-    if (syst == "EEScale_Up") {
-        el.p4 *= eEnergyScaleUp / eCorrectedEt;
-    } else if (syst == "EEScale_Down") {
-        el.p4 *= eEnergyScaleDown / eCorrectedEt;
-    } else if (syst == "EESigma_Up") {
-        el.p4 *= eEnergySigmaUp / eCorrectedEt;
-    } else if (syst == "EESigma_Down") {
-        el.p4 *= eEnergySigmaDown / eCorrectedEt;
+    const syst_descriptor& syst = systs[active];
+    if (syst.is(syst_source::ees_scale)) {
+        el.p4 *= (syst.isUp() ? eEnergyScaleUp : eEnergyScaleDown) / eCorrectedEt;
+    } else if (syst.is(syst_source::ees_sigma)) {
+        el.p4 *= (syst.isUp() ? eEnergySigmaUp : eEnergySigmaDown) / eCorrectedEt;
     }
 
     return el;
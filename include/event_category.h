@@ -0,0 +1,26 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_EVENT_CATEGORY_H_
+#define INCLUDE_EVENT_CATEGORY_H_
+
+////////////////////////////////////////////////////////
+// Purpose: To describe the regions and event charge  //
+// of a selected event as bits. The analyzers set     //
+// them and slim_tree turns them into the is_signal,  //
+// is_antiTauIso, is_antiLepIso, OS and contamination //
+// flags. They can also be written together as the    //
+// "category" branch, so a region is selected with a  //
+// single integer test, i.e.                          //
+// (category & (signal | contamination)) == signal    //
+////////////////////////////////////////////////////////
+namespace event_category {
+enum : unsigned {
+    signal = 1u << 0,         // isolated lepton and tau
+    antiTauIso = 1u << 1,     // isolated lepton and anti-isolated tau (fake factor application region)
+    antiLepIso = 1u << 2,     // anti-isolated lepton
+    OS = 1u << 3,             // opposite-sign lepton and tau
+    contamination = 1u << 4,  // MC contaminating the embedded samples
+};
+}  // namespace event_category
+
+#endif  // INCLUDE_EVENT_CATEGORY_H_
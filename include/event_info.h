@@ -7,7 +7,9 @@
 #include <unordered_map>
 #include <vector>
 
+#include "./branch_manifest.h"
 #include "./qq2Hqq_uncert_scheme.h"
+#include "./shifted_branch.h"
 #include "./swiss_army_class.h"
 
 /////////////////////////////////////////
@@ -34,29 +36,35 @@ class event_info {
     Float_t Ele24LooseHPSTau30Pass, Ele24LooseHPSTau30TightIDPass;
     Bool_t PassEle24Tau30_2018;
 
-    Float_t m_sv, pt_sv;
+    shifted_branch m_sv, pt_sv;
     Float_t Phi, Phi1, costheta1, costheta2, costhetastar, Q2V1, Q2V2;  // MELA
     Float_t DCP_VBF, DCP_ggH;
     Float_t ME_sm_VBF, ME_sm_ggH, ME_sm_ggH_qqInit, ME_sm_WH, ME_sm_ZH, ME_ps_VBF, ME_ps_ggH, ME_ps_ggH_qqInit, ME_a2_VBF, ME_L1_VBF, ME_L1Zg_VBF,
         ME_bkg, ME_bkg1, ME_bkg2;
     Float_t njets;
-    std::string syst;
+    std::vector<std::string> systs;
+    std::vector<syst_descriptor> descriptors;  // systs, parsed once
+    std::size_t active;
 
     bool isEmbed;
     int era;
     lepton lep;
-    std::unordered_map<std::string, int> unc_map;
     std::unordered_map<std::string, std::string> syst_name_map;
+    branch_manifest manifest;  // every input branch that is read
 
    public:
     event_info(TTree*, lepton, int, bool, std::string);
+    event_info(TTree*, lepton, int, bool, std::vector<std::string>);
     virtual ~event_info() {}
     void setEmbed() { isEmbed = true; }
     void setNjets(Float_t _njets) { njets = _njets; }  // must be set in event loop
     void setRivets(TTree*);
+    void setSyst(std::size_t);
+    const branch_manifest &getManifest() const { return manifest; }
     std::string fix_syst_string(std::string);
-    Float_t getMSV() { return m_sv; }
-    Float_t getPtSV() { return pt_sv; }
+    std::string get_sv_suffix(std::string);
+    Float_t getMSV() { return m_sv.get(active); }
+    Float_t getPtSV() { return pt_sv.get(active); }
 
     // tautau Trigger Info
     Bool_t getPassElEmbedCross();
@@ -131,8 +139,8 @@ class event_info {
     Float_t getNjetsRivet() { return Rivet_nJets30; }
     Float_t getHiggsPtRivet() { return Rivet_higgsPt; }
     Float_t getJetPtRivet() { return Rivet_stage1_cat_pTjet30GeV; }
-    Float_t getRivetUnc(std::vector<double>, std::string);
-    Float_t getVBFTheoryUnc(std::string);
+    Float_t getRivetUnc(const std::vector<double> &, const syst_descriptor &);
+    Float_t getVBFTheoryUnc(const syst_descriptor &);
 
     // Prefiring Weight
     Float_t getPrefiringWeight();
@@ -161,126 +169,136 @@ std::string event_info::fix_syst_string(std::string syst) {
     return base;
 }
 
-// read data from trees into member variables
-event_info::event_info(TTree* input, lepton _lep, int _era, bool isMadgraph, std::string _syst)
-    : sm_weight_nlo(1.),
-      mm_weight_nlo(1.),
-      ps_weight_nlo(1.),
-      isEmbed(false),
-      era(_era),
-      syst(_syst),
-      lep(_lep),
-      unc_map{{"Rivet0_Up", 0}, {"Rivet0_Down", 0}, {"Rivet1_Up", 1}, {"Rivet1_Down", 1}, {"Rivet2_Up", 2}, {"Rivet2_Down", 2},
-              {"Rivet3_Up", 3}, {"Rivet3_Down", 3}, {"Rivet4_Up", 4}, {"Rivet4_Down", 4}, {"Rivet5_Up", 5}, {"Rivet5_Down", 5},
-              {"Rivet6_Up", 6}, {"Rivet6_Down", 6}, {"Rivet7_Up", 7}, {"Rivet7_Down", 7}, {"Rivet8_Up", 8}, {"Rivet8_Down", 8}} {
+// find the suffix of the SVFit branches for this systematic
+std::string event_info::get_sv_suffix(std::string syst) {
     auto end = std::string::npos;
-    std::string m_sv_name("m_sv"), pt_sv_name("pt_sv");
     if (syst.find("efaket_es") != end || syst.find("mfaket_es") != end) {  // lepton faking tau ES
-        m_sv_name += fix_syst_string(syst);
-        pt_sv_name += fix_syst_string(syst);
+        return fix_syst_string(syst);
     } else if (syst.find("tracking") != end) {
         // Do nothing. Just making sure the DM0 in the name isn't picked
         // up by the line doing TES
     } else if ((syst.find("DM0") != end || syst.find("DM1") != end)) {  // genuine tau ES
-        m_sv_name += "_" + syst;
-        pt_sv_name += "_" + syst;
+        return "_" + syst;
     } else if (syst.find("UES") != end) {
-        m_sv_name += "_Jet" + syst;
-        pt_sv_name += "_Jet" + syst;
+        return "_Jet" + syst;
     } else if (syst.find("Jet") != end) {  // JECs
-        m_sv_name += "_" + syst;
-        pt_sv_name += "_" + syst;
+        return "_" + syst;
     } else if (syst.find("EES") != end || syst.find("MES") != end) {  // lepton ES
-        m_sv_name += "_" + syst;
-        pt_sv_name += "_" + syst;
+        return "_" + syst;
     } else if (syst.find("Recoil") != end) {  // recoil corrections
-        m_sv_name += "_" + syst;
-        pt_sv_name += "_" + syst;
-    } 
-
-    input->SetBranchAddress(pt_sv_name.c_str(), &pt_sv);
-    input->SetBranchAddress(m_sv_name.c_str(), &m_sv);
-    input->SetBranchAddress("D_CP_VBF", &DCP_VBF);
-    input->SetBranchAddress("D_CP_ggH", &DCP_ggH);
-    input->SetBranchAddress("Phi0", &Phi);
-    input->SetBranchAddress("Phi1", &Phi1);
-    input->SetBranchAddress("costheta1", &costheta1);
-    input->SetBranchAddress("costheta2", &costheta2);
-    input->SetBranchAddress("costhetastar", &costhetastar);
-    input->SetBranchAddress("Q2V1", &Q2V1);
-    input->SetBranchAddress("Q2V2", &Q2V2);
-    input->SetBranchAddress("ME_sm_VBF", &ME_sm_VBF);
-    input->SetBranchAddress("ME_sm_ggH", &ME_sm_ggH);
-    input->SetBranchAddress("ME_sm_ggH_qqInit", &ME_sm_ggH_qqInit);
-    input->SetBranchAddress("ME_sm_WH", &ME_sm_WH);
-    input->SetBranchAddress("ME_sm_ZH", &ME_sm_ZH);
-    input->SetBranchAddress("ME_ps_VBF", &ME_ps_VBF);
-    input->SetBranchAddress("ME_ps_ggH", &ME_ps_ggH);
-    input->SetBranchAddress("ME_ps_ggH_qqInit", &ME_ps_ggH_qqInit);
-    input->SetBranchAddress("ME_a2_VBF", &ME_a2_VBF);
-    input->SetBranchAddress("ME_L1_VBF", &ME_L1_VBF);
-    input->SetBranchAddress("ME_L1Zg_VBF", &ME_L1Zg_VBF);
-    input->SetBranchAddress("ME_bkg", &ME_bkg);
-    input->SetBranchAddress("ME_bkg1", &ME_bkg1);
-    input->SetBranchAddress("ME_bkg2", &ME_bkg2);
-    input->SetBranchAddress("evt", &evt);
-    input->SetBranchAddress("run", &run);
-    input->SetBranchAddress("lumi", &lumi);
-    input->SetBranchAddress("nvtx", &npv);
-    input->SetBranchAddress("nTruePU", &npu);
-    input->SetBranchAddress("genpX", &genpX);
-    input->SetBranchAddress("genpY", &genpY);
-    input->SetBranchAddress("genM", &genM);
-    input->SetBranchAddress("genpT", &genpT);
-    input->SetBranchAddress("tZTTGenDR", &genDR);
-    input->SetBranchAddress("numGenJets", &numGenJets);
-    input->SetBranchAddress("GenWeight", &genweight);
-    input->SetBranchAddress("prefiring_weight", &prefiring_weight);
-    input->SetBranchAddress("prefiring_weight_up", &prefiring_weight_up);
-    input->SetBranchAddress("prefiring_weight_down", &prefiring_weight_down);
-    input->SetBranchAddress("Flag_BadChargedCandidateFilter", &Flag_BadChargedCandidateFilter);
-    input->SetBranchAddress("Flag_BadPFMuonFilter", &Flag_BadPFMuonFilter);
-    input->SetBranchAddress("Flag_EcalDeadCellTriggerPrimitiveFilter", &Flag_EcalDeadCellTriggerPrimitiveFilter);
-    input->SetBranchAddress("Flag_HBHENoiseFilter", &Flag_HBHENoiseFilter);
-    input->SetBranchAddress("Flag_HBHENoiseIsoFilter", &Flag_HBHENoiseIsoFilter);
-    input->SetBranchAddress("Flag_badMuons", &Flag_badMuons);
-    input->SetBranchAddress("Flag_duplicateMuons", &Flag_duplicateMuons);
-    input->SetBranchAddress("Flag_ecalBadCalibFilter", &Flag_ecalBadCalibFilter);
-    input->SetBranchAddress("Flag_eeBadScFilter", &Flag_eeBadScFilter);
-    input->SetBranchAddress("Flag_globalSuperTightHalo2016Filter", &Flag_globalSuperTightHalo2016Filter);
-    input->SetBranchAddress("Flag_globalTightHalo2016Filter", &Flag_globalTightHalo2016Filter);
-    input->SetBranchAddress("Flag_goodVertices", &Flag_goodVertices);
-    input->SetBranchAddress("muVetoZTTp001dxyzR0", &muVetoZTTp001dxyzR0);
-    input->SetBranchAddress("eVetoZTTp001dxyzR0", &eVetoZTTp001dxyzR0);
-    input->SetBranchAddress("dimuonVeto", &dimuonVeto);
-    input->SetBranchAddress("dielectronVeto", &dielectronVeto);
+        return "_" + syst;
+    }
+    return "";
+}
+
+// read data from trees into member variables
+event_info::event_info(TTree* input, lepton _lep, int _era, bool isMadgraph, std::string _syst)
+    : event_info(input, _lep, _era, isMadgraph, std::vector<std::string>{_syst}) {}
+
+// read data for several systematic shifts at once. Shifts are selected with setSyst
+event_info::event_info(TTree* input, lepton _lep, int _era, bool isMadgraph, std::vector<std::string> _systs)
+    : sm_weight_nlo(1.),
+      mm_weight_nlo(1.),
+      ps_weight_nlo(1.),
+      systs(_systs),
+      descriptors(_systs.begin(), _systs.end()),
+      active(0),
+      isEmbed(false),
+      era(_era),
+      lep(_lep) {
+    std::vector<std::string> m_sv_names, pt_sv_names;
+    for (auto& shift : systs) {
+        m_sv_names.push_back("m_sv" + get_sv_suffix(shift));
+        pt_sv_names.push_back("pt_sv" + get_sv_suffix(shift));
+    }
+
+    // SVFit, MELA, matrix elements and generator info are deferred until an event
+    // passes the preselection (see branch_manifest)
+    pt_sv.bind(input, pt_sv_names);
+    manifest.defer(pt_sv_names);
+    m_sv.bind(input, m_sv_names);
+    manifest.defer(m_sv_names);
+    manifest.defer(input, "D_CP_VBF", &DCP_VBF);
+    manifest.defer(input, "D_CP_ggH", &DCP_ggH);
+    manifest.defer(input, "Phi0", &Phi);
+    manifest.defer(input, "Phi1", &Phi1);
+    manifest.defer(input, "costheta1", &costheta1);
+    manifest.defer(input, "costheta2", &costheta2);
+    manifest.defer(input, "costhetastar", &costhetastar);
+    manifest.defer(input, "Q2V1", &Q2V1);
+    manifest.defer(input, "Q2V2", &Q2V2);
+    manifest.defer(input, "ME_sm_VBF", &ME_sm_VBF);
+    manifest.defer(input, "ME_sm_ggH", &ME_sm_ggH);
+    manifest.defer(input, "ME_sm_ggH_qqInit", &ME_sm_ggH_qqInit);
+    manifest.defer(input, "ME_sm_WH", &ME_sm_WH);
+    manifest.defer(input, "ME_sm_ZH", &ME_sm_ZH);
+    manifest.defer(input, "ME_ps_VBF", &ME_ps_VBF);
+    manifest.defer(input, "ME_ps_ggH", &ME_ps_ggH);
+    manifest.defer(input, "ME_ps_ggH_qqInit", &ME_ps_ggH_qqInit);
+    manifest.defer(input, "ME_a2_VBF", &ME_a2_VBF);
+    manifest.defer(input, "ME_L1_VBF", &ME_L1_VBF);
+    manifest.defer(input, "ME_L1Zg_VBF", &ME_L1Zg_VBF);
+    manifest.defer(input, "ME_bkg", &ME_bkg);
+    manifest.defer(input, "ME_bkg1", &ME_bkg1);
+    manifest.defer(input, "ME_bkg2", &ME_bkg2);
+    manifest.bind(input, "evt", &evt);
+    manifest.bind(input, "run", &run);
+    manifest.bind(input, "lumi", &lumi);
+    manifest.defer(input, "nvtx", &npv);
+    manifest.defer(input, "nTruePU", &npu);
+    manifest.defer(input, "genpX", &genpX);
+    manifest.defer(input, "genpY", &genpY);
+    manifest.defer(input, "genM", &genM);
+    manifest.defer(input, "genpT", &genpT);
+    manifest.defer(input, "tZTTGenDR", &genDR);
+    manifest.bind(input, "numGenJets", &numGenJets);
+    manifest.defer(input, "GenWeight", &genweight);
+    manifest.defer(input, "prefiring_weight", &prefiring_weight);
+    manifest.defer(input, "prefiring_weight_up", &prefiring_weight_up);
+    manifest.defer(input, "prefiring_weight_down", &prefiring_weight_down);
+    manifest.bind(input, "Flag_BadChargedCandidateFilter", &Flag_BadChargedCandidateFilter);
+    manifest.bind(input, "Flag_BadPFMuonFilter", &Flag_BadPFMuonFilter);
+    manifest.bind(input, "Flag_EcalDeadCellTriggerPrimitiveFilter", &Flag_EcalDeadCellTriggerPrimitiveFilter);
+    manifest.bind(input, "Flag_HBHENoiseFilter", &Flag_HBHENoiseFilter);
+    manifest.bind(input, "Flag_HBHENoiseIsoFilter", &Flag_HBHENoiseIsoFilter);
+    manifest.bind(input, "Flag_badMuons", &Flag_badMuons);
+    manifest.bind(input, "Flag_duplicateMuons", &Flag_duplicateMuons);
+    manifest.bind(input, "Flag_ecalBadCalibFilter", &Flag_ecalBadCalibFilter);
+    manifest.bind(input, "Flag_eeBadScFilter", &Flag_eeBadScFilter);
+    manifest.bind(input, "Flag_globalSuperTightHalo2016Filter", &Flag_globalSuperTightHalo2016Filter);
+    manifest.bind(input, "Flag_globalTightHalo2016Filter", &Flag_globalTightHalo2016Filter);
+    manifest.bind(input, "Flag_goodVertices", &Flag_goodVertices);
+    manifest.bind(input, "muVetoZTTp001dxyzR0", &muVetoZTTp001dxyzR0);
+    manifest.bind(input, "eVetoZTTp001dxyzR0", &eVetoZTTp001dxyzR0);
+    manifest.bind(input, "dimuonVeto", &dimuonVeto);
+    manifest.bind(input, "dielectronVeto", &dielectronVeto);
 
     if (isMadgraph) {
-        input->SetBranchAddress("sm_weight_nlo", &sm_weight_nlo);
-        input->SetBranchAddress("mm_weight_nlo", &mm_weight_nlo);
-        input->SetBranchAddress("ps_weight_nlo", &ps_weight_nlo);
+        manifest.defer(input, "sm_weight_nlo", &sm_weight_nlo);
+        manifest.defer(input, "mm_weight_nlo", &mm_weight_nlo);
+        manifest.defer(input, "ps_weight_nlo", &ps_weight_nlo);
     }
 
     if (lep == lepton::ELECTRON) {
         if (era > 2016) {
-            input->SetBranchAddress("Ele24LooseTau30Pass", &Ele24LooseTau30Pass);
-            input->SetBranchAddress("eMatchesEle24Tau30Filter", &eMatchesEle24Tau30Filter);
-            input->SetBranchAddress("eMatchesEle24Tau30Path", &eMatchesEle24Tau30Path);
-            input->SetBranchAddress("tMatchesEle24Tau30Filter", &tMatchesEle24Tau30Filter);
-            input->SetBranchAddress("tMatchesEle24Tau30Path", &tMatchesEle24Tau30Path);
-            input->SetBranchAddress("eMatchesEle24HPSTau30Filter", &eMatchesEle24HPSTau30Filter);
-            input->SetBranchAddress("eMatchesEle24HPSTau30Path", &eMatchesEle24HPSTau30Path);
-            input->SetBranchAddress("tMatchesEle24HPSTau30Filter", &tMatchesEle24HPSTau30Filter);
-            input->SetBranchAddress("tMatchesEle24HPSTau30Path", &tMatchesEle24HPSTau30Path);
-            input->SetBranchAddress("Ele24LooseHPSTau30Pass", &Ele24LooseHPSTau30Pass);
-            input->SetBranchAddress("eMatchEmbeddedFilterEle24Tau30", &eMatchEmbeddedFilterEle24Tau30);
-            input->SetBranchAddress("tMatchEmbeddedFilterEle24Tau30", &tMatchEmbeddedFilterEle24Tau30);
+            manifest.bind(input, "Ele24LooseTau30Pass", &Ele24LooseTau30Pass);
+            manifest.bind(input, "eMatchesEle24Tau30Filter", &eMatchesEle24Tau30Filter);
+            manifest.bind(input, "eMatchesEle24Tau30Path", &eMatchesEle24Tau30Path);
+            manifest.bind(input, "tMatchesEle24Tau30Filter", &tMatchesEle24Tau30Filter);
+            manifest.bind(input, "tMatchesEle24Tau30Path", &tMatchesEle24Tau30Path);
+            manifest.bind(input, "eMatchesEle24HPSTau30Filter", &eMatchesEle24HPSTau30Filter);
+            manifest.bind(input, "eMatchesEle24HPSTau30Path", &eMatchesEle24HPSTau30Path);
+            manifest.bind(input, "tMatchesEle24HPSTau30Filter", &tMatchesEle24HPSTau30Filter);
+            manifest.bind(input, "tMatchesEle24HPSTau30Path", &tMatchesEle24HPSTau30Path);
+            manifest.bind(input, "Ele24LooseHPSTau30Pass", &Ele24LooseHPSTau30Pass);
+            manifest.bind(input, "eMatchEmbeddedFilterEle24Tau30", &eMatchEmbeddedFilterEle24Tau30);
+            manifest.bind(input, "tMatchEmbeddedFilterEle24Tau30", &tMatchEmbeddedFilterEle24Tau30);
         }
     } else if (lep == lepton::MUON) {
         if (isEmbed) {
-            input->SetBranchAddress("mMatchEmbeddedFilterMu20Tau27_2017", &mMatchEmbeddedFilterMu20Tau27_2017);
-            input->SetBranchAddress("mMatchEmbeddedFilterMu20Tau27_2018", &mMatchEmbeddedFilterMu20Tau27_2018);
-            input->SetBranchAddress("tMatchEmbeddedFilterMu20HPSTau27", &tMatchEmbeddedFilterMu20HPSTau27);
+            manifest.bind(input, "mMatchEmbeddedFilterMu20Tau27_2017", &mMatchEmbeddedFilterMu20Tau27_2017);
+            manifest.bind(input, "mMatchEmbeddedFilterMu20Tau27_2018", &mMatchEmbeddedFilterMu20Tau27_2018);
+            manifest.bind(input, "tMatchEmbeddedFilterMu20HPSTau27", &tMatchEmbeddedFilterMu20HPSTau27);
         }
     } else if (lep == lepton::EMU) {
         // no analyzer yet
@@ -289,68 +307,44 @@ event_info::event_info(TTree* input, lepton _lep, int _era, bool isMadgraph, std
     }
 }
 
+// switch to the systematic shift at position idx of the list given to the constructor
+void event_info::setSyst(std::size_t idx) {
+    active = idx;
+}
+
 Float_t event_info::getPrefiringWeight() {
-    if (syst == "prefiring_up") {
-        return prefiring_weight_up;
-    } else if (syst == "prefiring_down") {
-        return prefiring_weight_down;
+    auto &syst = descriptors[active];
+    if (syst.is(syst_source::prefiring)) {
+        return syst.isUp() ? prefiring_weight_up : prefiring_weight_down;
     }
     return prefiring_weight;
 }
 
 void event_info::setRivets(TTree* input) {
-    input->SetBranchAddress("Rivet_nJets30", &Rivet_nJets30);
-    input->SetBranchAddress("Rivet_higgsPt", &Rivet_higgsPt);
-    input->SetBranchAddress("Rivet_stage1_cat_pTjet30GeV", &Rivet_stage1_cat_pTjet30GeV);
+    manifest.defer(input, "Rivet_nJets30", &Rivet_nJets30);
+    manifest.defer(input, "Rivet_higgsPt", &Rivet_higgsPt);
+    manifest.defer(input, "Rivet_stage1_cat_pTjet30GeV", &Rivet_stage1_cat_pTjet30GeV);
 }
 
-Float_t event_info::getRivetUnc(std::vector<double> uncs, std::string syst) {
-    if (syst.find("Rivet") != std::string::npos) {
-        int index = unc_map[syst];
-        if (syst.find("Up") != std::string::npos) {
-            return uncs.at(index);
-        } else {
-            return -1 * uncs.at(index);
-        }
+// shift from one of the ggH (WG1) uncertainty sources
+Float_t event_info::getRivetUnc(const std::vector<double> &uncs, const syst_descriptor &syst) {
+    if (!syst.is(syst_source::ggh_rivet)) {
+        return 0.;
     }
+    return syst.isUp() ? uncs.at(syst.getIndex()) : -1 * uncs.at(syst.getIndex());
 }
 
-Float_t event_info::getVBFTheoryUnc(std::string syst) {
-    if (syst.find("VBF_Rivet") == std::string::npos) {
+Float_t event_info::getVBFTheoryUnc(const syst_descriptor &syst) {
+    if (!syst.is(syst_source::vbf_rivet) || syst.getIndex() < 0 || syst.getIndex() > 9) {
         return 1.;
     }
 
     double shift(1.0);
-    if (syst.find("_Down") != std::string::npos) {
+    if (syst.isDown()) {
         shift *= -1.;
     }
 
-    int source;
-    if (syst.find("VBF_Rivet0") != std::string::npos) {
-        source = 0;
-    } else if (syst.find("VBF_Rivet1") != std::string::npos) {
-        source = 1;
-    } else if (syst.find("VBF_Rivet2") != std::string::npos) {
-        source = 2;
-    } else if (syst.find("VBF_Rivet3") != std::string::npos) {
-        source = 3;
-    } else if (syst.find("VBF_Rivet4") != std::string::npos) {
-        source = 4;
-    } else if (syst.find("VBF_Rivet5") != std::string::npos) {
-        source = 5;
-    } else if (syst.find("VBF_Rivet6") != std::string::npos) {
-        source = 6;
-    } else if (syst.find("VBF_Rivet7") != std::string::npos) {
-        source = 7;
-    } else if (syst.find("VBF_Rivet8") != std::string::npos) {
-        source = 8;
-    } else if (syst.find("VBF_Rivet9") != std::string::npos) {
-        source = 9;
-    } else {
-        return 1.;
-    }
-
-    return vbf_uncert_stage_1_1(source, static_cast<int>(Rivet_stage1_cat_pTjet30GeV), shift);
+    return vbf_uncert_stage_1_1(syst.getIndex(), static_cast<int>(Rivet_stage1_cat_pTjet30GeV), shift);
 }
 
 Bool_t event_info::getPassFlags(Bool_t isData) {
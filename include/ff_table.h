@@ -0,0 +1,78 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_FF_TABLE_H_
+#define INCLUDE_FF_TABLE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "TF1.h"
+
+//////////////////////////////////////////////////////
+// Purpose: To evaluate a fake factor or closure    //
+// TF1 from a table instead of going through the    //
+// formula interpreter for every event. The TF1 is  //
+// sampled once on a uniform grid over the range    //
+// apply_ff can ask for and is linearly             //
+// interpolated between grid points.                //
+//                                                  //
+// The table is checked against the TF1 half way    //
+// between grid points when it is built. If it is   //
+// off by more than the tolerance, or the input is  //
+// outside of the grid, the TF1 is used instead, so //
+// the result never depends on the table being good //
+// enough.                                          //
+//////////////////////////////////////////////////////
+class ff_table {
+ private:
+    TF1 *function;
+    double min, max, inv_step, deviation;
+    bool valid;
+    std::vector<double> values;  // at min + i * step for i = 0..nbins
+
+ public:
+    ff_table(TF1 *, double, double, int, double);
+    ~ff_table() {}
+
+    std::string getName() const { return function == nullptr ? "" : function->GetName(); }
+    TF1 *getFunction() const { return function; }
+    double getDeviation() const { return deviation; }  // largest relative difference to the TF1
+    bool isValid() const { return valid; }
+
+    double Eval(double x) const {
+        if (!valid || x < min || x > max) {
+            return function->Eval(x);
+        }
+        double pos = (x - min) * inv_step;
+        auto lower = std::min(static_cast<std::size_t>(pos), values.size() - 2);
+        return values[lower] + (pos - lower) * (values[lower + 1] - values[lower]);
+    }
+};
+
+// sample the function on nbins + 1 points in [_min, _max]
+ff_table::ff_table(TF1 *_function, double _min, double _max, int nbins = 1000, double tolerance = 1e-4)
+    : function(_function), min(_min), max(_max), inv_step(nbins / (_max - _min)), deviation(0.), valid(false) {
+    if (function == nullptr || nbins < 1 || max <= min) {
+        return;
+    }
+
+    double step = (max - min) / nbins;
+    values.reserve(nbins + 1);
+    for (int i = 0; i <= nbins; i++) {
+        values.push_back(function->Eval(min + i * step));
+    }
+
+    // linear interpolation is worst in the middle of a bin
+    valid = true;
+    for (int i = 0; i < nbins; i++) {
+        double x = min + (i + 0.5) * step;
+        double expected = function->Eval(x);
+        double diff = std::fabs(Eval(x) - expected) / std::max(std::fabs(expected), 1e-6);
+        deviation = std::max(deviation, diff);
+    }
+    valid = std::isfinite(deviation) && deviation <= tolerance;
+}
+
+#endif  // INCLUDE_FF_TABLE_H_
@@ -0,0 +1,136 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_FOUR_VECTOR_H_
+#define INCLUDE_FOUR_VECTOR_H_
+
+#include <cmath>
+#include <type_traits>
+
+template <typename T>
+class PxPyPzE;
+
+///////////////////////////////////////////////////////
+// Purpose: A plain four-vector stored the way the   //
+// ntuples store objects: pT, eta, phi and mass.     //
+// Unlike TLorentzVector it has no vtable and no     //
+// TObject base, so it is trivially copyable and the //
+// objects can hand it out by value for free.        //
+//                                                   //
+// Px, Py, Pz and E are only computed when asked for //
+// and adding two vectors gives a PxPyPzE, which     //
+// keeps summing in Cartesian coordinates and only   //
+// goes back to pT/eta/phi/mass for the result.      //
+///////////////////////////////////////////////////////
+template <typename T>
+class PtEtaPhiM {
+ private:
+    T pt, eta, phi, m;
+
+ public:
+    PtEtaPhiM() : pt(0), eta(0), phi(0), m(0) {}
+    PtEtaPhiM(T _pt, T _eta, T _phi, T _m) : pt(_pt), eta(_eta), phi(_phi), m(_m) {}
+    PtEtaPhiM(const PxPyPzE<T> &v) : pt(v.Pt()), eta(v.Eta()), phi(v.Phi()), m(v.M()) {}  // NOLINT: sums convert implicitly
+
+    void SetPtEtaPhiM(T _pt, T _eta, T _phi, T _m) {
+        pt = _pt;
+        eta = _eta;
+        phi = _phi;
+        m = _m;
+    }
+
+    T Pt() const { return pt; }
+    T Eta() const { return eta; }
+    T Phi() const { return phi; }
+    T M() const { return m; }
+
+    // Cartesian components, computed on demand
+    T Px() const { return pt * std::cos(phi); }
+    T Py() const { return pt * std::sin(phi); }
+    T Pz() const { return pt * std::sinh(eta); }
+    T P() const { return pt * std::cosh(eta); }
+    T E() const {
+        T p(P());
+        return std::sqrt(std::fmax(p * p + m * std::fabs(m), T(0)));  // negative masses follow TLorentzVector
+    }
+    PxPyPzE<T> Cartesian() const { return PxPyPzE<T>(Px(), Py(), Pz(), E()); }
+
+    // phi difference in [-pi, pi)
+    T DeltaPhi(const PtEtaPhiM &other) const {
+        T dphi(phi - other.phi);
+        while (dphi >= T(M_PI)) {
+            dphi -= T(2 * M_PI);
+        }
+        while (dphi < -T(M_PI)) {
+            dphi += T(2 * M_PI);
+        }
+        return dphi;
+    }
+
+    T DeltaR(const PtEtaPhiM &other) const {
+        T deta(eta - other.eta), dphi(DeltaPhi(other));
+        return std::sqrt(deta * deta + dphi * dphi);
+    }
+
+    // scales every component like TLorentzVector::operator*=. A negative
+    // factor flips the direction of the momentum.
+    PtEtaPhiM &operator*=(T scale) {
+        if (scale < 0) {
+            scale = -scale;
+            eta = -eta;
+            phi = phi > 0 ? phi - T(M_PI) : phi + T(M_PI);
+        }
+        pt *= scale;
+        m *= scale;
+        return *this;
+    }
+
+    PxPyPzE<T> operator+(const PtEtaPhiM &other) const { return Cartesian() + other.Cartesian(); }
+    PxPyPzE<T> operator+(const PxPyPzE<T> &other) const { return Cartesian() + other; }
+};
+
+/////////////////////////////////////////////////////
+// Purpose: The Cartesian form of a four-vector,   //
+// used to accumulate sums of PtEtaPhiM objects.   //
+/////////////////////////////////////////////////////
+template <typename T>
+class PxPyPzE {
+ private:
+    T px, py, pz, e;
+
+ public:
+    PxPyPzE() : px(0), py(0), pz(0), e(0) {}
+    PxPyPzE(T _px, T _py, T _pz, T _e) : px(_px), py(_py), pz(_pz), e(_e) {}
+
+    T Px() const { return px; }
+    T Py() const { return py; }
+    T Pz() const { return pz; }
+    T E() const { return e; }
+    T Pt() const { return std::sqrt(px * px + py * py); }
+    T Phi() const { return px == 0 && py == 0 ? T(0) : std::atan2(py, px); }
+
+    // same conventions as TLorentzVector for objects along the beam
+    T Eta() const {
+        T pt(Pt());
+        if (pt > 0) {
+            return std::asinh(pz / pt);
+        }
+        return pz == 0 ? T(0) : (pz > 0 ? T(10e10) : T(-10e10));
+    }
+
+    // negative for space-like vectors, like TLorentzVector
+    T M() const {
+        T m2(e * e - px * px - py * py - pz * pz);
+        return m2 < 0 ? -std::sqrt(-m2) : std::sqrt(m2);
+    }
+
+    PxPyPzE operator+(const PxPyPzE &other) const { return PxPyPzE(px + other.px, py + other.py, pz + other.pz, e + other.e); }
+    PxPyPzE operator+(const PtEtaPhiM<T> &other) const { return *this + other.Cartesian(); }
+};
+
+// the objects keep TLorentzVector's double precision
+typedef PtEtaPhiM<double> four_vector;
+
+static_assert(std::is_trivially_copyable<four_vector>::value, "four_vector must stay trivially copyable");
+static_assert(std::is_trivially_copyable<PxPyPzE<double>>::value, "PxPyPzE must stay trivially copyable");
+
+#endif  // INCLUDE_FOUR_VECTOR_H_
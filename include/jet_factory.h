@@ -4,31 +4,38 @@
 #define INCLUDE_JET_FACTORY_H_
 
 #include <algorithm>
+#include <array>
 #include <string>
 #include <vector>
 
-#include "TLorentzVector.h"
+#include "./branch_manifest.h"
+#include "./four_vector.h"
+#include "./shifted_branch.h"
 #include "TRandom3.h"
 #include "TTree.h"
 
 class jet {
    private:
     Float_t pt, eta, phi, bscore, flavor;
-    TLorentzVector p4;
+    four_vector p4;
 
    public:
+    jet() : pt(0), eta(0), phi(0), bscore(0), flavor(-9999) {}
     jet(Float_t, Float_t, Float_t, Float_t, Float_t);
-    virtual ~jet() {}
-
-    Float_t getPt() { return pt; }
-    Float_t getEta() { return eta; }
-    Float_t getPhi() { return phi; }
-    Float_t getBScore() { return bscore; }
-    Float_t getFlavor() { return flavor; }
-    TLorentzVector getP4() { return p4; }
+
+    Float_t getPt() const { return pt; }
+    Float_t getEta() const { return eta; }
+    Float_t getPhi() const { return phi; }
+    Float_t getBScore() const { return bscore; }
+    Float_t getFlavor() const { return flavor; }
+    four_vector getP4() const { return p4; }
 };
 
-// initialize member data and set TLorentzVector
+// the ntuples only store the two leading jets and b-jets, so they are
+// kept in place and overwritten for each event
+typedef std::array<jet, 2> jet_collection;
+
+// initialize member data and set the four-vector
 jet::jet(Float_t Pt, Float_t Eta, Float_t Phi, Float_t _bscore, Float_t Flavor = -9999)
     : pt(Pt), eta(Eta), phi(Phi), bscore(_bscore), flavor(Flavor) {
     p4.SetPtEtaPhiM(Pt, Eta, Phi, 0.);
@@ -36,21 +43,26 @@ jet::jet(Float_t Pt, Float_t Eta, Float_t Phi, Float_t _bscore, Float_t Flavor =
 
 class jet_factory {
    private:
-    Float_t mjj;
+    shifted_branch mjj, njets;
+    std::size_t active;
     Float_t jpt_1, jeta_1, jphi_1, jcsv_1;
     Float_t jpt_2, jeta_2, jphi_2, jcsv_2;
     Float_t bpt_1, beta_1, bphi_1, bcsv_1, bflavor_1, bscore_1;
     Float_t bpt_2, beta_2, bphi_2, bcsv_2, bflavor_2, bscore_2;
     Float_t topQuarkPt1, topQuarkPt2, temp_njets;
-    Float_t Nbtag, njetspt20, njets, nbtag_loose, nbtag_medium;
+    Float_t Nbtag, njetspt20, nbtag_loose, nbtag_medium;
     Int_t nbtag;
     Float_t bweight;
-    std::vector<jet> plain_jets, btag_jets;
+    jet_collection plain_jets, btag_jets;
     std::unordered_map<std::string, std::string> syst_name_map;
+    branch_manifest manifest;  // every input branch that is read
 
    public:
     jet_factory(TTree *, int, std::string);
+    jet_factory(TTree *, int, std::vector<std::string>);
     virtual ~jet_factory() {}
+    void setSyst(std::size_t idx) { active = idx; }
+    const branch_manifest &getManifest() const { return manifest; }
     void run_factory();
     void promoteDemote(TH2F *, TH2F *, TH2F *, int);
     double bTagEventWeight(int, int);
@@ -60,19 +72,23 @@ class jet_factory {
     Float_t getNbtag() { return Nbtag; }
     Float_t getNbtagLoose() { return nbtag_loose; }
     Float_t getNbtagMedium() { return nbtag_medium; }
-    Float_t getNjets() { return njets; }
+    Float_t getNjets() { return njets.get(active); }
     Int_t getNjetPt20() { return njetspt20; }
-    Float_t getDijetMass() { return mjj; }
+    Float_t getDijetMass() { return mjj.get(active); }
     Float_t getTopPt1() { return topQuarkPt1; }
     Float_t getTopPt2() { return topQuarkPt2; }
     Float_t getBWeight() { return bweight; }
-    std::vector<jet> getJets() { return plain_jets; }
-    std::vector<jet> getBtagJets() { return btag_jets; }
+    const jet_collection &getJets() const { return plain_jets; }
+    const jet_collection &getBtagJets() const { return btag_jets; }
 };
 
 // read data from tree into member variables
-jet_factory::jet_factory(TTree *input, int era, std::string syst)
-    : syst_name_map{
+jet_factory::jet_factory(TTree *input, int era, std::string syst) : jet_factory(input, era, std::vector<std::string>{syst}) {}
+
+// read the jet variables for several systematic shifts at once. Shifts are selected with setSyst
+jet_factory::jet_factory(TTree *input, int era, std::vector<std::string> systs)
+    : active(0),
+      syst_name_map{
           {"JetRelSam_Up", "JetRelativeSampleUp"},
           {"JetRelSam_Down", "JetRelativeSampleDown"},
           {"JetRelBal_Up", "JetRelativeBalUp"},
@@ -80,17 +96,22 @@ jet_factory::jet_factory(TTree *input, int era, std::string syst)
           {"JetJER_Up", "JERUp"},
           {"JetJER_Down", "JERDown"},
       } {
-    std::string mjj_name("vbfMass"), njets_name("jetVeto30");
-    // if (era == 2017) {
-    //     mjj_name += "WoNoisyJets";
-    //     njets_name += "WoNoisyJets";
-    // }
-
+    std::vector<std::string> mjj_names, njets_names;
     auto end = std::string::npos;
-    if (syst.find("Jet") != end) {
-        auto syst_name = fix_syst_string(syst);
-        mjj_name += "_" + syst_name;
-        njets_name += "_" + syst_name;
+    for (auto &syst : systs) {
+        std::string mjj_name("vbfMass"), njets_name("jetVeto30");
+        // if (era == 2017) {
+        //     mjj_name += "WoNoisyJets";
+        //     njets_name += "WoNoisyJets";
+        // }
+
+        if (syst.find("Jet") != end) {
+            auto syst_name = fix_syst_string(syst);
+            mjj_name += "_" + syst_name;
+            njets_name += "_" + syst_name;
+        }
+        mjj_names.push_back(mjj_name);
+        njets_names.push_back(njets_name);
     }
 
     std::string btag_string("2016"), bweight_string("bweight_");
@@ -105,49 +126,44 @@ jet_factory::jet_factory(TTree *input, int era, std::string syst)
         bweight_string += "2018";
     }
 
-    input->SetBranchAddress(mjj_name.c_str(), &mjj);
-    input->SetBranchAddress(njets_name.c_str(), &njets);
-    input->SetBranchAddress("nbtag", &nbtag);
-    input->SetBranchAddress(("bjetDeepCSVVeto20Loose_" + btag_string + "_DR0p5").c_str(), &nbtag_loose);
-    input->SetBranchAddress(("bjetDeepCSVVeto20Medium_" + btag_string + "_DR0p5").c_str(), &nbtag_medium);
+    mjj.bind(input, mjj_names);
+    manifest.add(mjj_names);
+    njets.bind(input, njets_names);
+    manifest.add(njets_names);
+    manifest.bind(input, "nbtag", &nbtag);
+    manifest.bind(input, "bjetDeepCSVVeto20Loose_" + btag_string + "_DR0p5", &nbtag_loose);
+    manifest.bind(input, "bjetDeepCSVVeto20Medium_" + btag_string + "_DR0p5", &nbtag_medium);
     // input->SetBranchAddress(bweight_string.c_str(), &bweight);
-    input->SetBranchAddress("j1pt", &jpt_1);
-    input->SetBranchAddress("j1eta", &jeta_1);
-    input->SetBranchAddress("j1phi", &jphi_1);
-    input->SetBranchAddress("j1csv", &jcsv_1);
-    input->SetBranchAddress("j2pt", &jpt_2);
-    input->SetBranchAddress("j2eta", &jeta_2);
-    input->SetBranchAddress("j2phi", &jphi_2);
-    input->SetBranchAddress("j2csv", &jcsv_2);
-    input->SetBranchAddress("jb1pt", &bpt_1);
-    input->SetBranchAddress("jb1eta", &beta_1);
-    input->SetBranchAddress("jb1phi", &bphi_1);
-    input->SetBranchAddress("deepcsvb1_btagscore", &bscore_1);
-    input->SetBranchAddress("jb1hadronflavor", &bflavor_1);
-    input->SetBranchAddress("jb2pt", &bpt_2);
-    input->SetBranchAddress("jb2eta", &beta_2);
-    input->SetBranchAddress("jb2phi", &bphi_2);
-    input->SetBranchAddress("deepcsvb2_btagscore", &bscore_2);
-    input->SetBranchAddress("jb2hadronflavor", &bflavor_2);
-    input->SetBranchAddress("topQuarkPt1", &topQuarkPt1);
-    input->SetBranchAddress("topQuarkPt2", &topQuarkPt2);
+    manifest.bind(input, "j1pt", &jpt_1);
+    manifest.bind(input, "j1eta", &jeta_1);
+    manifest.bind(input, "j1phi", &jphi_1);
+    manifest.bind(input, "j1csv", &jcsv_1);
+    manifest.bind(input, "j2pt", &jpt_2);
+    manifest.bind(input, "j2eta", &jeta_2);
+    manifest.bind(input, "j2phi", &jphi_2);
+    manifest.bind(input, "j2csv", &jcsv_2);
+    manifest.bind(input, "jb1pt", &bpt_1);
+    manifest.bind(input, "jb1eta", &beta_1);
+    manifest.bind(input, "jb1phi", &bphi_1);
+    manifest.bind(input, "deepcsvb1_btagscore", &bscore_1);
+    manifest.bind(input, "jb1hadronflavor", &bflavor_1);
+    manifest.bind(input, "jb2pt", &bpt_2);
+    manifest.bind(input, "jb2eta", &beta_2);
+    manifest.bind(input, "jb2phi", &bphi_2);
+    manifest.bind(input, "deepcsvb2_btagscore", &bscore_2);
+    manifest.bind(input, "jb2hadronflavor", &bflavor_2);
+    manifest.bind(input, "topQuarkPt1", &topQuarkPt1);
+    manifest.bind(input, "topQuarkPt2", &topQuarkPt2);
 }
 
-// initialize member data and set TLorentzVector
+// build the jets for this event in place, without touching the heap
 void jet_factory::run_factory() {
-    plain_jets.clear();
-    btag_jets.clear();
-
     Nbtag = nbtag;
 
-    jet j1(jpt_1, jeta_1, jphi_1, jcsv_1);
-    jet j2(jpt_2, jeta_2, jphi_2, jcsv_2);
-    jet b1(bpt_1, beta_1, bphi_1, bscore_1, bflavor_1);
-    jet b2(bpt_2, beta_2, bphi_2, bscore_2, bflavor_2);
-    plain_jets.push_back(j1);
-    plain_jets.push_back(j2);
-    btag_jets.push_back(b1);
-    btag_jets.push_back(b2);
+    plain_jets[0] = jet(jpt_1, jeta_1, jphi_1, jcsv_1);
+    plain_jets[1] = jet(jpt_2, jeta_2, jphi_2, jcsv_2);
+    btag_jets[0] = jet(bpt_1, beta_1, bphi_1, bscore_1, bflavor_1);
+    btag_jets[1] = jet(bpt_2, beta_2, bphi_2, bscore_2, bflavor_2);
 }
 
 std::string jet_factory::fix_syst_string(std::string syst) {
@@ -238,7 +254,7 @@ double _bTagEventWeight(jet_factory *jets, int nBTags = 0, int syst = 0) {
         ##################################################################
       */
 
-    auto bjets = jets->getBtagJets();
+    const auto &bjets = jets->getBtagJets();
     auto bjetpt_1(bjets.at(0).getPt()), bjetflavour_1(bjets.at(0).getFlavor()), bjetpt_2(bjets.at(1).getPt()), bjetflavour_2(bjets.at(1).getFlavor());
     auto nBtaggedJets = jets->getNbtag();
 
@@ -0,0 +1,178 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_JOB_TIMER_H_
+#define INCLUDE_JOB_TIMER_H_
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "./json.hpp"
+#include "TFile.h"
+
+//////////////////////////////////////////////////////
+// Purpose: To record where the time in a job goes. //
+// Each stage is timed by a scope that measures     //
+// wall time, CPU time, bytes read by all TFiles    //
+// and the peak RSS when it ends. Stages with the   //
+// same name are summed, so a stage run by several  //
+// workers is reported once. CPU time is for the    //
+// whole process, so it includes every thread.      //
+// The summary is written as a json sidecar to the  //
+// output and log files.                            //
+//////////////////////////////////////////////////////
+class job_timer {
+ public:
+    struct stage {
+        std::string name;
+        int calls;
+        double wall, cpu;  // seconds
+        Long64_t events, bytes_read;
+        long peak_rss;  // kB
+    };
+
+    // times a stage from construction until stop() or destruction
+    class scope {
+     private:
+        job_timer *timer;
+        std::string name;
+        std::chrono::steady_clock::time_point wall_start;
+        std::clock_t cpu_start;
+        Long64_t bytes_start, events;
+
+     public:
+        scope(job_timer *, std::string);
+        scope(scope &&);
+        scope &operator=(scope &&);  // ends this stage and continues timing the other one
+        ~scope() { stop(); }
+        scope(const scope &) = delete;
+        scope &operator=(const scope &) = delete;
+
+        void addEvents(Long64_t n) { events += n; }
+        void stop();
+    };
+
+    explicit job_timer(std::string);
+
+    scope time(std::string name) { return scope(this, name); }
+    void record(std::string, double, double, Long64_t, Long64_t);
+    void write(std::string) const;
+
+ private:
+    std::string job;
+    std::chrono::steady_clock::time_point wall_start;
+    std::clock_t cpu_start;
+    std::vector<stage> stages;
+    mutable std::mutex lock;  // scopes may end in worker threads
+};
+
+namespace timer_utils {
+
+// peak resident set size of the process in kB
+long peak_rss() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// name of the json sidecar for an output or log file. "x_output.root" -> "x_output_timing.json"
+std::string sidecar_name(std::string filename) {
+    auto ext = filename.rfind('.');
+    if (ext != std::string::npos && filename.find('/', ext) == std::string::npos) {
+        filename = filename.substr(0, ext);
+    }
+    return filename + "_timing.json";
+}
+
+}  // namespace timer_utils
+
+job_timer::scope::scope(job_timer *_timer, std::string _name)
+    : timer(_timer),
+      name(_name),
+      wall_start(std::chrono::steady_clock::now()),
+      cpu_start(std::clock()),
+      bytes_start(TFile::GetFileBytesRead()),
+      events(0) {}
+
+job_timer::scope::scope(scope &&other)
+    : timer(other.timer),
+      name(other.name),
+      wall_start(other.wall_start),
+      cpu_start(other.cpu_start),
+      bytes_start(other.bytes_start),
+      events(other.events) {
+    other.timer = nullptr;
+}
+
+job_timer::scope &job_timer::scope::operator=(scope &&other) {
+    stop();
+    timer = other.timer;
+    name = other.name;
+    wall_start = other.wall_start;
+    cpu_start = other.cpu_start;
+    bytes_start = other.bytes_start;
+    events = other.events;
+    other.timer = nullptr;
+    return *this;
+}
+
+void job_timer::scope::stop() {
+    if (!timer) {
+        return;
+    }
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+    timer->record(name, wall.count(), static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC, events,
+                  TFile::GetFileBytesRead() - bytes_start);
+    timer = nullptr;
+}
+
+job_timer::job_timer(std::string _job) : job(_job), wall_start(std::chrono::steady_clock::now()), cpu_start(std::clock()) {}
+
+void job_timer::record(std::string name, double wall, double cpu, Long64_t events, Long64_t bytes_read) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = std::find_if(stages.begin(), stages.end(), [&name](const stage &s) { return s.name == name; });
+    if (found == stages.end()) {
+        stages.push_back(stage{name, 0, 0., 0., 0, 0, 0});
+        found = stages.end() - 1;
+    }
+    found->calls++;
+    found->wall += wall;
+    found->cpu += cpu;
+    found->events += events;
+    found->bytes_read += bytes_read;
+    found->peak_rss = std::max(found->peak_rss, timer_utils::peak_rss());
+}
+
+// write the stages, in the order they first finished, and the totals so far
+void job_timer::write(std::string filename) const {
+    std::lock_guard<std::mutex> guard(lock);
+    nlohmann::json stage_json = nlohmann::json::array();
+    for (auto &s : stages) {
+        stage_json.push_back({{"name", s.name},
+                              {"calls", s.calls},
+                              {"wall_s", s.wall},
+                              {"cpu_s", s.cpu},
+                              {"events", s.events},
+                              {"events_per_s", s.wall > 0 ? s.events / s.wall : 0.},
+                              {"bytes_read", s.bytes_read},
+                              {"peak_rss_kb", s.peak_rss}});
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+    nlohmann::json timing_json = {{"job", job},
+                                  {"wall_s", wall.count()},
+                                  {"cpu_s", static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC},
+                                  {"bytes_read", TFile::GetFileBytesRead()},
+                                  {"peak_rss_kb", timer_utils::peak_rss()},
+                                  {"stages", stage_json}};
+    std::ofstream timing_file(filename);
+    timing_file << timing_json.dump(4) << std::endl;
+}
+
+#endif  // INCLUDE_JOB_TIMER_H_
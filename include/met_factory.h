@@ -5,57 +5,77 @@
 
 #include <algorithm>
 #include <string>
-#include "TLorentzVector.h"
+#include <vector>
+#include "./branch_manifest.h"
+#include "./four_vector.h"
+#include "./shifted_branch.h"
 #include "TTree.h"
 
 class met_factory {
    private:
-    Float_t met, metphi, met_py, met_px;
+    Float_t met_py, met_px;
+    shifted_branch met, metphi;
+    std::size_t active;
     Float_t metSig, metcov00, metcov10, metcov11, metcov01;
-    TLorentzVector p4;
+    four_vector p4;
     std::unordered_map<std::string, std::string> syst_name_map;
+    branch_manifest manifest;  // every input branch that is read
 
    public:
     met_factory(TTree*, int, std::string);
+    met_factory(TTree*, int, std::vector<std::string>);
     virtual ~met_factory() {}
+    void setSyst(std::size_t idx) { active = idx; }
+    const branch_manifest &getManifest() const { return manifest; }
     std::string fix_syst_string(std::string);
 
     // getters
-    Float_t getMet() { return met; }
+    Float_t getMet() { return met.get(active); }
     Float_t getMetSig() { return metSig; }
     Float_t getMetCov00() { return metcov00; }
     Float_t getMetCov10() { return metcov10; }
     Float_t getMetCov11() { return metcov11; }
     Float_t getMetCov01() { return metcov01; }
-    Float_t getMetPhi() { return metphi; }
+    Float_t getMetPhi() { return metphi.get(active); }
     Float_t getMetPx() { return met_px; }
     Float_t getMetPy() { return met_py; }
-    TLorentzVector getP4();
+    four_vector getP4();
 };
 
 // initialize member data and set TLorentzVector
-met_factory::met_factory(TTree* input, int era, std::string syst)
-    : syst_name_map{
+met_factory::met_factory(TTree* input, int era, std::string syst) : met_factory(input, era, std::vector<std::string>{syst}) {}
+
+// read the met for several systematic shifts at once. Shifts are selected with setSyst
+met_factory::met_factory(TTree* input, int era, std::vector<std::string> systs)
+    : active(0),
+      syst_name_map{
           {"UncMet_Up", "UESUp"},
           {"UncMet_Down", "UESDown"},
       } {
-    std::string met_name("met"), metphi_name("metphi");
+    std::vector<std::string> met_names, metphi_names;
     auto end = std::string::npos;
-    if (syst.find("UES") != end && (syst.find("Up") != end || syst.find("Down") != end)) {
-        syst.erase(std::remove(syst.begin(), syst.end(), '_'), syst.end());
-        met_name += "_" + syst;
-        metphi_name += "_" + syst;
+    for (auto syst : systs) {
+        std::string met_name("met"), metphi_name("metphi");
+        if (syst.find("UES") != end && (syst.find("Up") != end || syst.find("Down") != end)) {
+            syst.erase(std::remove(syst.begin(), syst.end(), '_'), syst.end());
+            met_name += "_" + syst;
+            metphi_name += "_" + syst;
+        }
+        met_names.push_back(met_name);
+        metphi_names.push_back(metphi_name);
     }
-    
-    input->SetBranchAddress(met_name.c_str(), &met);
-    input->SetBranchAddress(metphi_name.c_str(), &metphi);
-    input->SetBranchAddress("metSig", &metSig);
-    input->SetBranchAddress("metcov00", &metcov00);
-    input->SetBranchAddress("metcov10", &metcov10);
-    input->SetBranchAddress("metcov11", &metcov11);
-    input->SetBranchAddress("metcov01", &metcov01);
-    input->SetBranchAddress("met_px", &met_px);
-    input->SetBranchAddress("met_py", &met_py);
+
+    met.bind(input, met_names);
+    manifest.add(met_names);
+    metphi.bind(input, metphi_names);
+    manifest.add(metphi_names);
+    manifest.bind(input, "metSig", &metSig);
+    manifest.bind(input, "metcov00", &metcov00);
+    manifest.bind(input, "metcov10", &metcov10);
+    manifest.bind(input, "metcov11", &metcov11);
+    manifest.bind(input, "metcov01", &metcov01);
+    manifest.bind(input, "met_px", &met_px);
+    manifest.bind(input, "met_py", &met_py);
 }
 
 std::string met_factory::fix_syst_string(std::string syst) {
@@ -76,8 +96,8 @@ std::string met_factory::fix_syst_string(std::string syst) {
     return formatted;
 }
 
-TLorentzVector met_factory::getP4() {
-    p4.SetPtEtaPhiM(met, 0, metphi, 0);
+four_vector met_factory::getP4() {
+    p4.SetPtEtaPhiM(getMet(), 0, getMetPhi(), 0);
     return p4;
 }
 
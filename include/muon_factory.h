@@ -6,7 +6,9 @@
 #include <cmath>
 #include <string>
 #include <vector>
-#include "TLorentzVector.h"
+#include "./branch_manifest.h"
+#include "./four_vector.h"
+#include "./syst_descriptor.h"
 #include "TTree.h"
 
 class muon_factory;  // forward declare so it can befriend muons
@@ -20,7 +22,7 @@ class muon {
  private:
     std::string name = "muon";
     Float_t pt, eta, phi, mass, charge, px, py, pz, iso, gen_match, mediumID, gen_pt, gen_eta, gen_phi, gen_energy;
-    TLorentzVector p4;
+    four_vector p4;
 
  public:
     muon(Float_t, Float_t, Float_t, Float_t, Float_t);
@@ -28,7 +30,7 @@ class muon {
 
     // getters
     std::string getName() { return name; }
-    TLorentzVector getP4() { return p4; }
+    four_vector getP4() { return p4; }
     Float_t getPt() { return p4.Pt(); }
     Float_t getEta() { return p4.Eta(); }
     Float_t getPhi() { return p4.Phi(); }
@@ -43,7 +45,7 @@ class muon {
     Int_t getCharge() { return charge; }
 };
 
-// initialize member data and set TLorentzVector
+// initialize member data and set the four-vector
 muon::muon(Float_t Pt, Float_t Eta, Float_t Phi, Float_t M, Float_t Charge)
     : pt(Pt), eta(Eta), phi(Phi), mass(M), charge(Charge) {
     p4.SetPtEtaPhiM(pt, eta, phi, mass);
@@ -55,34 +57,43 @@ muon::muon(Float_t Pt, Float_t Eta, Float_t Phi, Float_t M, Float_t Charge)
 /////////////////////////////////////////////
 class muon_factory {
  private:
-    std::string syst;
+    std::vector<syst_descriptor> systs;  // parsed once, selected with setSyst
+    std::size_t active;
     Float_t px_1, py_1, pz_1, pt_1, eta_1, phi_1, m_1, e_1, q_1, mt_1, iso_1, mediumID, mGenPt, mGenEta, mGenPhi,
         mGenEnergy;
     Int_t gen_match_1;
+    branch_manifest manifest;  // every input branch that is read
 
  public:
     muon_factory(TTree*, int, std::string);
+    muon_factory(TTree*, int, std::vector<std::string>);
     virtual ~muon_factory() {}
+    void setSyst(std::size_t idx) { active = idx; }
+    const branch_manifest &getManifest() const { return manifest; }
     muon run_factory();
 };
 
 // read data from tree into member variabl
-muon_factory::muon_factory(TTree* input, int era, std::string _syst) : syst(_syst) {
-    input->SetBranchAddress("px_1", &px_1);
-    input->SetBranchAddress("py_1", &py_1);
-    input->SetBranchAddress("pz_1", &pz_1);
-    input->SetBranchAddress("pt_1", &pt_1);
-    input->SetBranchAddress("eta_1", &eta_1);
-    input->SetBranchAddress("phi_1", &phi_1);
-    input->SetBranchAddress("m_1", &m_1);
-    input->SetBranchAddress("q_1", &q_1);
-    input->SetBranchAddress("mRelPFIsoDBDefault", &iso_1);
-    input->SetBranchAddress("gen_match_1", &gen_match_1);
+muon_factory::muon_factory(TTree* input, int era, std::string _syst) : muon_factory(input, era, std::vector<std::string>{_syst}) {}
+
+// read data for several systematic shifts at once. Shifts are selected with setSyst
+muon_factory::muon_factory(TTree* input, int era, std::vector<std::string> _systs)
+    : systs(_systs.begin(), _systs.end()), active(0) {
+    manifest.bind(input, "px_1", &px_1);
+    manifest.bind(input, "py_1", &py_1);
+    manifest.bind(input, "pz_1", &pz_1);
+    manifest.bind(input, "pt_1", &pt_1);
+    manifest.bind(input, "eta_1", &eta_1);
+    manifest.bind(input, "phi_1", &phi_1);
+    manifest.bind(input, "m_1", &m_1);
+    manifest.bind(input, "q_1", &q_1);
+    manifest.bind(input, "mRelPFIsoDBDefault", &iso_1);
+    manifest.bind(input, "gen_match_1", &gen_match_1);
     // input->SetBranchAddress("mPFIDMedium", &mediumID);
-    input->SetBranchAddress("mGenPt", &mGenPt);
-    input->SetBranchAddress("mGenEta", &mGenEta);
-    input->SetBranchAddress("mGenPhi", &mGenPhi);
-    input->SetBranchAddress("mGenEnergy", &mGenEnergy);
+    manifest.bind(input, "mGenPt", &mGenPt);
+    manifest.bind(input, "mGenEta", &mGenEta);
+    manifest.bind(input, "mGenPhi", &mGenPhi);
+    manifest.bind(input, "mGenEnergy", &mGenEnergy);
 }
 
 // create muon object and set member data
@@ -99,22 +110,20 @@ muon muon_factory::run_factory() {
     mu.gen_phi = mGenPhi;
     mu.gen_energy = mGenEnergy;
 
-    // muon energy scale systematics
-    if (syst.find("MES") != std::string::npos) {
-        int dir(1);
-        if (syst == "MES_Down") {
-            dir = -1;
-        }
+    // muon energy scale systematics: Up raises and Down lowers the energy by the eta dependent scale
+    const syst_descriptor& syst = systs[active];
+    if (syst.is(syst_source::mes)) {
+        int dir(syst.isUp() ? 1 : -1);
         if (mu.getEta() < -2.1) {
-            mu.p4 *= dir * 1.027;
+            mu.p4 *= 1 + dir * 0.027;
         } else if (mu.getEta() < -1.2) {
-            mu.p4 *= dir * 1.009;
+            mu.p4 *= 1 + dir * 0.009;
         } else if (mu.getEta() < 1.2) {
-            mu.p4 *= dir * 1.004;
+            mu.p4 *= 1 + dir * 0.004;
         } else if (mu.getEta() < 2.1) {
-            mu.p4 *= dir * 1.009;
+            mu.p4 *= 1 + dir * 0.009;
         } else {
-            mu.p4 *= dir * 1.017;
+            mu.p4 *= 1 + dir * 0.017;
         }
     }
 
@@ -0,0 +1,106 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_OUTPUT_SCHEMA_H_
+#define INCLUDE_OUTPUT_SCHEMA_H_
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./json.hpp"
+
+// one output branch and the slim_tree variable it is filled from
+struct schema_branch {
+    std::string name, source;
+    char type;      // ROOT leaf type code, 0 to use the type of the source
+    int precision;  // mantissa bits kept for floats (written as Float16_t), 0 for full precision
+};
+
+///////////////////////////////////////////////////////
+// Purpose: To read the branches slim_tree writes    //
+// from a named preset in a json file (by default    //
+// configs/output_schema.json), so the output can be //
+// trimmed for a campaign without recompiling the    //
+// analyzers.                                        //
+//                                                   //
+// A preset is a list of branches and can extend     //
+// another preset. Each branch is either the name of //
+// a slim_tree variable or an object with name,      //
+// source, type and precision. "*" stands for every  //
+// variable slim_tree has that isn't listed by name. //
+///////////////////////////////////////////////////////
+class output_schema {
+ private:
+    std::string preset;
+    std::vector<schema_branch> branches;
+
+    bool add_preset(const nlohmann::json &, std::string, std::vector<std::string> &);
+
+ public:
+    output_schema() {}
+    output_schema(std::string, std::string);
+
+    bool empty() const { return branches.empty(); }
+    std::string getPreset() const { return preset; }
+    const std::vector<schema_branch> &getBranches() const { return branches; }
+};
+
+// read the preset from the file. The schema is left empty if anything is wrong with it
+output_schema::output_schema(std::string filename, std::string _preset) : preset(_preset) {
+    std::ifstream schema_file(filename);
+    if (!schema_file.good()) {
+        std::cerr << "Unable to open output schema " << filename << std::endl;
+        return;
+    }
+
+    nlohmann::json schema_json;
+    schema_file >> schema_json;
+    std::vector<std::string> seen;
+    if (!add_preset(schema_json, preset, seen)) {
+        branches.clear();
+    }
+}
+
+// add the branches of a preset after the ones of the preset it extends
+bool output_schema::add_preset(const nlohmann::json &schema_json, std::string name, std::vector<std::string> &seen) {
+    if (!schema_json.contains(name)) {
+        std::cerr << "Output schema preset " << name << " doesn't exist" << std::endl;
+        return false;
+    }
+    if (std::find(seen.begin(), seen.end(), name) != seen.end()) {
+        std::cerr << "Output schema preset " << name << " extends itself" << std::endl;
+        return false;
+    }
+    seen.push_back(name);
+
+    auto &config = schema_json.at(name);
+    if (config.contains("extends") && !add_preset(schema_json, config.at("extends").get<std::string>(), seen)) {
+        return false;
+    }
+
+    for (auto &entry : config.at("branches")) {
+        schema_branch branch{"", "", 0, 0};
+        if (entry.is_string()) {
+            branch.name = branch.source = entry.get<std::string>();
+        } else {
+            branch.name = entry.at("name").get<std::string>();
+            branch.source = entry.value("source", branch.name);
+            auto type = entry.value("type", std::string());
+            branch.type = type.empty() ? 0 : type.at(0);
+            branch.precision = entry.value("precision", 0);
+        }
+
+        // a branch listed again replaces the earlier one
+        auto found = std::find_if(branches.begin(), branches.end(), [&branch](const schema_branch &b) { return b.name == branch.name; });
+        if (found != branches.end()) {
+            *found = branch;
+        } else {
+            branches.push_back(branch);
+        }
+    }
+    return true;
+}
+
+#endif  // INCLUDE_OUTPUT_SCHEMA_H_
@@ -0,0 +1,111 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_PROCESS_INFO_H_
+#define INCLUDE_PROCESS_INFO_H_
+
+#include <string>
+#include <unordered_map>
+
+enum class process_type { data, embed, W, ZTT, ZL, ZJ, ZLL, EWKZ, TTT, TTL, TTJ, STT, STL, STJ, VVT, VVL, VVJ, signal, other };
+
+enum class signal_kind { none, JHU, madgraph, minlo, powheg };
+
+// traits the event loop checks for a process
+namespace process_traits {
+enum : unsigned {
+    w_stitched = 1u << 0,        // W+jets weight from the number of gen jets
+    dy_stitched = 1u << 1,       // DY+jets weight from the number of gen jets
+    z_pt_reweight = 1u << 2,     // Z mass/pT reweighting
+    top_pt_reweight = 1u << 3,   // top pT reweighting
+    gen_tau = 1u << 4,           // keep only genuine taus
+    gen_lepton = 1u << 5,        // keep only leptons faking taus
+    gen_jet = 1u << 6,           // keep only jets faking taus
+    embed_overlap = 1u << 7,     // genuine di-tau MC that is also covered by embedding
+    ggh_nnlops = 1u << 8,        // powheg ggH NNLOPS weights and theory uncertainties
+    vbf_theory = 1u << 9,        // powheg VBF theory uncertainties
+};
+}  // namespace process_traits
+
+//////////////////////////////////////////////////////
+// Purpose: To describe the process being analyzed  //
+// once per job. The process name (-n), sample and  //
+// signal type (--stype) are turned into an enum    //
+// and a set of traits, so the event loop only does //
+// integer and bit tests instead of comparing       //
+// strings for every event.                         //
+//////////////////////////////////////////////////////
+class process_info {
+ private:
+    std::string name;
+    process_type process;
+    signal_kind stype;
+    unsigned traits;
+
+ public:
+    process_info(std::string, std::string, std::string);
+
+    std::string getName() const { return name; }
+    process_type getProcess() const { return process; }
+    signal_kind getSignalType() const { return stype; }
+    bool isSignal() const { return stype != signal_kind::none; }
+    bool has(unsigned trait) const { return traits & trait; }
+
+    // true if the tau's gen match belongs to this process (i.e. ZTT needs a genuine tau)
+    bool passGenMatch(int tau_gen_match) const {
+        if (traits & process_traits::gen_lepton) {
+            return tau_gen_match <= 4;
+        } else if (traits & process_traits::gen_tau) {
+            return tau_gen_match == 5;
+        } else if (traits & process_traits::gen_jet) {
+            return tau_gen_match == 6;
+        }
+        return true;
+    }
+};
+
+// name is the process name given to the analyzer and sample is the sample
+// after signal samples are renamed (i.e. ggh125)
+process_info::process_info(std::string _name, std::string sample, std::string signal_type) : name(_name), traits(0) {
+    using namespace process_traits;
+    static const std::unordered_map<std::string, std::pair<process_type, unsigned>> processes{
+        {"data_obs", {process_type::data, 0}},
+        {"embed", {process_type::embed, 0}},
+        {"W", {process_type::W, w_stitched}},
+        {"ZTT", {process_type::ZTT, dy_stitched | z_pt_reweight | gen_tau | embed_overlap}},
+        {"ZL", {process_type::ZL, dy_stitched | z_pt_reweight | gen_lepton}},
+        {"ZJ", {process_type::ZJ, dy_stitched | z_pt_reweight | gen_jet}},
+        {"ZLL", {process_type::ZLL, dy_stitched | z_pt_reweight}},
+        {"EWKZ2l", {process_type::EWKZ, z_pt_reweight}},
+        {"EWKZ2nu", {process_type::EWKZ, z_pt_reweight}},
+        {"TTT", {process_type::TTT, top_pt_reweight | gen_tau | embed_overlap}},
+        {"TTL", {process_type::TTL, top_pt_reweight | gen_lepton}},
+        {"TTJ", {process_type::TTJ, top_pt_reweight | gen_jet}},
+        {"STT", {process_type::STT, top_pt_reweight | gen_tau | embed_overlap}},
+        {"STL", {process_type::STL, top_pt_reweight | gen_lepton}},
+        {"STJ", {process_type::STJ, top_pt_reweight | gen_jet}},
+        {"VVT", {process_type::VVT, gen_tau | embed_overlap}},
+        {"VVL", {process_type::VVL, gen_lepton}},
+        {"VVJ", {process_type::VVJ, gen_jet}},
+    };
+    static const std::unordered_map<std::string, signal_kind> signal_types{
+        {"JHU", signal_kind::JHU}, {"madgraph", signal_kind::madgraph}, {"minlo", signal_kind::minlo}, {"powheg", signal_kind::powheg}};
+
+    auto found = processes.find(name);
+    if (found != processes.end()) {
+        process = found->second.first;
+        traits = found->second.second;
+    } else {
+        process = name.find("125") != std::string::npos ? process_type::signal : process_type::other;
+    }
+
+    auto found_type = signal_types.find(signal_type);
+    stype = found_type != signal_types.end() ? found_type->second : signal_kind::none;
+
+    if (sample == "ggh125" && stype == signal_kind::powheg) {
+        traits |= ggh_nnlops;
+    } else if (sample == "vbf125" && stype == signal_kind::powheg) {
+        traits |= vbf_theory;
+    }
+}
+
+#endif  // INCLUDE_PROCESS_INFO_H_
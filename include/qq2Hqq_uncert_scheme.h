@@ -92,9 +92,15 @@ std::map<int, double> powheg_xsec
 // Propagation function
 double vbf_uncert_stage_1_1(int source, int event_STXS, double Nsigma=1.0){
   // return a single weight for a given souce
+  // the tables are shared by all threads, so only look them up (operator[] would insert)
+  auto acc = stxs_acc.find(event_STXS);
+  auto xsec = powheg_xsec.find(event_STXS);
+  if (acc == stxs_acc.end() || xsec == powheg_xsec.end()) {
+    return 1.0;
+  }
   if(source < 10){
-    double delta_var = stxs_acc[event_STXS][source] * uncert_deltas[source];
-    return  1.0 + Nsigma * (delta_var/powheg_xsec[event_STXS]);
+    double delta_var = acc->second.at(source) * uncert_deltas.at(source);
+    return  1.0 + Nsigma * (delta_var/xsec->second);
   }else{
     return 0.0;
   }
@@ -0,0 +1,114 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_SF_CONTEXT_H_
+#define INCLUDE_SF_CONTEXT_H_
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "./sf_table.h"
+#include "RooAbsReal.h"
+#include "RooRealVar.h"
+#include "RooWorkspace.h"
+
+enum class sf_shift { nominal, up, down };
+
+//////////////////////////////////////////////////////
+// Purpose: To resolve every scale factor input and //
+// function an analyzer uses once per job. The      //
+// event loop sets inputs and evaluates functions   //
+// through integer handles, so there are no string  //
+// lookups in the workspace per event. Functions    //
+// are resolved with their _up/_down variations.    //
+// If sf_compiler tables are given, functions found //
+// in them are evaluated from the tables instead.   //
+//                                                  //
+// RooFit keeps global and static state, so even    //
+// with a workspace copy per worker, every RooFit   //
+// setVal/getVal holds a mutex shared by all        //
+// contexts. Table lookups don't lock.              //
+//////////////////////////////////////////////////////
+class sf_context {
+ private:
+    RooWorkspace *workspace;
+    std::unique_ptr<sf_tables> tables;
+    std::vector<RooRealVar *> vars;
+    std::vector<sf_input *> table_vars;
+    std::vector<RooAbsReal *> functions;  // nominal, up and down for each handle
+    std::vector<sf_table *> table_functions;
+    bool use_roofit;  // false when every function comes from the tables
+
+    static std::mutex &roofit_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+ public:
+    explicit sf_context(RooWorkspace *, std::string table_file = "");
+    ~sf_context() {}
+    sf_context(const sf_context &) = delete;
+    sf_context &operator=(const sf_context &) = delete;
+
+    std::size_t var(std::string);
+    std::size_t function(std::string);
+
+    void set(std::size_t handle, double val) {
+        if (use_roofit) {
+            std::lock_guard<std::mutex> lock(roofit_mutex());
+            vars[handle]->setVal(val);
+        }
+        if (table_vars[handle]) {
+            table_vars[handle]->setVal(val);
+        }
+    }
+
+    double eval(std::size_t handle, sf_shift shift = sf_shift::nominal) const {
+        auto idx = 3 * handle + static_cast<std::size_t>(shift);
+        if (table_functions[idx]) {
+            return table_functions[idx]->getVal();
+        }
+        std::lock_guard<std::mutex> lock(roofit_mutex());
+        return functions[idx]->getVal();
+    }
+};
+
+sf_context::sf_context(RooWorkspace *_workspace, std::string table_file) : workspace(_workspace), use_roofit(false) {
+    if (!table_file.empty()) {
+        tables = std::unique_ptr<sf_tables>(new sf_tables(table_file));
+    }
+}
+
+// get the handle for an input variable
+std::size_t sf_context::var(std::string name) {
+    std::lock_guard<std::mutex> lock(roofit_mutex());
+    auto roofit_var = workspace->var(name.c_str());
+    if (!roofit_var) {
+        std::cerr << "Scale factor input " << name << " is not in the workspace" << std::endl;
+    }
+    vars.push_back(roofit_var);
+    table_vars.push_back(tables ? tables->var(name) : nullptr);
+    return vars.size() - 1;
+}
+
+// get the handle for a function and its _up/_down variations. Missing
+// variations are only a problem if they are evaluated
+std::size_t sf_context::function(std::string name) {
+    std::lock_guard<std::mutex> lock(roofit_mutex());
+    if (!workspace->function(name.c_str())) {
+        std::cerr << "Scale factor function " << name << " is not in the workspace" << std::endl;
+    }
+    for (auto &variation : {name, name + "_up", name + "_down"}) {
+        auto table = tables ? tables->function(variation) : nullptr;
+        functions.push_back(workspace->function(variation.c_str()));
+        table_functions.push_back(table);
+        if (!table) {
+            use_roofit = true;
+        }
+    }
+    return functions.size() / 3 - 1;
+}
+
+#endif  // INCLUDE_SF_CONTEXT_H_
@@ -0,0 +1,222 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_SF_TABLE_H_
+#define INCLUDE_SF_TABLE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "./json.hpp"
+
+//////////////////////////////////////////////////////
+// Purpose: To evaluate scale factors that were     //
+// tabulated from a RooWorkspace by sf_compiler.    //
+// Each function is stored on a dense, uniform grid //
+// over its input variables, so a lookup is a few   //
+// multiplications instead of a walk through the    //
+// RooFit expression graph. The interface mirrors   //
+// RooWorkspace (var(...)->setVal, function(...)->  //
+// getVal) so the tables can stand in for it.       //
+//////////////////////////////////////////////////////
+
+// one input variable shared by all tables that depend on it
+class sf_input {
+ private:
+    std::string name;
+    double value;
+
+ public:
+    explicit sf_input(std::string _name) : name(_name), value(0.) {}
+    std::string getName() const { return name; }
+    void setVal(double val) { value = val; }
+    double getVal() const { return value; }
+};
+
+// uniform binning of one input variable
+struct sf_axis {
+    sf_input *input;
+    int nbins;
+    double min, max;
+};
+
+class sf_table {
+ private:
+    std::string name;
+    bool interpolate;  // multilinear interpolation between bin centers instead of the bin value
+    std::vector<sf_axis> axes;
+    std::vector<double> inv_width;
+    std::vector<std::size_t> strides;
+    std::vector<float> values;
+
+ public:
+    sf_table(std::string, bool, std::vector<sf_axis>, std::vector<float>);
+    ~sf_table() {}
+
+    std::string getName() const { return name; }
+    bool isInterpolated() const { return interpolate; }
+    void setInterpolated(bool _interpolate) { interpolate = _interpolate; }
+    const std::vector<sf_axis> &getAxes() const { return axes; }
+    const std::vector<float> &getValues() const { return values; }
+    double getVal() const;
+};
+
+// values are stored with the last axis varying fastest
+sf_table::sf_table(std::string _name, bool _interpolate, std::vector<sf_axis> _axes, std::vector<float> _values)
+    : name(_name), interpolate(_interpolate), axes(_axes), strides(_axes.size(), 1), values(_values) {
+    for (auto &axis : axes) {
+        inv_width.push_back(axis.nbins / (axis.max - axis.min));
+    }
+    for (int i = static_cast<int>(axes.size()) - 2; i >= 0; i--) {
+        strides.at(i) = strides.at(i + 1) * axes.at(i + 1).nbins;
+    }
+}
+
+// evaluate at the current values of the inputs. Inputs outside of the grid are
+// clamped to the edge, the same way RooRealVar::setVal clamps to its range
+double sf_table::getVal() const {
+    if (!interpolate) {
+        std::size_t idx(0);
+        for (std::size_t i = 0; i < axes.size(); i++) {
+            auto bin = static_cast<int>(std::floor((axes[i].input->getVal() - axes[i].min) * inv_width[i]));
+            idx += strides[i] * std::min(std::max(bin, 0), axes[i].nbins - 1);
+        }
+        return values[idx];
+    }
+
+    // find the lower grid point and the distance to the next one along each axis
+    std::size_t base(0);
+    double frac[8];
+    std::size_t step[8];
+    for (std::size_t i = 0; i < axes.size(); i++) {
+        double pos = (axes[i].input->getVal() - axes[i].min) * inv_width[i] - 0.5;
+        pos = std::min(std::max(pos, 0.), axes[i].nbins - 1.);
+        int lower = std::min(static_cast<int>(pos), std::max(axes[i].nbins - 2, 0));
+        frac[i] = pos - lower;
+        step[i] = axes[i].nbins > 1 ? strides[i] : 0;
+        base += strides[i] * lower;
+    }
+
+    // sum over the corners of the surrounding cell
+    double result(0.);
+    for (std::size_t corner = 0; corner < (1u << axes.size()); corner++) {
+        double weight(1.);
+        std::size_t idx(base);
+        for (std::size_t i = 0; i < axes.size(); i++) {
+            if (corner & (1u << i)) {
+                weight *= frac[i];
+                idx += step[i];
+            } else {
+                weight *= 1. - frac[i];
+            }
+        }
+        if (weight != 0.) {
+            result += weight * values[idx];
+        }
+    }
+    return result;
+}
+
+// collection of tables read from (or written to) a json file
+class sf_tables {
+ private:
+    std::unordered_map<std::string, std::unique_ptr<sf_input>> inputs;
+    std::unordered_map<std::string, std::unique_ptr<sf_table>> tables;
+
+ public:
+    sf_tables() {}
+    explicit sf_tables(std::string);
+    ~sf_tables() {}
+    sf_tables(const sf_tables &) = delete;  // tables point to the inputs
+    sf_tables &operator=(const sf_tables &) = delete;
+
+    sf_input *var(std::string);
+    sf_table *function(std::string) const;
+    sf_table *add(std::string, bool, std::vector<std::string>, std::vector<int>, std::vector<double>, std::vector<double>, std::vector<float>);
+    std::size_t size() const { return tables.size(); }
+    void write(std::string) const;
+};
+
+// read all tables in the file
+sf_tables::sf_tables(std::string filename) {
+    std::ifstream table_file(filename);
+    if (!table_file.good()) {
+        std::cerr << "Unable to open scale factor tables " << filename << std::endl;
+        return;
+    }
+
+    nlohmann::json table_json;
+    table_file >> table_json;
+    for (auto &entry : table_json.items()) {
+        std::vector<std::string> names;
+        std::vector<int> nbins;
+        std::vector<double> mins, maxs;
+        for (auto &binning : entry.value().at("inputs")) {
+            names.push_back(binning.at(0).get<std::string>());
+            nbins.push_back(binning.at(1).get<int>());
+            mins.push_back(binning.at(2).get<double>());
+            maxs.push_back(binning.at(3).get<double>());
+        }
+        add(entry.key(), entry.value().at("interpolate").get<bool>(), names, nbins, mins, maxs, entry.value().at("values").get<std::vector<float>>());
+    }
+}
+
+// get an input, creating it the first time it is requested
+sf_input *sf_tables::var(std::string name) {
+    auto found = inputs.find(name);
+    if (found == inputs.end()) {
+        found = inputs.emplace(name, std::unique_ptr<sf_input>(new sf_input(name))).first;
+    }
+    return found->second.get();
+}
+
+// get a table. Returns nullptr if the function wasn't tabulated
+sf_table *sf_tables::function(std::string name) const {
+    auto found = tables.find(name);
+    if (found == tables.end()) {
+        return nullptr;
+    }
+    return found->second.get();
+}
+
+sf_table *sf_tables::add(std::string name, bool interpolate, std::vector<std::string> names, std::vector<int> nbins, std::vector<double> mins,
+                         std::vector<double> maxs, std::vector<float> values) {
+    if (names.size() > 8) {
+        std::cerr << "Scale factor table " << name << " has more than 8 inputs" << std::endl;
+        return nullptr;
+    }
+
+    std::size_t expected(1);
+    std::vector<sf_axis> axes;
+    for (std::size_t i = 0; i < names.size(); i++) {
+        axes.push_back(sf_axis{var(names.at(i)), nbins.at(i), mins.at(i), maxs.at(i)});
+        expected *= nbins.at(i);
+    }
+    if (values.size() != expected) {
+        std::cerr << "Scale factor table " << name << " has " << values.size() << " values but " << expected << " bins" << std::endl;
+        return nullptr;
+    }
+
+    tables[name] = std::unique_ptr<sf_table>(new sf_table(name, interpolate, axes, values));
+    return tables[name].get();
+}
+
+void sf_tables::write(std::string filename) const {
+    nlohmann::json table_json;
+    for (auto &table : tables) {
+        nlohmann::json binnings;
+        for (auto &axis : table.second->getAxes()) {
+            binnings.push_back({axis.input->getName(), axis.nbins, axis.min, axis.max});
+        }
+        table_json[table.first] = {{"interpolate", table.second->isInterpolated()}, {"inputs", binnings}, {"values", table.second->getValues()}};
+    }
+    std::ofstream table_file(filename);
+    table_file << table_json;
+}
+
+#endif  // INCLUDE_SF_TABLE_H_
@@ -0,0 +1,56 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_SHIFTED_BRANCH_H_
+#define INCLUDE_SHIFTED_BRANCH_H_
+
+#include <string>
+#include <vector>
+
+#include "TTree.h"
+
+//////////////////////////////////////////////////////
+// Purpose: To hold one Float_t branch that is read //
+// under a different name for each systematic shift //
+// (i.e. m_sv vs m_sv_DM0_Up). Every distinct name  //
+// gets its own buffer so a single GetEntry fills   //
+// the values for all shifts at once.               //
+//////////////////////////////////////////////////////
+class shifted_branch {
+ private:
+    std::vector<std::string> names;
+    std::vector<Float_t> values;
+    std::vector<std::size_t> index;  // buffer used by each shift
+
+ public:
+    shifted_branch() {}
+    ~shifted_branch() {}
+    shifted_branch(const shifted_branch &) = delete;  // buffers are bound to the TTree by address
+    shifted_branch &operator=(const shifted_branch &) = delete;
+
+    void bind(TTree *, std::vector<std::string>);
+    Float_t get(std::size_t shift) { return values[index[shift]]; }
+};
+
+// bind one buffer per distinct branch name. branch_names holds the name to read for each shift
+void shifted_branch::bind(TTree *input, std::vector<std::string> branch_names) {
+    names.clear();
+    index.clear();
+    for (auto &branch_name : branch_names) {
+        std::size_t idx(0);
+        while (idx < names.size() && names.at(idx) != branch_name) {
+            idx++;
+        }
+        if (idx == names.size()) {
+            names.push_back(branch_name);
+        }
+        index.push_back(idx);
+    }
+
+    // size the buffers before taking any addresses
+    values.assign(names.size(), 0.);
+    for (std::size_t i = 0; i < names.size(); i++) {
+        input->SetBranchAddress(names.at(i).c_str(), &values.at(i));
+    }
+}
+
+#endif  // INCLUDE_SHIFTED_BRANCH_H_
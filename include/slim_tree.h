@@ -1,30 +1,59 @@
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
+#include "./ac_weight_store.h"
+#include "./branch_manifest.h"
 #include "./electron_factory.h"
+#include "./event_category.h"
+#include "./four_vector.h"
 #include "./muon_factory.h"
+#include "./output_schema.h"
+#include "./process_info.h"
 #include "./tau_factory.h"
 #include "TMath.h"
 #include "TTree.h"
 
+// a variable slim_tree can write and its ROOT leaf type
+struct slim_source {
+    std::string name;
+    void *address;
+    char type;
+};
+
+namespace slim_tree_utils {
+// Higgs+jet variables and ME_* copies. They aren't used by the datacards, so they
+// are only computed when one of them is booked
+const std::vector<std::string> derived_sources{
+    "higgs_m", "hjj_pT", "hjj_m", "MT_HiggsMET", "hj_dphi", "hj_deta", "jmet_dphi", "hmet_dphi", "hj_dr",
+    "ME_sm_VBF", "ME_sm_ggH", "ME_sm_ggH_qqInit", "ME_sm_WH", "ME_sm_ZH", "ME_ps_VBF", "ME_ps_ggH", "ME_ps_ggH_qqInit",
+    "ME_a2_VBF", "ME_L1_VBF", "ME_L1Zg_VBF", "ME_bkg", "ME_bkg1", "ME_bkg2"};
+}  // namespace slim_tree_utils
+
 class slim_tree {
    public:
-    slim_tree(std::string, bool);
+    slim_tree(std::string, bool, bool, const output_schema &);
     ~slim_tree() {}  // default destructor
 
     // member functions
     // fill the tree for this event
-    void fillTree(std::vector<std::string>, electron *, tau *, jet_factory *, met_factory *, event_info *, Float_t, Float_t,
-                  std::shared_ptr<std::vector<double>>, std::string);
-    void fillTree(std::vector<std::string>, muon *, tau *, jet_factory *, met_factory *, event_info *, Float_t, Float_t,
-                  std::shared_ptr<std::vector<double>>, std::string);
-    void generalFill(std::vector<std::string>, jet_factory *, met_factory *, event_info *, Float_t, TLorentzVector, Float_t,
-                     std::shared_ptr<std::vector<double>>, std::string);
+    void fillTree(unsigned, electron *, tau *, jet_factory *, met_factory *, event_info *, Float_t, Float_t, const process_info &);
+    void fillTree(unsigned, muon *, tau *, jet_factory *, met_factory *, event_info *, Float_t, Float_t, const process_info &);
+    void generalFill(unsigned, jet_factory *, met_factory *, event_info *, Float_t, four_vector, Float_t);
+    void fillDerived(const jet_collection &, met_factory *, event_info *, const four_vector &);
+    void addWeightShifts(std::vector<std::string>);
+    void setACWeights(const ac_weight_view &);
+    void bookDefault();
+    void bookSchema(const output_schema &);
+    bool book(const schema_branch &);
 
     // member data
     TTree *otree;
     Int_t cat_0jet, cat_boosted, cat_vbf, cat_VH, is_signal, is_antiLepIso, is_antiTauIso, is_qcd, is_looseIso, OS, SS, contamination;
+    Int_t category;  // event_category bits
     ULong64_t evtno;
     UInt_t run, lumi;
     Float_t evtwt, el_pt, el_eta, el_phi, el_mass, el_charge, el_iso, el_genMatch, mu_pt, mu_eta, mu_phi, mu_mass, mu_charge, mu_iso, mu_genMatch,
@@ -38,14 +67,65 @@ class slim_tree {
     Float_t cross_trigger;
     Float_t lep_dr;
 
-    // Anomolous coupling branches
-    Float_t wt_a1, wt_a2, wt_a3, wt_L1, wt_L1Zg, wt_a2int, wt_a3int, wt_L1int, wt_L1Zgint, wt_ggH_a1, wt_ggH_a3, wt_ggH_a3int, wt_wh_a1, wt_wh_a2,
-        wt_wh_a3, wt_wh_L1, wt_wh_L1Zg, wt_wh_a2int, wt_wh_a3int, wt_wh_L1int, wt_wh_L1Zgint, wt_zh_a1, wt_zh_a2, wt_zh_a3, wt_zh_L1, wt_zh_L1Zg,
-        wt_zh_a2int, wt_zh_a3int, wt_zh_L1int, wt_zh_L1Zgint;
+    // Anomolous coupling branches. The wt_* branches are bound to these slots in
+    // ACWeighter's order: 9 for VBF, 3 for ggH, 9 for WH and 9 for ZH
+    std::array<Float_t, 30> ac_slots;
     Float_t sm_weight_nlo, mm_weight_nlo, ps_weight_nlo;
+
+    // event weights for weight-only systematics (evtwt_<syst> branches)
+    std::vector<Float_t> weight_shifts;
+
+ private:
+    bool derived;  // fill the Higgs+jet variables and the ME_* copies
+    std::vector<slim_source> sources;
+
+    template <typename T>
+    void addSource(std::string name, T *address) {
+        sources.push_back(slim_source{name, address, manifest_utils::leaf_type(address)});
+    }
+    void addSources();
 };
 
-slim_tree::slim_tree(std::string tree_name, bool isAC = false) : otree(new TTree(tree_name.c_str(), tree_name.c_str())) {
+// The branches come from the schema if one is given and are the default set otherwise.
+// all_branches adds the Higgs+jet variables and the raw ME_* values for studies.
+slim_tree::slim_tree(std::string tree_name, bool isAC = false, bool all_branches = false, const output_schema &schema = output_schema())
+    : otree(new TTree(tree_name.c_str(), tree_name.c_str())), derived(false) {
+    addSources();
+    if (schema.empty()) {
+        bookDefault();
+    } else {
+        bookSchema(schema);
+    }
+    if (all_branches) {
+        for (auto &name : slim_tree_utils::derived_sources) {
+            if (otree->GetBranch(name.c_str()) == nullptr) {
+                book(schema_branch{name, name, 0, 0});
+            }
+        }
+    }
+
+    // weights the sample doesn't have are 0
+    ac_slots.fill(isAC ? 0. : 1.);
+
+    // include weights for anomolous coupling
+    if (isAC) {
+        std::vector<std::string> ac_names{
+            "wt_vbf_a1", "wt_vbf_a2",   "wt_vbf_a3",   "wt_vbf_L1",   "wt_vbf_L1Zg",   "wt_vbf_a2int", "wt_vbf_a3int", "wt_vbf_L1int",
+            "wt_vbf_L1Zgint", "wt_ggh_a1", "wt_ggh_a3", "wt_ggh_a3int", "wt_wh_a1", "wt_wh_a2", "wt_wh_a3", "wt_wh_L1",
+            "wt_wh_L1Zg", "wt_wh_a2int", "wt_wh_a3int", "wt_wh_L1int", "wt_wh_L1Zgint", "wt_zh_a1", "wt_zh_a2", "wt_zh_a3",
+            "wt_zh_L1", "wt_zh_L1Zg", "wt_zh_a2int", "wt_zh_a3int", "wt_zh_L1int", "wt_zh_L1Zgint"};
+        for (std::size_t i = 0; i < ac_names.size(); i++) {
+            otree->Branch(ac_names.at(i).c_str(), &ac_slots.at(i), (ac_names.at(i) + "/F").c_str());
+        }
+
+        otree->Branch("sm_weight_nlo", &sm_weight_nlo);
+        otree->Branch("mm_weight_nlo", &mm_weight_nlo);
+        otree->Branch("ps_weight_nlo", &ps_weight_nlo);
+    }
+}
+
+// the branches written when no schema is given
+void slim_tree::bookDefault() {
     otree->Branch("evtwt", &evtwt, "evtwt/F");
     // otree->Branch("evt", &evtno);
     // otree->Branch("run", &run);
@@ -109,26 +189,9 @@ slim_tree::slim_tree(std::string tree_name, bool isAC = false) : otree(new TTree
     otree->Branch("costhetastar", &costhetastar, "costhetastar/F");
     otree->Branch("Q2V1", &Q2V1, "Q2V1/F");
     otree->Branch("Q2V2", &Q2V2, "Q2V2/F");
-    // otree->Branch("ME_sm_VBF", &ME_sm_VBF, "ME_sm_VBF/F");
-    // otree->Branch("ME_sm_ggH", &ME_sm_ggH, "ME_sm_ggH/F");
-    // otree->Branch("ME_sm_ggH_qqInit", &ME_sm_ggH_qqInit, "ME_sm_ggH_qqInit/F");
-    // otree->Branch("ME_sm_WH", &ME_sm_WH, "ME_sm_WH/F");
-    // otree->Branch("ME_sm_ZH", &ME_sm_ZH, "ME_sm_ZH/F");
-    // otree->Branch("ME_ps_VBF", &ME_ps_VBF, "ME_ps_VBF/F");
-    // otree->Branch("ME_ps_ggH", &ME_ps_ggH, "ME_ps_ggH/F");
-    // otree->Branch("ME_ps_ggH_qqInit", &ME_ps_ggH_qqInit, "ME_ps_ggH_qqInit/F");
-    // otree->Branch("ME_a2_VBF", &ME_a2_VBF, "ME_a2_VBF/F");
-    // otree->Branch("ME_L1_VBF", &ME_L1_VBF, "ME_L1_VBF/F");
-    // otree->Branch("ME_L1Zg_VBF", &ME_L1Zg_VBF, "ME_L1Zg_VBF/F");
-    // otree->Branch("ME_bkg", &ME_bkg, "ME_bkg/F");
-    // otree->Branch("ME_bkg1", &ME_bkg1, "ME_bkg1/F");
-    // otree->Branch("ME_bkg2", &ME_bkg2, "ME_bkg2/F");
     otree->Branch("MELA_D2j", &MELA_D2j, "MELA_D2j/F");
 
     otree->Branch("higgs_pT", &higgs_pT, "higgs_pT/F");
-    // otree->Branch("higgs_m", &higgs_m, "higgs_m/F");
-    // otree->Branch("hjj_pT", &hjj_pT, "hjj_pT/F");
-    // otree->Branch("hjj_m", &hjj_m, "hjj_m/F");
     otree->Branch("vis_mass", &vis_mass, "vis_mass/F");
     otree->Branch("dEtajj", &dEtajj, "dEtajj/F");
     otree->Branch("dPhijj", &dPhijj, "dPhijj/F");
@@ -143,85 +206,236 @@ slim_tree::slim_tree(std::string tree_name, bool isAC = false) : otree(new TTree
     otree->Branch("contamination", &contamination, "contamination/I");
     otree->Branch("cross_trigger", &cross_trigger, "cross_trigger/F");
     otree->Branch("lep_dr", &lep_dr, "lep_dr/F");
+}
 
-    wt_a1 = 1.;
-    wt_a2 = 1.;
-    wt_a3 = 1.;
-    wt_L1 = 1.;
-    wt_L1Zg = 1.;
-    wt_a2int = 1.;
-    wt_a3int = 1.;
-    wt_L1int = 1.;
-    wt_L1Zgint = 1.;
-    wt_ggH_a1 = 1.;
-    wt_ggH_a3 = 1.;
-    wt_ggH_a3int = 1.;
-    wt_wh_a1 = 1.;
-    wt_wh_a2 = 1.;
-    wt_wh_a3 = 1.;
-    wt_wh_L1 = 1.;
-    wt_wh_L1Zg = 1.;
-    wt_wh_a2int = 1.;
-    wt_wh_a3int = 1.;
-    wt_wh_L1int = 1.;
-    wt_wh_L1Zgint = 1.;
-    wt_zh_a1 = 1.;
-    wt_zh_a2 = 1.;
-    wt_zh_a3 = 1.;
-    wt_zh_L1 = 1.;
-    wt_zh_L1Zg = 1.;
-    wt_zh_a2int = 1.;
-    wt_zh_a3int = 1.;
-    wt_zh_L1int = 1.;
-    wt_zh_L1Zgint = 1.;
+// every variable that can be written. The source names are the branch names of the default set
+void slim_tree::addSources() {
+    addSource("evtwt", &evtwt);
+    addSource("evt", &evtno);
+    addSource("run", &run);
+    addSource("lumi", &lumi);
+    for (auto &lep : std::vector<std::pair<std::string, std::vector<Float_t *>>>{
+             {"el", {&el_pt, &el_eta, &el_phi, &el_mass, &el_charge, &el_iso, &el_genMatch}},
+             {"mu", {&mu_pt, &mu_eta, &mu_phi, &mu_mass, &mu_charge, &mu_iso, &mu_genMatch}},
+         }) {
+        std::vector<std::string> names{"pt", "eta", "phi", "mass", "charge", "iso", "genMatch"};
+        for (std::size_t i = 0; i < names.size(); i++) {
+            addSource(lep.first + "_" + names.at(i), lep.second.at(i));
+        }
+    }
+    addSource("t1_pt", &t1_pt);
+    addSource("t1_eta", &t1_eta);
+    addSource("t1_phi", &t1_phi);
+    addSource("t1_mass", &t1_mass);
+    addSource("t1_charge", &t1_charge);
+    addSource("t1_iso", &t1_iso);
+    addSource("t1_iso_VL", &t1_iso_VL);
+    addSource("t1_iso_L", &t1_iso_L);
+    addSource("t1_iso_M", &t1_iso_M);
+    addSource("t1_iso_T", &t1_iso_T);
+    addSource("t1_iso_VT", &t1_iso_VT);
+    addSource("t1_iso_VVT", &t1_iso_VVT);
+    addSource("t1_decayMode", &t1_decayMode);
+    addSource("t1_dmf", &dmf);
+    addSource("t1_dmf_new", &dmf_new);
+    addSource("t1_genMatch", &t1_genMatch);
+
+    addSource("njets", &njets);
+    addSource("nbjets", &nbjets);
+    addSource("j1_pt", &j1_pt);
+    addSource("j1_eta", &j1_eta);
+    addSource("j1_phi", &j1_phi);
+    addSource("j2_pt", &j2_pt);
+    addSource("j2_eta", &j2_eta);
+    addSource("j2_phi", &j2_phi);
+    addSource("b1_pt", &b1_pt);
+    addSource("b1_eta", &b1_eta);
+    addSource("b1_phi", &b1_phi);
+    addSource("b2_pt", &b2_pt);
+    addSource("b2_eta", &b2_eta);
+    addSource("b2_phi", &b2_phi);
+
+    addSource("met", &met);
+    addSource("metphi", &metphi);
+    addSource("mjj", &mjj);
+    addSource("mt", &mt);
+    addSource("numGenJets", &numGenJets);
+    addSource("pt_sv", &pt_sv);
+    addSource("m_sv", &m_sv);
+
+    addSource("D0_ggH", &D0_ggH);
+    addSource("DCP_ggH", &DCP_ggH);
+    addSource("D0_VBF", &D0_VBF);
+    addSource("D_a2_VBF", &D_a2_VBF);
+    addSource("D_l1_VBF", &D_l1_VBF);
+    addSource("D_l1zg_VBF", &D_l1zg_VBF);
+    addSource("DCP_VBF", &DCP_VBF);
+    addSource("Phi", &Phi);
+    addSource("Phi1", &Phi1);
+    addSource("costheta1", &costheta1);
+    addSource("costheta2", &costheta2);
+    addSource("costhetastar", &costhetastar);
+    addSource("Q2V1", &Q2V1);
+    addSource("Q2V2", &Q2V2);
+    addSource("MELA_D2j", &MELA_D2j);
+
+    addSource("higgs_pT", &higgs_pT);
+    addSource("vis_mass", &vis_mass);
+    addSource("dEtajj", &dEtajj);
+    addSource("dPhijj", &dPhijj);
+    addSource("higgs_m", &higgs_m);
+    addSource("hjj_pT", &hjj_pT);
+    addSource("hjj_m", &hjj_m);
+    addSource("MT_HiggsMET", &MT_HiggsMET);
+    addSource("hj_dphi", &hj_dphi);
+    addSource("hj_deta", &hj_deta);
+    addSource("jmet_dphi", &jmet_dphi);
+    addSource("hmet_dphi", &hmet_dphi);
+    addSource("hj_dr", &hj_dr);
+    addSource("ME_sm_VBF", &ME_sm_VBF);
+    addSource("ME_sm_ggH", &ME_sm_ggH);
+    addSource("ME_sm_ggH_qqInit", &ME_sm_ggH_qqInit);
+    addSource("ME_sm_WH", &ME_sm_WH);
+    addSource("ME_sm_ZH", &ME_sm_ZH);
+    addSource("ME_ps_VBF", &ME_ps_VBF);
+    addSource("ME_ps_ggH", &ME_ps_ggH);
+    addSource("ME_ps_ggH_qqInit", &ME_ps_ggH_qqInit);
+    addSource("ME_a2_VBF", &ME_a2_VBF);
+    addSource("ME_L1_VBF", &ME_L1_VBF);
+    addSource("ME_L1Zg_VBF", &ME_L1Zg_VBF);
+    addSource("ME_bkg", &ME_bkg);
+    addSource("ME_bkg1", &ME_bkg1);
+    addSource("ME_bkg2", &ME_bkg2);
+
+    addSource("OS", &OS);
+    addSource("SS", &SS);
+    addSource("is_signal", &is_signal);
+    addSource("is_antiLepIso", &is_antiLepIso);
+    addSource("is_antiTauIso", &is_antiTauIso);
+    addSource("is_qcd", &is_qcd);
+    addSource("is_looseIso", &is_looseIso);
+    addSource("cat_0jet", &cat_0jet);
+    addSource("cat_boosted", &cat_boosted);
+    addSource("cat_vbf", &cat_vbf);
+    addSource("cat_VH", &cat_VH);
+    addSource("contamination", &contamination);
+    addSource("category", &category);
+    addSource("cross_trigger", &cross_trigger);
+    addSource("lep_dr", &lep_dr);
+}
 
-    // include weights for anomolous coupling
-    if (isAC) {
-        otree->Branch("wt_vbf_a1", &wt_a1);
-        otree->Branch("wt_vbf_a2", &wt_a2);
-        otree->Branch("wt_vbf_a3", &wt_a3);
-        otree->Branch("wt_vbf_L1", &wt_L1);
-        otree->Branch("wt_vbf_L1Zg", &wt_L1Zg);
-        otree->Branch("wt_vbf_a2int", &wt_a2int);
-        otree->Branch("wt_vbf_a3int", &wt_a3int);
-        otree->Branch("wt_vbf_L1int", &wt_L1int);
-        otree->Branch("wt_vbf_L1Zgint", &wt_L1Zgint);
-
-        otree->Branch("wt_ggh_a1", &wt_ggH_a1);
-        otree->Branch("wt_ggh_a3", &wt_ggH_a3);
-        otree->Branch("wt_ggh_a3int", &wt_ggH_a3int);
-
-        otree->Branch("wt_wh_a1", &wt_wh_a1);
-        otree->Branch("wt_wh_a2", &wt_wh_a2);
-        otree->Branch("wt_wh_a3", &wt_wh_a3);
-        otree->Branch("wt_wh_L1", &wt_wh_L1);
-        otree->Branch("wt_wh_L1Zg", &wt_wh_L1Zg);
-        otree->Branch("wt_wh_a2int", &wt_wh_a2int);
-        otree->Branch("wt_wh_a3int", &wt_wh_a3int);
-        otree->Branch("wt_wh_L1int", &wt_wh_L1int);
-        otree->Branch("wt_wh_L1Zgint", &wt_wh_L1Zgint);
-
-        otree->Branch("wt_zh_a1", &wt_zh_a1);
-        otree->Branch("wt_zh_a2", &wt_zh_a2);
-        otree->Branch("wt_zh_a3", &wt_zh_a3);
-        otree->Branch("wt_zh_L1", &wt_zh_L1);
-        otree->Branch("wt_zh_L1Zg", &wt_zh_L1Zg);
-        otree->Branch("wt_zh_a2int", &wt_zh_a2int);
-        otree->Branch("wt_zh_a3int", &wt_zh_a3int);
-        otree->Branch("wt_zh_L1int", &wt_zh_L1int);
-        otree->Branch("wt_zh_L1Zgint", &wt_zh_L1Zgint);
+// book the branches of the schema. "*" books every variable that isn't listed by name
+void slim_tree::bookSchema(const output_schema &schema) {
+    std::vector<std::string> listed;
+    for (auto &branch : schema.getBranches()) {
+        listed.push_back(branch.source);
+    }
 
-        otree->Branch("sm_weight_nlo", &sm_weight_nlo);
-        otree->Branch("mm_weight_nlo", &mm_weight_nlo);
-        otree->Branch("ps_weight_nlo", &ps_weight_nlo);
+    for (auto &branch : schema.getBranches()) {
+        if (branch.name != "*") {
+            book(branch);
+            continue;
+        }
+        for (auto &source : sources) {
+            if (std::find(listed.begin(), listed.end(), source.name) == listed.end()) {
+                book(schema_branch{source.name, source.name, 0, 0});
+            }
+        }
+    }
+}
+
+// book one branch. Floats can be written with fewer mantissa bits as Float16_t
+bool slim_tree::book(const schema_branch &branch) {
+    auto source = std::find_if(sources.begin(), sources.end(), [&branch](const slim_source &s) { return s.name == branch.source; });
+    if (source == sources.end()) {
+        std::cerr << "Output branch " << branch.name << " is filled from " << branch.source << ", which slim_tree doesn't have" << std::endl;
+        return false;
+    }
+
+    char type = branch.type == 0 ? source->type : branch.type;
+    if (branch.precision > 0 && source->type == 'F') {
+        type = 'f';
+    }
+    if (type != source->type && !(type == 'f' && source->type == 'F')) {
+        std::cerr << "Output branch " << branch.name << " can't be written as type " << type << " from " << branch.source << " (type "
+                  << source->type << ")" << std::endl;
+        return false;
+    }
+
+    std::string leaflist = branch.name + "/" + type;
+    if (type == 'f' && branch.precision > 0) {
+        leaflist += "[0,0," + std::to_string(branch.precision) + "]";
+    }
+    otree->Branch(branch.name.c_str(), source->address, leaflist.c_str());
+
+    auto &derived_sources = slim_tree_utils::derived_sources;
+    if (std::find(derived_sources.begin(), derived_sources.end(), branch.source) != derived_sources.end()) {
+        derived = true;
+    }
+    return true;
+}
+
+// add an evtwt_<syst> branch for each systematic that only changes the event weight.
+// The values in weight_shifts must be set before each call to fillTree
+void slim_tree::addWeightShifts(std::vector<std::string> systs) {
+    weight_shifts.assign(systs.size(), 1.);
+    for (unsigned i = 0; i < systs.size(); i++) {
+        otree->Branch(("evtwt_" + systs.at(i)).c_str(), &weight_shifts.at(i), ("evtwt_" + systs.at(i) + "/F").c_str());
+    }
+}
+
+// copy the AC weights of the next event into the slots the wt_* branches read
+void slim_tree::setACWeights(const ac_weight_view &weights) {
+    for (std::size_t column = 0; column < weights.size(); column++) {
+        ac_slots[weights.slot(column)] = weights[column];
+    }
+}
+
+// Higgs+jet variables and ME_* copies, only written with all_branches
+void slim_tree::fillDerived(const jet_collection &jets, met_factory *fmet, event_info *evt, const four_vector &higgs) {
+    higgs_m = higgs.M();
+    ME_sm_VBF = evt->getME_sm_VBF();
+    ME_sm_ggH = evt->getME_sm_ggH();
+    ME_sm_ggH_qqInit = evt->getME_sm_ggH_qqInit();
+    ME_sm_WH = evt->getME_sm_WH();
+    ME_sm_ZH = evt->getME_sm_ZH();
+    ME_ps_VBF = evt->getME_ps_VBF();
+    ME_ps_ggH = evt->getME_ps_ggH();
+    ME_ps_ggH_qqInit = evt->getME_ps_ggH_qqInit();
+    ME_a2_VBF = evt->getME_a2_VBF();
+    ME_L1_VBF = evt->getME_L1_VBF();
+    ME_L1Zg_VBF = evt->getME_L1Zg_VBF();
+    ME_bkg = evt->getME_bkg();
+    ME_bkg1 = evt->getME_bkg1();
+    ME_bkg2 = evt->getME_bkg2();
+
+    auto met_x = fmet->getMet() * cos(fmet->getMetPhi());
+    auto met_y = fmet->getMet() * sin(fmet->getMetPhi());
+    auto met_pt = sqrt(pow(met_x, 2) + pow(met_y, 2));
+    MT_HiggsMET = sqrt(pow(higgs.Pt() + met_pt, 2) - pow(higgs.Px() + met_x, 2) - pow(higgs.Py() + met_y, 2));
+
+    hjj_pT = 0.;
+    hjj_m = 0.;
+    if (njets > 0) {
+        hj_dphi = TMath::ACos(TMath::Cos(jets.at(0).getPhi() - higgs.Phi()));
+        hj_deta = fabs(jets.at(0).getEta() - higgs.Eta());
+        jmet_dphi = TMath::ACos(TMath::Cos(fmet->getMetPhi() - jets.at(0).getPhi()));
+        hmet_dphi = TMath::ACos(TMath::Cos(fmet->getMetPhi() - higgs.Phi()));
+        hj_dr = higgs.DeltaR(jets.at(0).getP4());
+
+        if (njets > 1) {
+            auto hjj = higgs + jets.at(0).getP4() + jets.at(1).getP4();
+            hjj_pT = hjj.Pt();
+            hjj_m = hjj.M();
+        }
     }
 }
 
-void slim_tree::generalFill(std::vector<std::string> cats, jet_factory *fjets, met_factory *fmet, event_info *evt, Float_t weight,
-                            TLorentzVector higgs, Float_t Mt, std::shared_ptr<std::vector<double>> ac_weights, std::string name) {
+void slim_tree::generalFill(unsigned cats, jet_factory *fjets, met_factory *fmet, event_info *evt, Float_t weight,
+                            four_vector higgs, Float_t Mt) {
     // create things needed for later
-    auto jets(fjets->getJets());
-    auto btags(fjets->getBtagJets());
+    const auto &jets(fjets->getJets());
+    const auto &btags(fjets->getBtagJets());
 
     // start filling branches
     evtwt = weight;
@@ -229,7 +443,6 @@ void slim_tree::generalFill(std::vector<std::string> cats, jet_factory *fjets, m
     run = evt->getRun();
     lumi = evt->getLumi();
     higgs_pT = higgs.Pt();
-    higgs_m = higgs.M();
 
     met = fmet->getMet();
     metphi = fmet->getMetPhi();
@@ -243,20 +456,6 @@ void slim_tree::generalFill(std::vector<std::string> cats, jet_factory *fjets, m
     costhetastar = evt->getCosThetaStar();
     Q2V1 = evt->getQ2V1();
     Q2V2 = evt->getQ2V2();
-    ME_sm_VBF = evt->getME_sm_VBF();
-    ME_sm_ggH = evt->getME_sm_ggH();
-    ME_sm_ggH_qqInit = evt->getME_sm_ggH_qqInit();
-    ME_sm_WH = evt->getME_sm_WH();
-    ME_sm_ZH = evt->getME_sm_ZH();
-    ME_ps_VBF = evt->getME_ps_VBF();
-    ME_ps_ggH = evt->getME_ps_ggH();
-    ME_ps_ggH_qqInit = evt->getME_ps_ggH_qqInit();
-    ME_a2_VBF = evt->getME_a2_VBF();
-    ME_L1_VBF = evt->getME_L1_VBF();
-    ME_L1Zg_VBF = evt->getME_L1Zg_VBF();
-    ME_bkg = evt->getME_bkg();
-    ME_bkg1 = evt->getME_bkg1();
-    ME_bkg2 = evt->getME_bkg2();
 
     D0_ggH = evt->getME_sm_ggH() / (evt->getME_sm_ggH() + 1.0 * evt->getME_ps_ggH());
     DCP_ggH = evt->getDCP_ggH();
@@ -267,18 +466,11 @@ void slim_tree::generalFill(std::vector<std::string> cats, jet_factory *fjets, m
     DCP_VBF = evt->getDCP_VBF();
     MELA_D2j = (evt->getME_sm_ggH() + evt->getME_ps_ggH()) / (evt->getME_sm_ggH() + evt->getME_ps_ggH() + 8 * evt->getME_sm_VBF());
 
-    auto met_x = fmet->getMet() * cos(fmet->getMetPhi());
-    auto met_y = fmet->getMet() * sin(fmet->getMetPhi());
-    auto met_pt = sqrt(pow(met_x, 2) + pow(met_y, 2));
-    MT_HiggsMET = sqrt(pow(higgs.Pt() + met_pt, 2) - pow(higgs.Px() + met_x, 2) - pow(higgs.Py() + met_y, 2));
-
     mt = Mt;
     numGenJets = evt->getNumGenJets();
     njets = fjets->getNjets();
     nbjets = fjets->getNbtag();
     // dijet info is only ok if you have 2 jets, imagine that
-    hjj_pT = 0.;
-    hjj_m = 0.;
     dEtajj = 0.;
     dPhijj = 0.;
     j1_pt = 0;
@@ -298,18 +490,11 @@ void slim_tree::generalFill(std::vector<std::string> cats, jet_factory *fjets, m
         j1_pt = jets.at(0).getPt();
         j1_eta = jets.at(0).getEta();
         j1_phi = jets.at(0).getPhi();
-        hj_dphi = TMath::ACos(TMath::Cos(jets.at(0).getPhi() - higgs.Phi()));
-        hj_deta = fabs(jets.at(0).getEta() - higgs.Eta());
-        jmet_dphi = TMath::ACos(TMath::Cos(fmet->getMetPhi() - jets.at(0).getPhi()));
-        hmet_dphi = TMath::ACos(TMath::Cos(fmet->getMetPhi() - higgs.Phi()));
-        hj_dr = higgs.DeltaR(jets.at(0).getP4());
 
         if (njets > 1) {
             j2_pt = jets.at(1).getPt();
             j2_eta = jets.at(1).getEta();
             j2_phi = jets.at(1).getPhi();
-            hjj_pT = (higgs + jets.at(0).getP4() + jets.at(1).getP4()).Pt();
-            hjj_m = (higgs + jets.at(0).getP4() + jets.at(1).getP4()).M();
             dEtajj = fabs(jets.at(0).getEta() - jets.at(1).getEta());
             // dPhijj = TMath::ACos(TMath::Cos((jets.at(0).getPhi() - jets.at(1).getPhi())));
             if (jets.at(0).getEta() > jets.at(1).getEta()) {
@@ -339,6 +524,10 @@ void slim_tree::generalFill(std::vector<std::string> cats, jet_factory *fjets, m
         }
     }
 
+    if (derived) {
+        fillDerived(jets, fmet, evt, higgs);
+    }
+
     // reset the categories
     is_signal = 0;
     is_antiLepIso = 0;
@@ -354,68 +543,21 @@ void slim_tree::generalFill(std::vector<std::string> cats, jet_factory *fjets, m
     contamination = 0;
 
     // decide on which selections have been passed
-    for (auto cat : cats) {
-        // regions
-        if (cat == "signal") {
-            is_signal = 1;
-        } else if (cat == "antiTauIso") {
-            is_antiTauIso = 1;
-        } else if (cat == "antiLepIso") {
-            is_antiLepIso = 1;
-        }
-
-        // event charge
-        if (cat == "OS") {
-            OS = 1;
-        }
-    }
+    category = cats;
+    is_signal = (cats & event_category::signal) != 0;
+    is_antiTauIso = (cats & event_category::antiTauIso) != 0;
+    is_antiLepIso = (cats & event_category::antiLepIso) != 0;
+    OS = (cats & event_category::OS) != 0;
 
     sm_weight_nlo = evt->getMadgraphSM();
     mm_weight_nlo = evt->getMadgraphMM();
     ps_weight_nlo = evt->getMadgraphPS();
-
-    // anomolous coupling files
-    if (ac_weights != nullptr) {
-        wt_a1 = ac_weights->at(0);
-        wt_a2 = ac_weights->at(1);
-        wt_a3 = ac_weights->at(2);
-        wt_L1 = ac_weights->at(3);
-        wt_L1Zg = ac_weights->at(4);
-        wt_a2int = ac_weights->at(5);
-        wt_a3int = ac_weights->at(6);
-        wt_L1int = ac_weights->at(7);
-        wt_L1Zgint = ac_weights->at(8);
-
-        wt_ggH_a1 = ac_weights->at(9);
-        wt_ggH_a3 = ac_weights->at(10);
-        wt_ggH_a3int = ac_weights->at(11);
-
-        wt_wh_a1 = ac_weights->at(12);
-        wt_wh_a2 = ac_weights->at(13);
-        wt_wh_a3 = ac_weights->at(14);
-        wt_wh_L1 = ac_weights->at(15);
-        wt_wh_L1Zg = ac_weights->at(16);
-        wt_wh_a2int = ac_weights->at(17);
-        wt_wh_a3int = ac_weights->at(18);
-        wt_wh_L1int = ac_weights->at(19);
-        wt_wh_L1Zgint = ac_weights->at(20);
-
-        wt_zh_a1 = ac_weights->at(21);
-        wt_zh_a2 = ac_weights->at(22);
-        wt_zh_a3 = ac_weights->at(23);
-        wt_zh_L1 = ac_weights->at(24);
-        wt_zh_L1Zg = ac_weights->at(25);
-        wt_zh_a2int = ac_weights->at(26);
-        wt_zh_a3int = ac_weights->at(27);
-        wt_zh_L1int = ac_weights->at(28);
-        wt_zh_L1Zgint = ac_weights->at(29);
-    }
 }
 
-void slim_tree::fillTree(std::vector<std::string> cat, electron *el, tau *t, jet_factory *fjets, met_factory *fmet, event_info *evt, Float_t mt,
-                         Float_t weight, std::shared_ptr<std::vector<double>> ac_weights, std::string name) {
-    TLorentzVector higgs(el->getP4() + t->getP4() + fmet->getP4());
-    generalFill(cat, fjets, fmet, evt, weight, higgs, mt, ac_weights, name);
+void slim_tree::fillTree(unsigned cat, electron *el, tau *t, jet_factory *fjets, met_factory *fmet, event_info *evt, Float_t mt,
+                         Float_t weight, const process_info &proc) {
+    four_vector higgs(el->getP4() + t->getP4() + fmet->getP4());
+    generalFill(cat, fjets, fmet, evt, weight, higgs, mt);
 
     el_pt = el->getPt();
     el_eta = el->getEta();
@@ -441,9 +583,10 @@ void slim_tree::fillTree(std::vector<std::string> cat, electron *el, tau *t, jet
     dmf = t->getDecayModeFinding();
     dmf_new = t->getDecayModeFindingNew();
     vis_mass = (el->getP4() + t->getP4()).M();
-    if ((name == "ZTT" || name == "TTT" || name == "STT" || name == "VVT") &&
+    if (proc.has(process_traits::embed_overlap) &&
         (el->getGenMatch() > 2 && el->getGenMatch() < 6 && t->getGenMatch() > 2 && t->getGenMatch() < 6)) {
         contamination = 1;  // mc contaminating embedded samples
+        category |= event_category::contamination;
     }
     cross_trigger = evt->getPassCrossTrigger(el->getPt());
     lep_dr = el->getP4().DeltaR(t->getP4());
@@ -451,10 +594,10 @@ void slim_tree::fillTree(std::vector<std::string> cat, electron *el, tau *t, jet
     otree->Fill();
 }
 
-void slim_tree::fillTree(std::vector<std::string> cat, muon *mu, tau *t, jet_factory *fjets, met_factory *fmet, event_info *evt, Float_t mt,
-                         Float_t weight, std::shared_ptr<std::vector<double>> ac_weights, std::string name) {
-    TLorentzVector higgs(mu->getP4() + t->getP4() + fmet->getP4());
-    generalFill(cat, fjets, fmet, evt, weight, higgs, mt, ac_weights, name);
+void slim_tree::fillTree(unsigned cat, muon *mu, tau *t, jet_factory *fjets, met_factory *fmet, event_info *evt, Float_t mt,
+                         Float_t weight, const process_info &proc) {
+    four_vector higgs(mu->getP4() + t->getP4() + fmet->getP4());
+    generalFill(cat, fjets, fmet, evt, weight, higgs, mt);
 
     mu_pt = mu->getPt();
     mu_eta = mu->getEta();
@@ -480,9 +623,10 @@ void slim_tree::fillTree(std::vector<std::string> cat, muon *mu, tau *t, jet_fac
     dmf = t->getDecayModeFinding();
     dmf_new = t->getDecayModeFindingNew();
     vis_mass = (mu->getP4() + t->getP4()).M();
-    if ((name == "ZTT" || name == "TTT" || name == "STT" || name == "VVT") &&
+    if (proc.has(process_traits::embed_overlap) &&
         (mu->getGenMatch() > 2 && mu->getGenMatch() < 6 && t->getGenMatch() > 2 && t->getGenMatch() < 6)) {
         contamination = 1;  // mc contaminating embedded samples
+        category |= event_category::contamination;
     }
     cross_trigger = evt->getPassCrossTrigger(mu->getPt());
     lep_dr = mu->getP4().DeltaR(t->getP4());
@@ -4,9 +4,13 @@
 #define INCLUDE_SWISS_ARMY_CLASS_H_
 
 // system include
+#include <algorithm>
 #include <map>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+#include "./syst_descriptor.h"
 
 // ROOT include
 #include "TFile.h"
@@ -34,7 +38,7 @@ class Helper {
     std::unordered_map<std::string, TH2F *> *getHistos2D() { return &histos_2d; }
 
     Float_t deltaR(Float_t eta1, Float_t phi1, Float_t eta2, Float_t phi2) { return sqrt(pow(eta1 - eta2, 2) + pow(phi1 - phi2, 2)); }
-    Float_t embed_tracking(Float_t, std::string);
+    Float_t embed_tracking(Float_t, const syst_descriptor &);
 };
 
 Helper::Helper(TFile *fout, std::string name, std::string syst)
@@ -109,35 +113,55 @@ Helper::Helper(TFile *fout, std::string name, std::string syst)
                 {"tau_pt", new TH1F("tau_pt", "tau_pt", 12, 0, 300)},
                 {"triggers", new TH1F("triggers", "triggers", 4, -0.5, 3.5)}} {
     std::string suffix = systematics[syst];
+
+    // without an output file, the histograms don't belong to any directory
+    if (fout == nullptr) {
+        for (auto &histo : histos_1d) {
+            histo.second->SetDirectory(nullptr);
+        }
+    }
 };
 
-Float_t Helper::embed_tracking(Float_t decay_mode, std::string syst = "") {
+Float_t Helper::embed_tracking(Float_t decay_mode, const syst_descriptor &syst = syst_descriptor()) {
   Float_t total(1.), total_syst(0.);
   Float_t sf(.99), prong(0.975), pizero(1.051);
   Float_t dm0_syst(0.008), dm1_syst(0.016124515), dm10_syst(0.013856406), dm11_syst(0.019697716);
 
+  bool shifted = syst.is(syst_source::tracking) && syst.getIndex() == decay_mode;
   if (decay_mode == 0) {
     total = sf * prong;
-    total_syst = syst.find("tracking_DM0") != std::string::npos ? dm0_syst : 0.;
+    total_syst = shifted ? dm0_syst : 0.;
   } else if (decay_mode == 1) {
     total = sf * prong * pizero;
-    total_syst = syst.find("tracking_DM1_") != std::string::npos ? dm1_syst : 0.;
+    total_syst = shifted ? dm1_syst : 0.;
   } else if (decay_mode == 10) {
     total = sf * prong * prong * prong;
-    total_syst = syst.find("tracking_DM10") != std::string::npos ? dm10_syst : 0.;
+    total_syst = shifted ? dm10_syst : 0.;
   } else if (decay_mode == 11) {
     total = sf * prong * prong * prong * pizero;
-    total_syst = syst.find("tracking_DM11") != std::string::npos ? dm11_syst : 0.;
+    total_syst = shifted ? dm11_syst : 0.;
   } else {
     std::cerr << "Invalid decay mode " << decay_mode << std::endl;
     return 1;
   }
   
-  if (syst.find("down") != std::string::npos) {
+  if (syst.isDown()) {
     total_syst *= -1;
   }
 
   return total + total_syst;
 }
 
+// sources of the systematics that only change the event weight. These don't need their own
+// selection and can be stored as weights in the nominal tree. Keep in sync with
+// WEIGHT_SOURCES in automate_analysis.py
+const std::vector<syst_source> weight_sources{syst_source::tau_id_pt,        syst_source::tau_id_vse_vvvloose,
+                                              syst_source::mc_cross_trigger, syst_source::dy_shape,
+                                              syst_source::ttbar_shape,      syst_source::ggh_rivet,
+                                              syst_source::vbf_rivet,        syst_source::tracking};
+
+bool is_weight_syst(const syst_descriptor &syst) {
+    return std::find(weight_sources.begin(), weight_sources.end(), syst.getSource()) != weight_sources.end();
+}
+
 #endif  // INCLUDE_SWISS_ARMY_CLASS_H_
@@ -0,0 +1,244 @@
+// Copyright [2020] Tyler Mitchell
+
+#ifndef INCLUDE_SYST_DESCRIPTOR_H_
+#define INCLUDE_SYST_DESCRIPTOR_H_
+
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+enum class syst_source {
+    nominal,
+    tau_es,                // DM0_Up, DM10_Down, ...
+    efaket_es,             // efaket_es_barrel_DM0_Up, ...
+    efaket_norm,           // efaket_norm_pt30to40_Up, ...
+    mfaket_es,             // mfaket_es_DM0_Up, ...
+    tau_id_pt,             // tau_id_pt_30to35_Up, ...
+    tau_id_el_disc,        // tau_id_el_disc_DM0_barrel_Up, ...
+    tau_id_mu_disc,        // tau_id_mu_disc_eta_lt0p4_Up, ...
+    tau_id_vse_vvvloose,
+    tau_id_vsmu_vloose,
+    mc_single_trigger,
+    mc_cross_trigger,
+    embed_single_trigger,
+    embed_cross_trigger,
+    dy_shape,
+    ttbar_shape,
+    ggh_rivet,             // ggH_Rivet0_Up, ...
+    vbf_rivet,             // VBF_Rivet0_Up, ...
+    tracking,              // tracking_DM0_up, ...
+    prefiring,
+    ees_scale,
+    ees_sigma,
+    mes,
+    jes,                   // Jet*
+    ues,
+    recoil,
+    other
+};
+
+enum class syst_direction { none, up, down };
+
+// the object a shift changes
+enum class syst_object { none, tau, fake_tau, electron, muon, jet, met, event };
+
+//////////////////////////////////////////////////////
+// Purpose: To parse the name of a systematic shift //
+// (-u) once per job. The source, direction, the    //
+// decay mode or Rivet index and the pT/|eta| bin   //
+// are kept as numbers, so the event loop, the      //
+// factories and the weighters only compare enums   //
+// and floats instead of searching the name.        //
+//                                                  //
+// A default descriptor is the nominal shift.       //
+//////////////////////////////////////////////////////
+class syst_descriptor {
+ private:
+    std::string name;
+    syst_source source;
+    syst_direction direction;
+    syst_object object;
+    int index;         // decay mode or Rivet source, -1 if there isn't one
+    float low, high;   // pT or |eta| bin [low, high)
+
+    void parse();
+
+ public:
+    syst_descriptor() : syst_descriptor("") {}
+    explicit syst_descriptor(std::string);
+
+    std::string getName() const { return name; }
+    syst_source getSource() const { return source; }
+    syst_direction getDirection() const { return direction; }
+    syst_object getObject() const { return object; }
+    int getIndex() const { return index; }
+    float getLow() const { return low; }
+    float getHigh() const { return high; }
+
+    bool is(syst_source _source) const { return source == _source; }
+    bool is(syst_source _source, syst_direction _direction) const { return source == _source && direction == _direction; }
+    bool isNominal() const { return source == syst_source::nominal; }
+    bool isUp() const { return direction == syst_direction::up; }
+    bool isDown() const { return direction == syst_direction::down; }
+    bool inBin(float x) const { return x >= low && x < high; }
+};
+
+syst_descriptor::syst_descriptor(std::string _name)
+    : name(_name),
+      source(syst_source::nominal),
+      direction(syst_direction::none),
+      object(syst_object::none),
+      index(-1),
+      low(0.),
+      high(std::numeric_limits<float>::infinity()) {
+    parse();
+}
+
+namespace syst_utils {
+
+bool starts_with(const std::string &name, const std::string &prefix) { return name.compare(0, prefix.size(), prefix) == 0; }
+
+bool ends_with(const std::string &name, const std::string &suffix) {
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// number right after the first occurrence of token, i.e. 10 for "DM" in "tracking_DM10_up", or -1
+int number_after(const std::string &name, const std::string &token) {
+    auto pos = name.find(token);
+    if (pos == std::string::npos || pos + token.size() >= name.size() || !std::isdigit(name.at(pos + token.size()))) {
+        return -1;
+    }
+    return std::atoi(name.c_str() + pos + token.size());
+}
+
+struct bin {
+    const char *token;
+    float low, high;
+};
+
+}  // namespace syst_utils
+
+void syst_descriptor::parse() {
+    using syst_utils::bin;
+    using syst_utils::ends_with;
+    using syst_utils::number_after;
+    using syst_utils::starts_with;
+    auto inf = std::numeric_limits<float>::infinity();
+
+    if (name.empty()) {
+        return;
+    }
+
+    if (ends_with(name, "Up") || ends_with(name, "up")) {
+        direction = syst_direction::up;
+    } else if (ends_with(name, "Down") || ends_with(name, "down")) {
+        direction = syst_direction::down;
+    }
+
+    // bins are matched by their token in the name
+    auto find_bin = [this](std::vector<bin> bins) {
+        for (auto &b : bins) {
+            if (name.find(b.token) != std::string::npos) {
+                low = b.low;
+                high = b.high;
+                return;
+            }
+        }
+        low = high = 0.;  // no bin matches anything
+    };
+
+    // order matters where one prefix starts another one
+    if (starts_with(name, "DM0") || starts_with(name, "DM1")) {
+        source = syst_source::tau_es;
+        object = syst_object::tau;
+        index = number_after(name, "DM");
+    } else if (starts_with(name, "efaket_es")) {
+        source = syst_source::efaket_es;
+        object = syst_object::fake_tau;
+        index = number_after(name, "DM");
+    } else if (starts_with(name, "efaket_norm")) {
+        source = syst_source::efaket_norm;
+        object = syst_object::fake_tau;
+        find_bin({{"pt30to40", 30., 40.}, {"pt40to50", 40., 50.}, {"ptgt50", 50., inf}});
+    } else if (starts_with(name, "mfaket_es")) {
+        source = syst_source::mfaket_es;
+        object = syst_object::fake_tau;
+        index = number_after(name, "DM");
+    } else if (starts_with(name, "tau_id_pt_")) {
+        source = syst_source::tau_id_pt;
+        object = syst_object::tau;
+        find_bin({{"30to35", 30., 35.}, {"35to40", 35., 40.}, {"ptgt40", 40., inf}});
+    } else if (starts_with(name, "tau_id_el_disc")) {
+        source = syst_source::tau_id_el_disc;
+        object = syst_object::tau;
+        index = number_after(name, "DM");
+        find_bin({{"barrel", 0., 1.479}, {"endcap", 1.479, inf}});
+    } else if (starts_with(name, "tau_id_mu_disc")) {
+        source = syst_source::tau_id_mu_disc;
+        object = syst_object::tau;
+        find_bin({{"eta_lt0p4", 0., 0.4}, {"eta_0p4to0p8", 0.4, 0.8}, {"eta_0p8to1p2", 0.8, 1.2}, {"eta_1p2to1p7", 1.2, 1.7}, {"eta_gt1p7", 1.7, inf}});
+    } else if (starts_with(name, "tau_id_vse_vvvloose")) {
+        source = syst_source::tau_id_vse_vvvloose;
+        object = syst_object::tau;
+    } else if (starts_with(name, "tau_id_vsmu_vloose")) {
+        source = syst_source::tau_id_vsmu_vloose;
+        object = syst_object::tau;
+    } else if (starts_with(name, "mc_single_trigger")) {
+        source = syst_source::mc_single_trigger;
+        object = syst_object::event;
+    } else if (starts_with(name, "mc_cross_trigger")) {
+        source = syst_source::mc_cross_trigger;
+        object = syst_object::event;
+    } else if (starts_with(name, "embed_single_trigger")) {
+        source = syst_source::embed_single_trigger;
+        object = syst_object::event;
+    } else if (starts_with(name, "embed_cross_trigger")) {
+        source = syst_source::embed_cross_trigger;
+        object = syst_object::event;
+    } else if (starts_with(name, "dyShape")) {
+        source = syst_source::dy_shape;
+        object = syst_object::event;
+    } else if (starts_with(name, "ttbarShape")) {
+        source = syst_source::ttbar_shape;
+        object = syst_object::event;
+    } else if (starts_with(name, "ggH_Rivet")) {
+        source = syst_source::ggh_rivet;
+        object = syst_object::event;
+        index = number_after(name, "Rivet");
+    } else if (starts_with(name, "VBF_Rivet")) {
+        source = syst_source::vbf_rivet;
+        object = syst_object::event;
+        index = number_after(name, "Rivet");
+    } else if (starts_with(name, "tracking_DM")) {
+        source = syst_source::tracking;
+        object = syst_object::tau;
+        index = number_after(name, "DM");
+    } else if (starts_with(name, "prefiring")) {
+        source = syst_source::prefiring;
+        object = syst_object::event;
+    } else if (starts_with(name, "EEScale")) {
+        source = syst_source::ees_scale;
+        object = syst_object::electron;
+    } else if (starts_with(name, "EESigma")) {
+        source = syst_source::ees_sigma;
+        object = syst_object::electron;
+    } else if (starts_with(name, "MES")) {
+        source = syst_source::mes;
+        object = syst_object::muon;
+    } else if (starts_with(name, "Jet")) {
+        source = syst_source::jes;
+        object = syst_object::jet;
+    } else if (starts_with(name, "UES")) {
+        source = syst_source::ues;
+        object = syst_object::met;
+    } else if (starts_with(name, "Recoil")) {
+        source = syst_source::recoil;
+        object = syst_object::met;
+    } else {
+        source = syst_source::other;
+    }
+}
+
+#endif  // INCLUDE_SYST_DESCRIPTOR_H_
@@ -7,7 +7,9 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include "TLorentzVector.h"
+#include "./branch_manifest.h"
+#include "./four_vector.h"
+#include "./syst_descriptor.h"
 #include "TTree.h"
 
 class tau_factory;
@@ -28,7 +30,7 @@ class tau {
     Bool_t AgainstTightElectronMVA, AgainstVLooseElectronMVA, AgainstTightMuonMVA, AgainstLooseMuonMVA;
     Bool_t AgainstTightElectronDeep, AgainstVVLooseElectronDeep, AgainstVVVLooseElectronDeep, AgainstTightMuonDeep, AgainstVLooseMuonDeep;
 
-    TLorentzVector p4;
+    four_vector p4;
 
  public:
     tau(Float_t, Float_t, Float_t, Float_t, Float_t);
@@ -46,7 +48,7 @@ class tau {
 
     // getters
     std::string getName() { return name; }
-    TLorentzVector getP4() { return p4; }
+    four_vector getP4() { return p4; }
     Float_t getPt() { return p4.Pt(); }
     Float_t getEta() { return p4.Eta(); }
     Float_t getPhi() { return p4.Phi(); }
@@ -85,7 +87,7 @@ class tau {
     Int_t getCharge() { return charge; }
 };
 
-// initialize member data and set TLorentzVector
+// initialize member data and set the four-vector
 tau::tau(Float_t Pt, Float_t Eta, Float_t Phi, Float_t M, Float_t Charge) : pt(Pt), eta(Eta), phi(Phi), mass(M), charge(Charge) {
     p4.SetPtEtaPhiM(pt, eta, phi, mass);
 }
@@ -96,7 +98,8 @@ tau::tau(Float_t Pt, Float_t Eta, Float_t Phi, Float_t M, Float_t Charge) : pt(P
 /////////////////////////////////////////////////
 class tau_factory {
  private:
-    std::string syst;
+    std::vector<syst_descriptor> systs;  // parsed once, selected with setSyst
+    std::size_t active;
     Int_t gen_match_2, era;
     Float_t px_2, py_2, pz_2, pt_2, eta_2, phi_2, m_2, e_2, iso_2, q_2, mt_2, tZTTGenPt, tZTTGenEta, tZTTGenPhi;
     Float_t againstElectronTightMVA6_2, againstElectronVLooseMVA6_2, againstMuonTight3_2, againstMuonLoose3_2, decayMode, dmf, dmf_new;
@@ -106,56 +109,64 @@ class tau_factory {
     Float_t tVVVLooseDeepTau2017v2p1VSjet, tVLooseDeepTau2017v2p1VSjet, tLooseDeepTau2017v2p1VSjet, tMediumDeepTau2017v2p1VSjet,
         tTightDeepTau2017v2p1VSjet, tVTightDeepTau2017v2p1VSjet, tVVTightDeepTau2017v2p1VSjet, deepiso_2;
     Float_t tes_syst_up, tes_syst_down, ftes_syst_up, ftes_syst_down;
+    branch_manifest manifest;  // every input branch that is read
 
  public:
     tau_factory(TTree*, int, std::string);
+    tau_factory(TTree*, int, std::vector<std::string>);
     virtual ~tau_factory() {}
+    void setSyst(std::size_t idx) { active = idx; }
+    const branch_manifest &getManifest() const { return manifest; }
     tau run_factory();
 };
 
 // read data from tree Int_to member variables
-tau_factory::tau_factory(TTree* input, int _era, std::string _syst) : era(_era), syst(_syst) {
-    input->SetBranchAddress("pt_2", &pt_2);
-    input->SetBranchAddress("eta_2", &eta_2);
-    input->SetBranchAddress("phi_2", &phi_2);
-    input->SetBranchAddress("m_2", &m_2);
-    input->SetBranchAddress("e_2", &e_2);
-    input->SetBranchAddress("q_2", &q_2);
-    input->SetBranchAddress("gen_match_2", &gen_match_2);
-    input->SetBranchAddress("tZTTGenPt", &tZTTGenPt);
-    input->SetBranchAddress("tZTTGenEta", &tZTTGenEta);
-    input->SetBranchAddress("tZTTGenPhi", &tZTTGenPhi);
-    input->SetBranchAddress("tDecayMode", &decayMode);
-    input->SetBranchAddress("tDecayModeFinding", &dmf);
-    input->SetBranchAddress("tDecayModeFindingNewDMs", &dmf_new);
-    input->SetBranchAddress("tAgainstElectronTightMVA6", &againstElectronTightMVA6_2);
-    input->SetBranchAddress("tAgainstElectronVLooseMVA6", &againstElectronVLooseMVA6_2);
-    input->SetBranchAddress("tAgainstMuonTight3", &againstMuonTight3_2);
-    input->SetBranchAddress("tAgainstMuonLoose3", &againstMuonLoose3_2);
-    input->SetBranchAddress("tTightDeepTau2017v2p1VSe", &tTightDeepTau2017v2p1VSe);
-    input->SetBranchAddress("tVVLooseDeepTau2017v2p1VSe", &tVVLooseDeepTau2017v2p1VSe);
-    input->SetBranchAddress("tVVVLooseDeepTau2017v2p1VSe", &tVVVLooseDeepTau2017v2p1VSe);
-    input->SetBranchAddress("tTightDeepTau2017v2p1VSmu", &tTightDeepTau2017v2p1VSmu);
-    input->SetBranchAddress("tVLooseDeepTau2017v2p1VSmu", &tVLooseDeepTau2017v2p1VSmu);
-    input->SetBranchAddress("tRerunMVArun2v2DBoldDMwLTraw", &iso_2);
-    input->SetBranchAddress("tRerunMVArun2v2DBoldDMwLTVLoose", &byVLooseIsolationMVArun2v1DBoldDMwLT_2);
-    input->SetBranchAddress("tRerunMVArun2v2DBoldDMwLTLoose", &byLooseIsolationMVArun2v1DBoldDMwLT_2);
-    input->SetBranchAddress("tRerunMVArun2v2DBoldDMwLTMedium", &byMediumIsolationMVArun2v1DBoldDMwLT_2);
-    input->SetBranchAddress("tRerunMVArun2v2DBoldDMwLTTight", &byTightIsolationMVArun2v1DBoldDMwLT_2);
-    input->SetBranchAddress("tRerunMVArun2v2DBoldDMwLTVTight", &byVTightIsolationMVArun2v1DBoldDMwLT_2);
-    input->SetBranchAddress("tRerunMVArun2v2DBoldDMwLTVVTight", &byVVTightIsolationMVArun2v1DBoldDMwLT_2);
-    input->SetBranchAddress("tDeepTau2017v2p1VSjetraw", &deepiso_2);
-    input->SetBranchAddress("tVVVLooseDeepTau2017v2p1VSjet", &tVVVLooseDeepTau2017v2p1VSjet);
-    input->SetBranchAddress("tVLooseDeepTau2017v2p1VSjet", &tVLooseDeepTau2017v2p1VSjet);
-    input->SetBranchAddress("tLooseDeepTau2017v2p1VSjet", &tLooseDeepTau2017v2p1VSjet);
-    input->SetBranchAddress("tMediumDeepTau2017v2p1VSjet", &tMediumDeepTau2017v2p1VSjet);
-    input->SetBranchAddress("tTightDeepTau2017v2p1VSjet", &tTightDeepTau2017v2p1VSjet);
-    input->SetBranchAddress("tVTightDeepTau2017v2p1VSjet", &tVTightDeepTau2017v2p1VSjet);
-    input->SetBranchAddress("tVVTightDeepTau2017v2p1VSjet", &tVVTightDeepTau2017v2p1VSjet);
-    input->SetBranchAddress("tes_syst_up", &tes_syst_up);
-    input->SetBranchAddress("tes_syst_down", &tes_syst_down);
-    input->SetBranchAddress("ftes_syst_up", &ftes_syst_up);
-    input->SetBranchAddress("ftes_syst_down", &ftes_syst_down);
+tau_factory::tau_factory(TTree* input, int _era, std::string _syst) : tau_factory(input, _era, std::vector<std::string>{_syst}) {}
+
+// read data for several systematic shifts at once. Shifts are selected with setSyst
+tau_factory::tau_factory(TTree* input, int _era, std::vector<std::string> _systs)
+    : systs(_systs.begin(), _systs.end()), active(0), era(_era) {
+    manifest.bind(input, "pt_2", &pt_2);
+    manifest.bind(input, "eta_2", &eta_2);
+    manifest.bind(input, "phi_2", &phi_2);
+    manifest.bind(input, "m_2", &m_2);
+    manifest.bind(input, "e_2", &e_2);
+    manifest.bind(input, "q_2", &q_2);
+    manifest.bind(input, "gen_match_2", &gen_match_2);
+    manifest.bind(input, "tZTTGenPt", &tZTTGenPt);
+    manifest.bind(input, "tZTTGenEta", &tZTTGenEta);
+    manifest.bind(input, "tZTTGenPhi", &tZTTGenPhi);
+    manifest.bind(input, "tDecayMode", &decayMode);
+    manifest.bind(input, "tDecayModeFinding", &dmf);
+    manifest.bind(input, "tDecayModeFindingNewDMs", &dmf_new);
+    manifest.bind(input, "tAgainstElectronTightMVA6", &againstElectronTightMVA6_2);
+    manifest.bind(input, "tAgainstElectronVLooseMVA6", &againstElectronVLooseMVA6_2);
+    manifest.bind(input, "tAgainstMuonTight3", &againstMuonTight3_2);
+    manifest.bind(input, "tAgainstMuonLoose3", &againstMuonLoose3_2);
+    manifest.bind(input, "tTightDeepTau2017v2p1VSe", &tTightDeepTau2017v2p1VSe);
+    manifest.bind(input, "tVVLooseDeepTau2017v2p1VSe", &tVVLooseDeepTau2017v2p1VSe);
+    manifest.bind(input, "tVVVLooseDeepTau2017v2p1VSe", &tVVVLooseDeepTau2017v2p1VSe);
+    manifest.bind(input, "tTightDeepTau2017v2p1VSmu", &tTightDeepTau2017v2p1VSmu);
+    manifest.bind(input, "tVLooseDeepTau2017v2p1VSmu", &tVLooseDeepTau2017v2p1VSmu);
+    manifest.bind(input, "tRerunMVArun2v2DBoldDMwLTraw", &iso_2);
+    manifest.bind(input, "tRerunMVArun2v2DBoldDMwLTVLoose", &byVLooseIsolationMVArun2v1DBoldDMwLT_2);
+    manifest.bind(input, "tRerunMVArun2v2DBoldDMwLTLoose", &byLooseIsolationMVArun2v1DBoldDMwLT_2);
+    manifest.bind(input, "tRerunMVArun2v2DBoldDMwLTMedium", &byMediumIsolationMVArun2v1DBoldDMwLT_2);
+    manifest.bind(input, "tRerunMVArun2v2DBoldDMwLTTight", &byTightIsolationMVArun2v1DBoldDMwLT_2);
+    manifest.bind(input, "tRerunMVArun2v2DBoldDMwLTVTight", &byVTightIsolationMVArun2v1DBoldDMwLT_2);
+    manifest.bind(input, "tRerunMVArun2v2DBoldDMwLTVVTight", &byVVTightIsolationMVArun2v1DBoldDMwLT_2);
+    manifest.bind(input, "tDeepTau2017v2p1VSjetraw", &deepiso_2);
+    manifest.bind(input, "tVVVLooseDeepTau2017v2p1VSjet", &tVVVLooseDeepTau2017v2p1VSjet);
+    manifest.bind(input, "tVLooseDeepTau2017v2p1VSjet", &tVLooseDeepTau2017v2p1VSjet);
+    manifest.bind(input, "tLooseDeepTau2017v2p1VSjet", &tLooseDeepTau2017v2p1VSjet);
+    manifest.bind(input, "tMediumDeepTau2017v2p1VSjet", &tMediumDeepTau2017v2p1VSjet);
+    manifest.bind(input, "tTightDeepTau2017v2p1VSjet", &tTightDeepTau2017v2p1VSjet);
+    manifest.bind(input, "tVTightDeepTau2017v2p1VSjet", &tVTightDeepTau2017v2p1VSjet);
+    manifest.bind(input, "tVVTightDeepTau2017v2p1VSjet", &tVVTightDeepTau2017v2p1VSjet);
+    manifest.bind(input, "tes_syst_up", &tes_syst_up);
+    manifest.bind(input, "tes_syst_down", &tes_syst_down);
+    manifest.bind(input, "ftes_syst_up", &ftes_syst_up);
+    manifest.bind(input, "ftes_syst_down", &ftes_syst_down);
 }
 
 // create electron object and set member data
@@ -194,12 +205,13 @@ tau tau_factory::run_factory() {
     t.gen_phi = tZTTGenPhi;
 
     // handle shifting tau four-momenta for energy scale systematics
+    const syst_descriptor& syst = systs[active];
     Float_t scale(0.);
-    if (t.gen_match == 5 && (syst.substr(0, 3) == "DM0" || syst.substr(0, 3) == "DM1")) {
-        scale = syst.find("Up") == std::string::npos ? tes_syst_up : tes_syst_down;
+    if (t.gen_match == 5 && syst.is(syst_source::tau_es)) {
+        scale = syst.isUp() ? tes_syst_down : tes_syst_up;
         t.scaleTES(1 + scale);
-    } else if (t.gen_match < 5 && (syst.substr(0, 6) == "efaket" || syst.substr(0, 6) == "mfaket")) {
-        scale = syst.find("Up") == std::string::npos ? ftes_syst_up : ftes_syst_down;
+    } else if (t.gen_match < 5 && syst.getObject() == syst_object::fake_tau) {
+        scale = syst.isUp() ? ftes_syst_down : ftes_syst_up;
         t.scaleTES(1 + scale);
     }
 
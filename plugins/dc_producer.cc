@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "../include/CLParser.h"
+#include "../include/job_timer.h"
 #include "../include/json.hpp"
 #include "TFile.h"
 #include "TH2F.h"
@@ -30,14 +31,16 @@ class file_processor {
     std::shared_ptr<TFile> fout;
     bool is_jetFakes;
     Int_t isolation, contamination;
-    Double_t fake_weight, NN_disc;
-    Float_t evtwt, njets, mjj, t1_pt, m_sv, higgs_pt;
+    Double_t NN_disc;
+    Float_t evtwt, fake_weight, njets, mjj, t1_pt, m_sv, higgs_pt;
     vector<string> vbf_cats;
     vector<double> tau_pt_bins, m_sv_bins_0jet, higgs_pT_bins_boost, m_sv_bins_boost, vbf_cat_x_bins, vbf_cat_y_bins;
     unordered_map<string, Float_t> vbf_vars;
-    unordered_map<string, Double_t> other_vars;
+    unordered_map<string, Float_t> other_vars;
     unordered_map<string, vector<TH2F *> *> all_histograms;
 
+    void fill_histograms(vector<TH2F *> *, double, int);
+
    public:
     string xvar_name, yvar_name, zvar_name, dcp_name, channel;
     vector<double> edges;
@@ -46,14 +49,15 @@ class file_processor {
     void register_branches(TTree *, bool);
     bool register_new_branch(TTree *, string);
     void create_histograms(string);
-    void process_file(TTree *, string, int);
-    void process_file_with_weights(TTree *, string, int, vector<std::pair<string, string>>, bool);
+    void process_file(TTree *, string, int, vector<std::pair<string, string>>);
     void write(vector<string>);
 };
 
 void read_directory(const string &, vector<string> *, string match = "");
 unordered_map<string, vector<string>> build_file_paths(string);
 string format_output_name(string, bool, bool, string, int, int, string);
+string format_syst_name(string, string, string);
+string embed_syst_name(string);
 TH2F *build_histogram(string, vector<double>, vector<double>);
 
 int main(int argc, char *argv[]) {
@@ -68,6 +72,10 @@ int main(int argc, char *argv[]) {
     string year = parser.Option("-y");
     string suffix = parser.Option("-x");
 
+    // time each stage of the job
+    job_timer timer("dc_producer_" + channel + "_" + year);
+    auto stage_timer = timer.time("setup");
+
     // get input file directory
     if (dir.empty()) {
         std::cerr << "You must give an input directory" << std::endl;
@@ -169,9 +177,7 @@ int main(int argc, char *argv[]) {
             return -1;
         }
 
-        orig_syst_name = std::regex_replace(orig_syst_name, std::regex("YEAR"), year);
-        orig_syst_name = std::regex_replace(orig_syst_name, std::regex("LEP"), (channel == "et" ? "ele" : "mu"));
-        orig_syst_name = std::regex_replace(orig_syst_name, std::regex("CHAN"), channel);
+        orig_syst_name = format_syst_name(orig_syst_name, year, channel);
 
         std::cout << fp.first << " -> " << orig_syst_name << std::endl;
 
@@ -194,65 +200,69 @@ int main(int argc, char *argv[]) {
                 continue;
             }
 
-            std::string syst_name = orig_syst_name;
-            if (is_embed) {
-                if (syst_name.find("CMS_tauideff") != string::npos) {
-                    syst_name = std::regex_replace(syst_name, std::regex("tauideff"), "eff_t_embedded");
-                } else if (syst_name.find("CMS_scale_e_") != string::npos) {
-                    syst_name = std::regex_replace(syst_name, std::regex("scale_e_"), "scale_emb_e");
-                } else if ((syst_name.find("CMS_single") != string::npos && syst_name.find("trg") != string::npos) ||
-                           syst_name.find("tautrg_") != string::npos) {
-                    syst_name = std::regex_replace(syst_name, std::regex("trg"), "trg_emb");
-                } else if (syst_name.find("CMS_scale_t_") != string::npos) {
-                    syst_name = std::regex_replace(syst_name, std::regex("scale_t_"), "scale_emb_t_");
-                }
-            }
-
-            string name = std::regex_replace(file, std::regex(".root"), "") + syst_name;
+            std::string syst_name = is_embed ? embed_syst_name(orig_syst_name) : orig_syst_name;
+            auto process_name = std::regex_replace(file, std::regex(".root"), "");
+            string name = process_name + syst_name;
             std::cout << name << std::endl;
 
             p->create_histograms(name);
 
+            stage_timer = timer.time("open input");
             auto fin = TFile::Open((dir + "/" + fp.first + "/" + file).c_str());
             auto tree = reinterpret_cast<TTree *>(fin->Get((channel + "_tree").c_str()));
             p->register_branches(tree, is_jetFakes);
-            p->process_file(tree, name, DCP_idx);
-            fin->Close();
 
-            // handle jet systematics
-            if (is_jetFakes && do_syst) {
-                auto fin = TFile::Open((dir + "/" + fp.first + "/" + file).c_str());
-                auto tree = reinterpret_cast<TTree *>(fin->Get((channel + "_tree").c_str()));
-                p->register_branches(tree, is_jetFakes);
-                vector<std::pair<string, string>> weights;
-                for (auto &s : fake_factor_systematics) {
-                    // make sure we know how to map this systematic
-                    std::string syst_name("");
-                    if (syst_name_map.find(s) != syst_name_map.end()) {
-                        syst_name = syst_name_map.at(s);
-                    } else if (fp.first != "nominal") {
-                        std::cerr << "\t \033[91m[INFO]  " << fp.first << " is unknown. Skipping...\033[0m" << std::endl;
-                        return -1;
+            // shifted templates stored as weights in the nominal tree are filled in the same pass
+            vector<std::pair<string, string>> weights;
+            if (do_syst && fp.first == "nominal") {
+                if (is_jetFakes) {
+                    // handle jet systematics
+                    for (auto &s : fake_factor_systematics) {
+                        // make sure we know how to map this systematic
+                        if (syst_name_map.find(s) == syst_name_map.end()) {
+                            std::cerr << "\t \033[91m[INFO]  " << s << " is unknown. Skipping...\033[0m" << std::endl;
+                            return -1;
+                        }
+
+                        auto weight_syst_name = format_syst_name(syst_name_map.at(s), year, channel);
+                        if (p->register_new_branch(tree, s)) {
+                            p->create_histograms(process_name + weight_syst_name);
+                            weights.push_back(std::make_pair(s, process_name + weight_syst_name));
+                        }
                     }
+                } else {
+                    // weight-only systematics (evtwt_<syst> branches). A directory with
+                    // the same systematic takes precedence so nothing is filled twice
+                    for (auto &s : syst_name_map) {
+                        if (file_paths.find(s.first) != file_paths.end()) {
+                            continue;
+                        }
 
-                    syst_name = std::regex_replace(syst_name, std::regex("YEAR"), year);
-                    syst_name = std::regex_replace(syst_name, std::regex("LEP"), (channel == "et" ? "ele" : "mu"));
-                    syst_name = std::regex_replace(syst_name, std::regex("CHAN"), channel);
+                        auto weight_syst_name = format_syst_name(s.second, year, channel);
+                        if (is_embed) {
+                            weight_syst_name = embed_syst_name(weight_syst_name);
+                        }
 
-                    auto exists = p->register_new_branch(tree, s);
-                    if (exists) {
-                        p->create_histograms("jetFakes" + syst_name);
-                        weights.push_back(std::make_pair(s, "jetFakes" + syst_name));
+                        if (p->register_new_branch(tree, "evtwt_" + s.first)) {
+                            p->create_histograms(process_name + weight_syst_name);
+                            weights.push_back(std::make_pair("evtwt_" + s.first, process_name + weight_syst_name));
+                        }
                     }
                 }
-                p->process_file_with_weights(tree, name, DCP_idx, weights, true);
-                fin->Close();
             }
+
+            stage_timer = timer.time("fill histograms");
+            stage_timer.addEvents(tree->GetEntries());
+            p->process_file(tree, name, DCP_idx, weights);
+            fin->Close();
         }
     }
 
+    stage_timer = timer.time("write output");
     p->write(all_output_directories);
     fout->Close();
+    stage_timer.stop();
+    timer.write(timer_utils::sidecar_name(output_file_name));
     std::cout << "Processing time: " << watch.RealTime() << std::endl;
 }
 
@@ -332,18 +342,24 @@ void file_processor::register_branches(TTree *tree, bool _is_jetFakes = false) {
     tree->SetBranchAddress("DCP_VBF", &vbf_vars.at("DCP_VBF"));
 }
 
-void file_processor::register_new_branch(TTree *tree, string vname) {
+bool file_processor::register_new_branch(TTree *tree, string vname) {
     if (tree->GetBranch(vname.c_str()) == nullptr) {
-        return false
+        return false;
     }
 
     other_vars[vname] = 0;
     tree->SetBranchAddress(vname.c_str(), &other_vars.at(vname));
-    return true
+    return true;
 }
 
-void file_processor::process_file(TTree *tree, string name, int DCP_idx) {
-    double final_evtwt(1.);
+// fill the nominal histograms and the shifted histograms for each (weight branch, histogram name) pair
+void file_processor::process_file(TTree *tree, string name, int DCP_idx, vector<std::pair<string, string>> weights) {
+    vector<std::pair<Float_t *, vector<TH2F *> *>> shifted;
+    for (auto &w : weights) {
+        shifted.push_back(std::make_pair(&other_vars.at(w.first), all_histograms.at(w.second)));
+    }
+    auto nominal = all_histograms.at(name);
+
     Long64_t nentries = tree->GetEntries();
     for (Long64_t i = 0; i < nentries; i++) {
         tree->GetEntry(i);
@@ -353,66 +369,30 @@ void file_processor::process_file(TTree *tree, string name, int DCP_idx) {
 
         vbf_vars["NN_disc"] = NN_disc;
 
-        // jetFake systematics include evtwt, others don't
-        final_evtwt = include_evtwt ? evtwt : 1.;
-
-        if (njets == 0) {
-            all_histograms.at(name)->at(0)->Fill(t1_pt, m_sv, final_evtwt);
-        } else if (njets == 1 || (njets > 1 && mjj < 300)) {
-            all_histograms.at(name)->at(1)->Fill(higgs_pt, m_sv, final_evtwt);
-        } else if (njets > 1 && mjj > 300) {
-            all_histograms.at(name)->at(2)->Fill(vbf_vars.at(xvar_name), vbf_vars.at(yvar_name), final_evtwt);
-            for (auto j = 0; j < edges.size() - 1; j++) {
-                if (vbf_vars.at(zvar_name) < edges.at(j + 1)) {
-                    auto curr_idx = 3 + j;
-                    if (DCP_idx > 0 && vbf_vars.at(dcp_name) < 0) {
-                        curr_idx += DCP_idx;
-                    }
-                    all_histograms.at(name)->at(curr_idx)->Fill(vbf_vars.at(xvar_name), vbf_vars.at(yvar_name), final_evtwt);
-                    break;
-                }
-            }
+        // jetFakes are weighted by the fake factor and their systematics replace it.
+        // Other weight systematics are the full shifted event weight
+        fill_histograms(nominal, is_jetFakes ? evtwt * fake_weight : evtwt, DCP_idx);
+        for (auto &w : shifted) {
+            fill_histograms(w.second, is_jetFakes ? evtwt * *w.first : *w.first, DCP_idx);
         }
     }
 }
 
-void file_processor::process_file_with_weights(TTree *tree, string name, int DCP_idx, vector<std::pair<string, string>> weights,
-                                               bool include_evtwt = false) {
-    double final_evtwt(1.);
-    Long64_t nentries = tree->GetEntries();
-    for (Long64_t i = 0; i < nentries; i++) {
-        tree->GetEntry(i);
-        if (isolation < 1 || contamination > 0) {
-            continue;
-        }
-
-        vbf_vars["NN_disc"] = NN_disc;
-
-        // jetFake systematics include evtwt, others don't
-        final_evtwt = include_evtwt ? evtwt : 1.;
-
-        if (njets == 0) {
-            for (auto &w : weights) {
-                all_histograms.at(w.second)->at(0)->Fill(t1_pt, m_sv, final_evtwt * other_vars.at(w.first));
-            }
-        } else if (njets == 1 || (njets > 1 && mjj < 300)) {
-            for (auto &w : weights) {
-                all_histograms.at(w.second)->at(1)->Fill(higgs_pt, m_sv, final_evtwt * other_vars.at(w.first));
-            }
-        } else if (njets > 1 && mjj > 300) {
-            for (auto &w : weights) {
-                all_histograms.at(w.second)->at(2)->Fill(vbf_vars.at(xvar_name), vbf_vars.at(yvar_name), final_evtwt * other_vars.at(w.first));
-                for (auto j = 0; j < edges.size() - 1; j++) {
-                    if (vbf_vars.at(zvar_name) < edges.at(j + 1)) {
-                        auto curr_idx = 3 + j;
-                        if (DCP_idx > 0 && vbf_vars.at(dcp_name) < 0) {
-                            curr_idx += DCP_idx;
-                        }
-                        all_histograms.at(w.second)->at(curr_idx)->Fill(vbf_vars.at(xvar_name), vbf_vars.at(yvar_name),
-                                                                        final_evtwt * other_vars.at(w.first));
-                        break;
-                    }
+void file_processor::fill_histograms(vector<TH2F *> *histograms, double weight, int DCP_idx) {
+    if (njets == 0) {
+        histograms->at(0)->Fill(t1_pt, m_sv, weight);
+    } else if (njets == 1 || (njets > 1 && mjj < 300)) {
+        histograms->at(1)->Fill(higgs_pt, m_sv, weight);
+    } else if (njets > 1 && mjj > 300) {
+        histograms->at(2)->Fill(vbf_vars.at(xvar_name), vbf_vars.at(yvar_name), weight);
+        for (auto j = 0; j < edges.size() - 1; j++) {
+            if (vbf_vars.at(zvar_name) < edges.at(j + 1)) {
+                auto curr_idx = 3 + j;
+                if (DCP_idx > 0 && vbf_vars.at(dcp_name) < 0) {
+                    curr_idx += DCP_idx;
                 }
+                histograms->at(curr_idx)->Fill(vbf_vars.at(xvar_name), vbf_vars.at(yvar_name), weight);
+                break;
             }
         }
     }
@@ -442,6 +422,28 @@ string format_output_name(string channel, bool is_ztt, bool is_syst, string year
            std::to_string(day) + suffix + ".root";
 }
 
+// substitute the year, lepton, and channel into the datacard name of a systematic
+string format_syst_name(string syst_name, string year, string channel) {
+    syst_name = std::regex_replace(syst_name, std::regex("YEAR"), year);
+    syst_name = std::regex_replace(syst_name, std::regex("LEP"), (channel == "et" ? "ele" : "mu"));
+    syst_name = std::regex_replace(syst_name, std::regex("CHAN"), channel);
+    return syst_name;
+}
+
+// embedded samples use their own names for efficiencies and energy scales
+string embed_syst_name(string syst_name) {
+    if (syst_name.find("CMS_tauideff") != string::npos) {
+        syst_name = std::regex_replace(syst_name, std::regex("tauideff"), "eff_t_embedded");
+    } else if (syst_name.find("CMS_scale_e_") != string::npos) {
+        syst_name = std::regex_replace(syst_name, std::regex("scale_e_"), "scale_emb_e");
+    } else if ((syst_name.find("CMS_single") != string::npos && syst_name.find("trg") != string::npos) || syst_name.find("tautrg_") != string::npos) {
+        syst_name = std::regex_replace(syst_name, std::regex("trg"), "trg_emb");
+    } else if (syst_name.find("CMS_scale_t_") != string::npos) {
+        syst_name = std::regex_replace(syst_name, std::regex("scale_t_"), "scale_emb_t_");
+    }
+    return syst_name;
+}
+
 unordered_map<string, vector<string>> build_file_paths(string dir) {
     // read all files from input directory
     vector<string> directories;
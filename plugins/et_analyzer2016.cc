@@ -3,9 +3,12 @@
 // system includes
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <numeric>
 #include <memory>
+#include <thread>
 
 // ROOT includes
 #include "RooFunctor.h"
@@ -14,9 +17,11 @@
 #include "RooWorkspace.h"
 #include "TF1.h"
 #include "TFile.h"
+#include "TFileMerger.h"
 #include "TGraphAsymmErrors.h"
 #include "TH1D.h"
 #include "TH2F.h"
+#include "TROOT.h"
 #include "TTree.h"
 
 // user includes
@@ -25,14 +30,23 @@
 #include "../include/ComputeWG1Unc.h"
 #include "../include/LumiReweightingStandAlone.h"
 #include "../include/electron_factory.h"
+#include "../include/event_category.h"
 #include "../include/event_info.h"
 #include "../include/jet_factory.h"
+#include "../include/job_timer.h"
 #include "../include/met_factory.h"
 #include "../include/muon_factory.h"
+#include "../include/output_schema.h"
+#include "../include/process_info.h"
+#include "../include/sf_context.h"
 #include "../include/slim_tree.h"
 #include "../include/swiss_army_class.h"
+#include "../include/syst_descriptor.h"
 #include "../include/tau_factory.h"
 #include "../include/bjet_weighter.h"
+#include "../include/branch_manifest.h"
+#include "../include/cluster_ranges.h"
+#include "../include/correction_cache.h"
 
 typedef std::vector<double> NumV;
 
@@ -44,33 +58,57 @@ int main(int argc, char *argv[]) {
 
     CLParser parser(argc, argv);
     bool condor = parser.Flag("--condor");
+    bool all_systs = parser.Flag("--all-systs");
     std::string name = parser.Option("-n");
     std::string path = parser.Option("-p");
     std::string syst = parser.Option("-u");
     std::string sample = parser.Option("-s");
     std::string output_dir = parser.Option("-d");
     std::string signal_type = parser.Option("--stype");
+    int nworkers = parser.Option("-j").empty() ? 1 : std::stoi(parser.Option("-j"));
+    std::string sf_table_file = parser.Option("--sf-tables");
+    bool ac_stream = parser.Flag("--ac-stream");
+    bool all_branches = parser.Flag("--all-branches");  // also write the Higgs+jet variables and ME_* for studies
+    std::string schema_preset = parser.Option("--schema");  // datacard, nn-training, full, ... instead of the default branches
+    std::string schema_file = parser.Option("--schema-file").empty() ? "configs/output_schema.json" : parser.Option("--schema-file");
+    correction_cache::get().configure(parser.Option("--cache-dir"), parser.Option("--mirror"));
     std::string fname = path + sample + ".root";
     bool isData = sample.find("data") != std::string::npos;
     bool isEmbed = sample.find("embed") != std::string::npos || name.find("embed") != std::string::npos;
     bool doAC = signal_type != "None";
     bool isMG = sample.find("madgraph") != std::string::npos;
 
+    // systematic shifts to run. With --all-systs, -u is a comma-separated list and
+    // the nominal selection plus every listed shift are filled in one pass over the ntuple.
+    // Shifts that only change the event weight are stored as weights in the nominal tree
+    std::vector<std::string> systs{syst}, weight_systs;
+    if (all_systs) {
+        systs = {""};
+        for (auto &shift : parser.ListOption("-u")) {
+            if (is_weight_syst(syst_descriptor(shift))) {
+                weight_systs.push_back(shift);
+            } else {
+                systs.push_back(shift);
+            }
+        }
+    }
+
+    // parse the shifts once, so the event loop never searches their names
+    std::vector<syst_descriptor> syst_descriptors(systs.begin(), systs.end());
+    std::vector<syst_descriptor> weight_syst_descriptors(weight_systs.begin(), weight_systs.end());
+
+    // get systematic shift name
     std::string systname = "NOMINAL";
-    if (!syst.empty()) {
+    if (all_systs) {
+        systname = "ALL_SYSTS";
+    } else if (!syst.empty()) {
         systname = "SYST_" + syst;
     }
 
     // create output path
     auto suffix = "_output.root";
     auto prefix = "Output/trees/" + output_dir;
-    std::string filename, logname;
-    filename = prefix + "/" + systname + "/" + sample + std::string("_") + name + "_" + systname + suffix;
-    logname = prefix + "/logs/" + sample + std::string("_") + name + "_" + systname + ".txt";
-
-    if (condor) {
-        filename = sample + std::string("_") + name + "_" + systname + suffix;
-    }
+    std::string logname = prefix + "/logs/" + sample + std::string("_") + name + "_" + systname + ".txt";
 
     // create the log file
     std::ofstream logfile;
@@ -88,11 +126,29 @@ int main(int argc, char *argv[]) {
     running_log << "\t name: " << name << std::endl;
     running_log << "\t path: " << path << std::endl;
     running_log << "\t syst: " << syst << std::endl;
+    running_log << "\t all_systs: " << all_systs << std::endl;
     running_log << "\t sample: " << sample << std::endl;
     running_log << "\t output_dir: " << output_dir << std::endl;
     running_log << "\t signal_type: " << signal_type << std::endl;
+    running_log << "\t workers: " << nworkers << std::endl;
+    running_log << "\t sf_tables: " << sf_table_file << std::endl;
+    running_log << "\t ac_stream: " << ac_stream << std::endl;
+    running_log << "\t schema: " << (schema_preset.empty() ? "default" : schema_preset + " from " + schema_file) << std::endl;
+    running_log << "\t correction cache: " << correction_cache::get().getCacheDir() << " mirror: " << correction_cache::get().getMirrorDir() << std::endl;
     running_log << "\t isData: " << isData << " isEmbed: " << isEmbed << " doAC: " << doAC << std::endl;
 
+    // output branches of the slim_trees
+    output_schema schema;
+    if (!schema_preset.empty()) {
+        schema = output_schema(schema_file, schema_preset);
+        if (schema.empty()) {
+            return 1;
+        }
+    }
+
+    // time each stage of the job
+    job_timer timer(sample + "_" + name + "_" + systname);
+    auto stage_timer = timer.time("open input");
     auto fin = TFile::Open(fname.c_str());
     auto ntuple = reinterpret_cast<TTree *>(fin->Get("etau_tree"));
 
@@ -100,18 +156,9 @@ int main(int argc, char *argv[]) {
     auto counts = reinterpret_cast<TH1D *>(fin->Get("nevents"));
     auto gen_number = counts->GetBinContent(2);
 
-    // create output file
-    auto fout = new TFile(filename.c_str(), "RECREATE");
-    counts->Write();
-    fout->mkdir("grabbag");
-    fout->cd("grabbag");
-
-    // initialize Helper class
-    Helper *helper = new Helper(fout, name, syst);
-
-    // cd to root of output file and create tree
-    fout->cd();
-    slim_tree *st = new slim_tree("et_tree", doAC);
+    // initialize Helper class (luminosity and cross sections for the normalization). It has
+    // no output file, so its histograms aren't created in the read-only input file
+    Helper *helper = new Helper(nullptr, name, syst);
 
     std::string original = sample;
     if (name == "VBF125") {
@@ -130,9 +177,18 @@ int main(int argc, char *argv[]) {
         gen_number = 1.;
     }
 
+    // resolve the process once so the event loop doesn't compare strings
+    process_info proc(name, sample, signal_type);
+
     // reweighter for anomolous coupling samples
+    stage_timer = timer.time("ac weights");
     ACWeighter ac_weights = ACWeighter(original, sample, signal_type, "2016");
-    ac_weights.fillWeightMap();
+    if (ac_stream) {
+        ac_weights.openWeightStream(nworkers);  // read the weights alongside the events
+    } else {
+        ac_weights.fillWeightMap();
+    }
+    stage_timer = timer.time("corrections");
 
     // get normalization (lumi & xs are in util.h)
     double norm(1.);
@@ -151,23 +207,23 @@ int main(int argc, char *argv[]) {
                                       "root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_ScaleFactors/Data_Pileup_2016_271036-284044_80bins.root", "pileup", "pileup");
 
     // legacy sf's
-    TFile* htt_sf_file = TFile::Open("root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_ScaleFactors/htt_scalefactors_legacy_2016.root");
+    TFile* htt_sf_file = TFile::Open(correction_file("root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_ScaleFactors/htt_scalefactors_legacy_2016.root").c_str());
     RooWorkspace *htt_sf = reinterpret_cast<RooWorkspace *>(htt_sf_file->Get("w"));
     htt_sf_file->Close();
 
     // MadGraph Higgs pT file
     RooWorkspace *mg_sf;
     if (signal_type == "madgraph") {
-        TFile* mg_sf_file = TFile::Open("root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_ScaleFactors/htt_scalefactors_2016_MGggh.root");
+        TFile* mg_sf_file = TFile::Open(correction_file("root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_ScaleFactors/htt_scalefactors_2016_MGggh.root").c_str());
         mg_sf = reinterpret_cast<RooWorkspace *>(mg_sf_file->Get("w"));
         mg_sf_file->Close();
     }
 
     // top pT tune correction
-    TFile* top_tune_corr_file = TFile::Open("root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_ScaleFactors/toppt_correction_to_2016.root");
+    TFile* top_tune_corr_file = TFile::Open(correction_file("root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_ScaleFactors/toppt_correction_to_2016.root").c_str());
     TF1 *top_tune_corr = reinterpret_cast<TF1 *>(top_tune_corr_file->Get("toppt_ratio_to_2016"));
 
-    TFile *f_NNLOPS = TFile::Open("root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_ScaleFactors/NNLOPS_reweight.root");
+    TFile *f_NNLOPS = TFile::Open(correction_file("root://cmsxrootd.hep.wisc.edu:1094//store/user/tmitchel/HTT_ScaleFactors/NNLOPS_reweight.root").c_str());
     TGraph *g_NNLOPS_0jet = reinterpret_cast<TGraph *>(f_NNLOPS->Get("gr_NNLOPSratio_pt_powheg_0jet"));
     TGraph *g_NNLOPS_1jet = reinterpret_cast<TGraph *>(f_NNLOPS->Get("gr_NNLOPSratio_pt_powheg_1jet"));
     TGraph *g_NNLOPS_2jet = reinterpret_cast<TGraph *>(f_NNLOPS->Get("gr_NNLOPSratio_pt_powheg_2jet"));
@@ -180,393 +236,561 @@ int main(int argc, char *argv[]) {
     // bveto weights
     bjet_weighter bveto_weights(2016, bveto_wp::medium);
 
-    //////////////////////////////////////
-    // Final setup:                     //
-    // Declare histograms and factories //
-    //////////////////////////////////////
-
-    // declare histograms (histogram initializer functions in util.h)
-    fout->cd("grabbag");
-    auto histos = helper->getHistos1D();
+    stage_timer = timer.time("worker setup");
 
-    // construct factories
-    event_info event(ntuple, lepton::ELECTRON, 2016, isMG, syst);
-    electron_factory electrons(ntuple, 2016, syst);
-    tau_factory taus(ntuple, 2016, syst);
-    jet_factory jets(ntuple, 2016, syst);
-    met_factory met(ntuple, 2016, syst);
+    // split the ntuple into ranges of whole clusters, one per worker
+    auto ranges = get_cluster_ranges(ntuple, nworkers);
+    if (ranges.size() > 1) {
+        ROOT::EnableThreadSafety();
+    }
+    running_log << "Processing " << ntuple->GetEntries() << " events with " << ranges.size() << " worker(s)" << std::endl;
 
-    if (signal_type == "powheg" || signal_type == "madgraph") {
-        event.setRivets(ntuple);
+    // each worker sets the inputs of its own RooWorkspace copy. RooFit also has global
+    // state, so sf_context serializes every RooFit call across the workers
+    std::vector<RooWorkspace *> htt_sfs{htt_sf};
+    for (std::size_t w = 1; w < ranges.size(); w++) {
+        htt_sfs.push_back(new RooWorkspace(*htt_sf));
     }
 
-    // begin the event loop
-    Int_t nevts = ntuple->GetEntries();
-    int progress(0), fraction((nevts - 1) / 10);
-    for (Int_t i = 0; i < nevts; i++) {
-        ntuple->GetEntry(i);
-        if (i == progress * fraction) {
-            running_log << "LOG: Processing: " << progress * 10 << "% complete. (" << i << " of " << nevts << " events.)" << std::endl;
-            progress++;
-        }
+    // bytes read from the input and bytes after decompression for each worker
+    std::vector<Long64_t> bytes_read(ranges.size()), bytes_unzipped(ranges.size());
 
-        // find the event weight (not lumi*xs if looking at W or Drell-Yan)
-        Float_t evtwt(norm), corrections(1.), sf_trig(1.), sf_id(1.), sf_iso(1.), sf_reco(1.);
-        if (name == "W") {
-            if (event.getNumGenJets() == 1) {
-                evtwt = 7.23554229;
-            } else if (event.getNumGenJets() == 2) {
-                evtwt = 4.028649233;
-            } else if (event.getNumGenJets() == 3) {
-                evtwt = 1.078641327;
-            } else if (event.getNumGenJets() == 4) {
-                evtwt = 2.120996132;
-            } else {
-                evtwt = 28.8408141;
-            }
+    // get the output file name for a shift
+    auto output_name = [&](std::string shift) -> std::string {
+        std::string shiftname = shift.empty() ? "NOMINAL" : "SYST_" + shift;
+        if (condor) {
+            return original + std::string("_") + name + "_" + shiftname + suffix;
         }
+        return prefix + "/" + shiftname + "/" + original + std::string("_") + name + "_" + shiftname + suffix;
+    };
+
+    // process one range of entries. Each worker owns its input tree, factories,
+    // Helpers, histograms and slim_trees. With more than one worker, the output
+    // is written to one part per worker and merged after all workers finish
+    auto process_range = [&](std::size_t worker) {
+        // workers after the first read their own copy of the input
+        auto input = worker == 0 ? fin : TFile::Open(fname.c_str());
+        auto ntuple = reinterpret_cast<TTree *>(input->Get("etau_tree"));
+        // resolve every scale factor input and function once, instead of looking them up by name for every event
+        sf_context sf(htt_sfs.at(worker), sf_table_file);
+        auto sf_e_pt = sf.var("e_pt");
+        auto sf_e_eta = sf.var("e_eta");
+        auto sf_t_pt = sf.var("t_pt");
+        auto sf_t_eta = sf.var("t_eta");
+        auto sf_t_phi = sf.var("t_phi");
+        auto sf_t_dm = sf.var("t_dm");
+        auto sf_z_gen_mass = sf.var("z_gen_mass");
+        auto sf_z_gen_pt = sf.var("z_gen_pt");
+        auto sf_gt1_pt = sf.var("gt1_pt");
+        auto sf_gt1_eta = sf.var("gt1_eta");
+        auto sf_gt2_pt = sf.var("gt2_pt");
+        auto sf_gt2_eta = sf.var("gt2_eta");
+        auto sf_gt_pt = sf.var("gt_pt");
+        auto sf_gt_eta = sf.var("gt_eta");
+        auto sf_e_trk_ratio = sf.function("e_trk_ratio");
+        auto sf_e_idiso_ic_ratio = sf.function("e_idiso_ic_ratio");
+        auto sf_t_deeptauid_pt_medium = sf.function("t_deeptauid_pt_medium");
+        auto sf_t_id_vs_e_eta_tight = sf.function("t_id_vs_e_eta_tight");
+        auto sf_t_id_vs_mu_eta_vloose = sf.function("t_id_vs_mu_eta_vloose");
+        auto sf_e_trg_ic_ratio = sf.function("e_trg_ic_ratio");
+        auto sf_zptmass_weight_nom = sf.function("zptmass_weight_nom");
+        auto sf_e_trk_embed_ratio = sf.function("e_trk_embed_ratio");
+        auto sf_e_idiso_ic_embed_ratio = sf.function("e_idiso_ic_embed_ratio");
+        auto sf_t_deeptauid_pt_tightvse_embed_medium = sf.function("t_deeptauid_pt_tightvse_embed_medium");
+        auto sf_e_trg_ic_embed_ratio = sf.function("e_trg_ic_embed_ratio");
+        auto sf_m_sel_trg_ic_ratio = sf.function("m_sel_trg_ic_ratio");
+        auto sf_m_sel_id_ic_ratio = sf.function("m_sel_id_ic_ratio");
+
+        // each shift gets the same output file, Helper and tree as a standalone job
+        std::vector<TFile *> fouts;
+        std::vector<Helper *> helpers;
+        std::vector<slim_tree *> trees;
+        for (auto &shift : systs) {
+            std::string filename = output_name(shift);
+            if (ranges.size() > 1) {
+                filename += ".part" + std::to_string(worker);
+            }
 
-        if (name == "ZTT" || name == "ZLL" || name == "ZL" || name == "ZJ") {
-            if (event.getNumGenJets() == 1) {
-                evtwt = 0.5116971648;
-            } else if (event.getNumGenJets() == 2) {
-                evtwt = 0.5620553804;
-            } else if (event.getNumGenJets() == 3) {
-                evtwt = 0.5185483697;
-            } else if (event.getNumGenJets() == 4) {
-                evtwt = 0.4301591422;
-            } else {
-                evtwt = 1.549875011;
+            auto shift_out = new TFile(filename.c_str(), "RECREATE");
+            if (worker == 0) {
+                counts->Write();
             }
-        }
-        histos->at("cutflow")->Fill(1., 1.);
-
-        // run factories
-        auto electron = electrons.run_factory();
-        auto tau = taus.run_factory();
-        jets.run_factory();
-        event.setNjets(jets.getNjets());
-
-        // pass event flags
-        if (event.getPassFlags(isData)) {
-            histos->at("cutflow")->Fill(2., 1.);
-        } else {
-            continue;
-        }
+            shift_out->mkdir("grabbag");
+            shift_out->cd("grabbag");
 
-        // Separate processes
-        if ((name == "ZL" || name == "TTL" || name == "VVL" || name == "STL") && tau.getGenMatch() > 4) {
-            continue;
-        } else if ((name == "ZTT" || name == "TTT" || name == "VVT" || name == "STT") && tau.getGenMatch() != 5) {
-            continue;
-        } else if ((name == "ZJ" || name == "TTJ" || name == "VVJ" || name == "STJ") && tau.getGenMatch() != 6) {
-            continue;
-        } else {
-            histos->at("cutflow")->Fill(3., 1.);
-        }
+            // initialize Helper class
+            helpers.push_back(new Helper(shift_out, name, shift));
 
-        // only opposite-sign
-        int evt_charge = tau.getCharge() + electron.getCharge();
-        if (evt_charge == 0) {
-            histos->at("cutflow")->Fill(4., 1.);
-        } else {
-            continue;
+            // cd to root of output file and create tree
+            shift_out->cd();
+            trees.push_back(new slim_tree("et_tree", doAC, all_branches, schema));
+            fouts.push_back(shift_out);
         }
-
-        // build Higgs
-        TLorentzVector Higgs = electron.getP4() + tau.getP4() + met.getP4();
-
-        // calculate mt
-        double met_x = met.getMet() * cos(met.getMetPhi());
-        double met_y = met.getMet() * sin(met.getMetPhi());
-        double met_pt = sqrt(pow(met_x, 2) + pow(met_y, 2));
-        double mt = sqrt(pow(electron.getPt() + met_pt, 2) - pow(electron.getP4().Px() + met_x, 2) - pow(electron.getP4().Py() + met_y, 2));
-
-        // now do mt selection
-        if (mt < 50) {
-            histos->at("cutflow")->Fill(5., 1.);
-        } else {
-            continue;
+        TFile *fout = fouts.front();
+        Helper *helper = helpers.front();
+        slim_tree *st = trees.front();
+        st->addWeightShifts(weight_systs);
+
+        //////////////////////////////////////
+        // Final setup:                     //
+        // Declare histograms and factories //
+        //////////////////////////////////////
+
+        // declare histograms (histogram initializer functions in util.h)
+        fout->cd("grabbag");
+        auto histos = helper->getHistos1D();
+
+        // construct factories
+        event_info event(ntuple, lepton::ELECTRON, 2016, isMG, systs);
+        electron_factory electrons(ntuple, 2016, systs);
+        tau_factory taus(ntuple, 2016, systs);
+        jet_factory jets(ntuple, 2016, systs);
+        met_factory met(ntuple, 2016, systs);
+
+        if (signal_type == "powheg" || signal_type == "madgraph") {
+            event.setRivets(ntuple);
         }
 
-        // b-jet veto
-        auto bjets = jets.getBtagJets();
-        if (!isData && !isEmbed) {
-            histos->at("cutflow")->Fill(6., 1.);
-        } else if (jets.getNbtagMedium() < 1 && bjets.at(0).getBScore() < 0.6321) {
-            histos->at("cutflow")->Fill(6., 1.);
-        }  else {
-            continue;
+        // only read and cache the branches used by the factories
+        branch_manifest manifest;
+        manifest.add(event.getManifest());
+        manifest.add(electrons.getManifest());
+        manifest.add(taus.getManifest());
+        manifest.add(jets.getManifest());
+        manifest.add(met.getManifest());
+        manifest.enable(ntuple);
+        auto cache_size = manifest.cache(ntuple);
+        manifest.stage(ntuple);
+        if (worker == 0) {
+            running_log << "Reading " << manifest.getBranches().size() << " branches (" << manifest.getDeferredBranches().size()
+                        << " after the preselection) with a " << cache_size / 1024 << " kB TTreeCache" << std::endl;
         }
 
-        // create regions
-        bool signalRegion = (tau.getMediumIsoDeep() && electron.getIso() < 0.15);
-        bool antiTauIsoRegion = (tau.getMediumIsoDeep() == 0 && tau.getVVVLooseIsoDeep() > 0 && electron.getIso() < 0.15);
-        if (signal_type != "None") {
-            antiTauIsoRegion = false;  // don't need anti-tau iso region in signal
-        }
+        // begin the event loop
+        Long64_t first(ranges.at(worker).first), last(ranges.at(worker).second);
+        Long64_t progress(0), fraction((last - first - 1) / 10);
+        for (Long64_t i = first; i < last; i++) {
+            // only the selection branches are read here. The rest are read once a shift passes the preselection
+            bytes_unzipped.at(worker) += manifest.load(i);
+            bool loaded_deferred(false);
+            if (worker == 0 && i - first == progress * fraction) {
+                running_log << "LOG: Processing: " << progress * 10 << "% complete. (" << i - first << " of " << last - first << " events.)" << std::endl;
+                progress++;
+            }
 
-        // only keep the regions we need
-        if (signalRegion || antiTauIsoRegion) {
-            histos->at("cutflow")->Fill(7., 1.);
-        } else {
-            continue;
-        }
+            // evaluate every systematic shift on this entry
+            for (std::size_t s = 0; s < systs.size(); s++) {
+                auto &syst = syst_descriptors.at(s);
+                event.setSyst(s);
+                electrons.setSyst(s);
+                taus.setSyst(s);
+                jets.setSyst(s);
+                met.setSyst(s);
+                fout = fouts.at(s);
+                helper = helpers.at(s);
+                st = trees.at(s);
+                histos = helper->getHistos1D();
+
+                // find the event weight (not lumi*xs if looking at W or Drell-Yan)
+                Float_t evtwt(norm), corrections(1.), sf_trig(1.), sf_id(1.), sf_iso(1.), sf_reco(1.);
+                if (proc.has(process_traits::w_stitched)) {
+                    if (event.getNumGenJets() == 1) {
+                        evtwt = 7.23554229;
+                    } else if (event.getNumGenJets() == 2) {
+                        evtwt = 4.028649233;
+                    } else if (event.getNumGenJets() == 3) {
+                        evtwt = 1.078641327;
+                    } else if (event.getNumGenJets() == 4) {
+                        evtwt = 2.120996132;
+                    } else {
+                        evtwt = 28.8408141;
+                    }
+                }
 
-        // apply all scale factors/corrections/etc.
-        if (!isData && !isEmbed) {
-            // pileup reweighting
-            evtwt *= lumi_weights->weight(event.getNPU());
-
-            // generator weights
-            evtwt *= event.getGenWeight();
-
-            // prefiring weight (systematics already taken care of)
-            evtwt *= event.getPrefiringWeight();
-
-            // b-tagging scale factor goes here
-            evtwt *= bveto_weights.find_weight(bjets.at(0).getPt(), bjets.at(0).getFlavor(), bjets.at(0).getBScore(), bjets.at(1).getPt(),
-                                               bjets.at(1).getFlavor(), bjets.at(1).getBScore());
-
-            // set workspace variables
-            htt_sf->var("e_pt")->setVal(electron.getPt());
-            htt_sf->var("e_eta")->setVal(electron.getEta());
-            htt_sf->var("t_pt")->setVal(tau.getPt());
-            htt_sf->var("t_eta")->setVal(tau.getEta());
-            htt_sf->var("t_phi")->setVal(tau.getPhi());
-            htt_sf->var("t_dm")->setVal(tau.getDecayMode());
-            htt_sf->var("z_gen_mass")->setVal(event.getGenM());
-            htt_sf->var("z_gen_pt")->setVal(event.getGenPt());
-
-            // start applying weights from workspace
-            evtwt *= htt_sf->function("e_trk_ratio")->getVal();
-            evtwt *= htt_sf->function("e_idiso_ic_ratio")->getVal();
-
-            // tau ID efficiency SF and systematics
-            std::string id_name = "t_deeptauid_pt_medium";  // nominal
-            if (syst.find("tau_id_") != std::string::npos) {
-                if ((syst.find("30to35") != std::string::npos && tau.getPt() >= 30 && tau.getPt() < 35) ||
-                    (syst.find("35to40") != std::string::npos && tau.getPt() >= 35 && tau.getPt() < 40) ||
-                    (syst.find("ptgt40") != std::string::npos && tau.getPt() >= 40)) {
-                    id_name += syst.find("Up") != std::string::npos ? "_up" : "_down";
+                if (proc.has(process_traits::dy_stitched)) {
+                    if (event.getNumGenJets() == 1) {
+                        evtwt = 0.5116971648;
+                    } else if (event.getNumGenJets() == 2) {
+                        evtwt = 0.5620553804;
+                    } else if (event.getNumGenJets() == 3) {
+                        evtwt = 0.5185483697;
+                    } else if (event.getNumGenJets() == 4) {
+                        evtwt = 0.4301591422;
+                    } else {
+                        evtwt = 1.549875011;
+                    }
+                }
+                histos->at("cutflow")->Fill(1., 1.);
+
+                // run factories
+                auto electron = electrons.run_factory();
+                auto tau = taus.run_factory();
+                jets.run_factory();
+                event.setNjets(jets.getNjets());
+
+                // pass event flags
+                if (event.getPassFlags(isData)) {
+                    histos->at("cutflow")->Fill(2., 1.);
+                } else {
+                    continue;
                 }
-            }
-            if (tau.getGenMatch() == 5) {
-                evtwt *= htt_sf->function(id_name.c_str())->getVal();
-            }
 
-            // electron fake rate SF
-            std::string e_fake_id_name = "t_id_vs_e_eta_tight";
-            if (syst.find("tau_id_el_disc") != std::string::npos) {
-                if ((syst.find("DM0_barrel") != std::string::npos && tau.getDecayMode() == 0 && fabs(tau.getEta()) < 1.479) ||
-                    (syst.find("DM0_endcap") != std::string::npos && tau.getDecayMode() == 0 && fabs(tau.getEta()) >= 1.479) ||
-                    (syst.find("DM1_barrel") != std::string::npos && tau.getDecayMode() == 1 && fabs(tau.getEta()) < 1.479) ||
-                    (syst.find("DM1_endcap") != std::string::npos && tau.getDecayMode() == 1 && fabs(tau.getEta()) >= 1.479)) {
-                    e_fake_id_name += syst.find("Up") != std::string::npos ? "_up" : "_down";
+                // Separate processes
+                if (proc.passGenMatch(tau.getGenMatch())) {
+                    histos->at("cutflow")->Fill(3., 1.);
+                } else {
+                    continue;
                 }
-            }
-            if (tau.getGenMatch() == 1 || tau.getGenMatch() == 3) {
-                evtwt *= htt_sf->function(e_fake_id_name.c_str())->getVal();
-            }
 
-            if (tau.getGenMatch() == 2 || tau.getGenMatch() == 4) {
-              evtwt *= htt_sf->function("t_id_vs_mu_eta_vloose")->getVal();
-            }
+                // only opposite-sign
+                int evt_charge = tau.getCharge() + electron.getCharge();
+                if (evt_charge == 0) {
+                    histos->at("cutflow")->Fill(4., 1.);
+                } else {
+                    continue;
+                }
 
+                // build Higgs
+                auto Higgs = electron.getP4() + tau.getP4() + met.getP4();
 
-            evtwt *= htt_sf->function("e_trg_ic_ratio")->getVal();
-            if (syst == "mc_single_trigger_up") {
-                evtwt *= 1.02;  // 2% per light lepton leg
-            } else if (syst == "mc_single_trigger_down") {
-                evtwt *= 0.98;
-            }
+                // calculate mt
+                double met_x = met.getMet() * cos(met.getMetPhi());
+                double met_y = met.getMet() * sin(met.getMetPhi());
+                double met_pt = sqrt(pow(met_x, 2) + pow(met_y, 2));
+                double mt = sqrt(pow(electron.getPt() + met_pt, 2) - pow(electron.getP4().Px() + met_x, 2) - pow(electron.getP4().Py() + met_y, 2));
 
-            // Z-pT Reweighting
-            if (name == "EWKZ2l" || name == "EWKZ2nu" || name == "ZTT" || name == "ZLL" || name == "ZL" || name == "ZJ") {
-                auto nom_zpt_weight = htt_sf->function("zptmass_weight_nom")->getVal();
-                if (syst == "dyShape_Up") {
-                    nom_zpt_weight = nom_zpt_weight + ((nom_zpt_weight - 1) * 0.1);
-                } else if (syst == "dyShape_Down") {
-                    nom_zpt_weight = nom_zpt_weight - ((nom_zpt_weight - 1) * 0.1);
+                // now do mt selection
+                if (mt < 50) {
+                    histos->at("cutflow")->Fill(5., 1.);
+                } else {
+                    continue;
                 }
-                evtwt *= nom_zpt_weight;
-            }
 
-            // top-pT Reweighting
-            if (name == "TTT" || name == "TTJ" || name == "TTL" || name == "STT" || name == "STJ" || name == "STL") {
-                float pt_top1 = std::min(static_cast<float>(470.), jets.getTopPt1());
-                float pt_top2 = std::min(static_cast<float>(470.), jets.getTopPt2());
-                auto top_pt_weight = sqrt(exp(0.088 - 0.00087 * pt_top1 + 0.00000092 * pt_top1 * pt_top1) *
-                                          exp(0.088 - 0.00087 * pt_top2 + 0.00000092 * pt_top2 * pt_top2));
-                if (syst == "ttbarShape_Up") {
-                    top_pt_weight = 2 * top_pt_weight - 1;
-                } else if (syst == "ttbarShape_Up") {
-                    top_pt_weight = 1.;
+                // b-jet veto
+                const auto &bjets = jets.getBtagJets();
+                if (!isData && !isEmbed) {
+                    histos->at("cutflow")->Fill(6., 1.);
+                } else if (jets.getNbtagMedium() < 1 && bjets.at(0).getBScore() < 0.6321) {
+                    histos->at("cutflow")->Fill(6., 1.);
+                }  else {
+                    continue;
                 }
-                evtwt *= top_pt_weight;
-                // correction for different tune in 2016
-                evtwt *= ((1. / top_tune_corr->Eval(pt_top1)) * (1. / top_tune_corr->Eval(pt_top2)));
-            }
 
-            // ggH theory uncertainty
-            if (sample == "ggh125" && signal_type == "powheg") {
-                if (event.getNjetsRivet() == 0) evtwt *= g_NNLOPS_0jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(125.0)));
-                if (event.getNjetsRivet() == 1) evtwt *= g_NNLOPS_1jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(625.0)));
-                if (event.getNjetsRivet() == 2) evtwt *= g_NNLOPS_2jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(800.0)));
-                if (event.getNjetsRivet() >= 3) evtwt *= g_NNLOPS_3jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(925.0)));
-                NumV WG1unc = qcd_ggF_uncert_2017(event.getNjetsRivet(), event.getHiggsPtRivet(), event.getJetPtRivet());
-                if (syst.find("ggH_Rivet") != std::string::npos) {
-                    evtwt *= (1 + event.getRivetUnc(WG1unc, syst));
-                }
-            } else if (signal_type == "madgraph") {
-                if (event.getNjetsRivet() == 0) evtwt *= g_mcatnlo_NNLOPS_0jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(125.0)));
-                if (event.getNjetsRivet() == 1) evtwt *= g_mcatnlo_NNLOPS_1jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(625.0)));
-                if (event.getNjetsRivet() == 2) evtwt *= g_mcatnlo_NNLOPS_2jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(800.0)));
-                if (event.getNjetsRivet() >= 3) evtwt *= g_mcatnlo_NNLOPS_3jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(925.0)));
-                NumV WG1unc = qcd_ggF_uncert_2017(event.getNjetsRivet(), event.getHiggsPtRivet(), event.getJetPtRivet());
-                if (syst.find("ggH_Rivet") != std::string::npos) {
-                    evtwt *= (1 + event.getRivetUnc(WG1unc, syst));
+                // create regions
+                bool signalRegion = (tau.getMediumIsoDeep() && electron.getIso() < 0.15);
+                bool antiTauIsoRegion = (tau.getMediumIsoDeep() == 0 && tau.getVVVLooseIsoDeep() > 0 && electron.getIso() < 0.15);
+                if (proc.isSignal()) {
+                    antiTauIsoRegion = false;  // don't need anti-tau iso region in signal
                 }
-            }
-
-            // VBF theory uncertainty
-            if (sample == "vbf125" && signal_type == "powheg" && syst.find("VBF_Rivet") != std::string::npos) {
-                evtwt *= event.getVBFTheoryUnc(syst);
-            }
 
-            auto efake_pt_shift(1.);
-            if (syst.find("efaket_norm_ptgt50") != std::string::npos && tau.getPt() > 50) {
-                efake_pt_shift = (syst == "efaket_norm_ptgt50_Up" ? 1.1 : 0.9);
-            } else if (syst.find("efaket_norm_pt40to50") != std::string::npos && tau.getPt() > 40) {
-                efake_pt_shift = (syst == "efaket_norm_pt40to50_Up" ? 1.1 : 0.9);
-            } else if (syst.find("efaket_norm_pt30to40") != std::string::npos && tau.getPt() > 30) {
-                efake_pt_shift = (syst == "efaket_norm_pt30to40_Up" ? 1.1 : 0.9);
-            }
-            evtwt *= efake_pt_shift;
+                // only keep the regions we need
+                if (signalRegion || antiTauIsoRegion) {
+                    histos->at("cutflow")->Fill(7., 1.);
+                } else {
+                    continue;
+                }
 
-            if (syst == "tau_id_vsmu_vloose_Up") {
-                evtwt *= tau.getPt() <= 100 ? 1.03 : 1.15;
-            } else if (syst == "tau_id_vsmu_vloose_Down") {
-                evtwt *= tau.getPt() <= 100 ? 0.97 : 0.85;
-            }
-        } else if (!isData && isEmbed) {
-            // embedded generator weights
-            auto genweight(event.getGenWeight());
-            if (genweight > 1 || genweight < 0) {
-                genweight = 0;
-            }
-            evtwt *= genweight;
-
-            // tracking sf
-            evtwt *= helper->embed_tracking(tau.getDecayMode(), syst);
-
-            // set workspace variables
-            htt_sf->var("e_pt")->setVal(electron.getPt());
-            htt_sf->var("e_eta")->setVal(electron.getEta());
-            htt_sf->var("t_pt")->setVal(tau.getPt());
-            htt_sf->var("t_eta")->setVal(tau.getEta());
-            htt_sf->var("t_phi")->setVal(tau.getPhi());
-            htt_sf->var("t_dm")->setVal(tau.getDecayMode());
-            htt_sf->var("gt1_pt")->setVal(electron.getGenPt());
-            htt_sf->var("gt1_eta")->setVal(electron.getGenEta());
-            htt_sf->var("gt2_pt")->setVal(tau.getGenPt());
-            htt_sf->var("gt2_eta")->setVal(tau.getGenEta());
-
-            // start applying weights from workspace
-            evtwt *= htt_sf->function("e_trk_embed_ratio")->getVal();
-            evtwt *= htt_sf->function("e_idiso_ic_embed_ratio")->getVal();
-
-            // tau ID eff SF
-            std::string id_name = "t_deeptauid_pt_tightvse_embed_medium";
-            if (syst.find("tau_id_") != std::string::npos) {
-                if ((syst.find("30to35") != std::string::npos && tau.getPt() >= 30 && tau.getPt() < 35) ||
-                    (syst.find("35to40") != std::string::npos && tau.getPt() >= 35 && tau.getPt() < 40) ||
-                    (syst.find("ptgt40") != std::string::npos && tau.getPt() >= 40)) {
-                    id_name += syst.find("Up") != std::string::npos ? "_up" : "_down";
+                // the event passed the preselection, so read the remaining branches
+                if (!loaded_deferred) {
+                    bytes_unzipped.at(worker) += manifest.load_deferred();
+                    loaded_deferred = true;
                 }
-            }
-            if (tau.getGenMatch() == 5) {
-                evtwt *= htt_sf->function(id_name.c_str())->getVal();
-            }
 
-            // electron fake rate SF
-            std::string e_fake_id_name = "t_id_vs_e_eta_tight";
-            if (syst.find("tau_id_el_disc") != std::string::npos) {
-                if ((syst.find("DM0_barrel") != std::string::npos && tau.getDecayMode() == 0 && fabs(tau.getEta()) < 1.479) ||
-                    (syst.find("DM0_endcap") != std::string::npos && tau.getDecayMode() == 0 && fabs(tau.getEta()) >= 1.479) ||
-                    (syst.find("DM1_barrel") != std::string::npos && tau.getDecayMode() == 1 && fabs(tau.getEta()) < 1.479) ||
-                    (syst.find("DM1_endcap") != std::string::npos && tau.getDecayMode() == 1 && fabs(tau.getEta()) >= 1.479)) {
-                    e_fake_id_name += syst.find("Up") != std::string::npos ? "_up" : "_down";
+                // apply all scale factors/corrections/etc. for the given systematic
+                auto get_weight = [&](const syst_descriptor &syst) {
+                    Float_t evtwt(1.);
+                    if (!isData && !isEmbed) {
+                        // pileup reweighting
+                        evtwt *= lumi_weights->weight(event.getNPU());
+
+                        // generator weights
+                        evtwt *= event.getGenWeight();
+
+                        // prefiring weight (systematics already taken care of)
+                        evtwt *= event.getPrefiringWeight();
+
+                        // b-tagging scale factor goes here
+                        evtwt *= bveto_weights.find_weight(bjets.at(0).getPt(), bjets.at(0).getFlavor(), bjets.at(0).getBScore(), bjets.at(1).getPt(),
+                                                           bjets.at(1).getFlavor(), bjets.at(1).getBScore());
+
+                        // set workspace variables
+                        sf.set(sf_e_pt, electron.getPt());
+                        sf.set(sf_e_eta, electron.getEta());
+                        sf.set(sf_t_pt, tau.getPt());
+                        sf.set(sf_t_eta, tau.getEta());
+                        sf.set(sf_t_phi, tau.getPhi());
+                        sf.set(sf_t_dm, tau.getDecayMode());
+                        sf.set(sf_z_gen_mass, event.getGenM());
+                        sf.set(sf_z_gen_pt, event.getGenPt());
+
+                        // start applying weights from workspace
+                        evtwt *= sf.eval(sf_e_trk_ratio);
+                        evtwt *= sf.eval(sf_e_idiso_ic_ratio);
+
+                        // tau ID efficiency SF and systematics
+                        sf_shift id_shift(sf_shift::nominal);
+                        if (syst.is(syst_source::tau_id_pt) && syst.inBin(tau.getPt())) {
+                            id_shift = syst.isUp() ? sf_shift::up : sf_shift::down;
+                        }
+                        if (tau.getGenMatch() == 5) {
+                            evtwt *= sf.eval(sf_t_deeptauid_pt_medium, id_shift);
+                        }
+
+                        // electron fake rate SF
+                        sf_shift e_fake_id_shift(sf_shift::nominal);
+                        if (syst.is(syst_source::tau_id_el_disc) && tau.getDecayMode() == syst.getIndex() && syst.inBin(fabs(tau.getEta()))) {
+                            e_fake_id_shift = syst.isUp() ? sf_shift::up : sf_shift::down;
+                        }
+                        if (tau.getGenMatch() == 1 || tau.getGenMatch() == 3) {
+                            evtwt *= sf.eval(sf_t_id_vs_e_eta_tight, e_fake_id_shift);
+                        }
+
+                        if (tau.getGenMatch() == 2 || tau.getGenMatch() == 4) {
+                          evtwt *= sf.eval(sf_t_id_vs_mu_eta_vloose);
+                        }
+
+
+                        evtwt *= sf.eval(sf_e_trg_ic_ratio);
+                        if (syst.is(syst_source::mc_single_trigger, syst_direction::up)) {
+                            evtwt *= 1.02;  // 2% per light lepton leg
+                        } else if (syst.is(syst_source::mc_single_trigger, syst_direction::down)) {
+                            evtwt *= 0.98;
+                        }
+
+                        // Z-pT Reweighting
+                        if (proc.has(process_traits::z_pt_reweight)) {
+                            auto nom_zpt_weight = sf.eval(sf_zptmass_weight_nom);
+                            if (syst.is(syst_source::dy_shape, syst_direction::up)) {
+                                nom_zpt_weight = nom_zpt_weight + ((nom_zpt_weight - 1) * 0.1);
+                            } else if (syst.is(syst_source::dy_shape, syst_direction::down)) {
+                                nom_zpt_weight = nom_zpt_weight - ((nom_zpt_weight - 1) * 0.1);
+                            }
+                            evtwt *= nom_zpt_weight;
+                        }
+
+                        // top-pT Reweighting
+                        if (proc.has(process_traits::top_pt_reweight)) {
+                            float pt_top1 = std::min(static_cast<float>(470.), jets.getTopPt1());
+                            float pt_top2 = std::min(static_cast<float>(470.), jets.getTopPt2());
+                            auto top_pt_weight = sqrt(exp(0.088 - 0.00087 * pt_top1 + 0.00000092 * pt_top1 * pt_top1) *
+                                                      exp(0.088 - 0.00087 * pt_top2 + 0.00000092 * pt_top2 * pt_top2));
+                            if (syst.is(syst_source::ttbar_shape, syst_direction::up)) {
+                                top_pt_weight = 2 * top_pt_weight - 1;
+                            } else if (syst.is(syst_source::ttbar_shape, syst_direction::up)) {
+                                top_pt_weight = 1.;
+                            }
+                            evtwt *= top_pt_weight;
+                            // correction for different tune in 2016
+                            evtwt *= ((1. / top_tune_corr->Eval(pt_top1)) * (1. / top_tune_corr->Eval(pt_top2)));
+                        }
+
+                        // ggH theory uncertainty
+                        if (proc.has(process_traits::ggh_nnlops)) {
+                            if (event.getNjetsRivet() == 0) evtwt *= g_NNLOPS_0jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(125.0)));
+                            if (event.getNjetsRivet() == 1) evtwt *= g_NNLOPS_1jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(625.0)));
+                            if (event.getNjetsRivet() == 2) evtwt *= g_NNLOPS_2jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(800.0)));
+                            if (event.getNjetsRivet() >= 3) evtwt *= g_NNLOPS_3jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(925.0)));
+                            NumV WG1unc = qcd_ggF_uncert_2017(event.getNjetsRivet(), event.getHiggsPtRivet(), event.getJetPtRivet());
+                            if (syst.is(syst_source::ggh_rivet)) {
+                                evtwt *= (1 + event.getRivetUnc(WG1unc, syst));
+                            }
+                        } else if (proc.getSignalType() == signal_kind::madgraph) {
+                            if (event.getNjetsRivet() == 0) evtwt *= g_mcatnlo_NNLOPS_0jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(125.0)));
+                            if (event.getNjetsRivet() == 1) evtwt *= g_mcatnlo_NNLOPS_1jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(625.0)));
+                            if (event.getNjetsRivet() == 2) evtwt *= g_mcatnlo_NNLOPS_2jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(800.0)));
+                            if (event.getNjetsRivet() >= 3) evtwt *= g_mcatnlo_NNLOPS_3jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(925.0)));
+                            NumV WG1unc = qcd_ggF_uncert_2017(event.getNjetsRivet(), event.getHiggsPtRivet(), event.getJetPtRivet());
+                            if (syst.is(syst_source::ggh_rivet)) {
+                                evtwt *= (1 + event.getRivetUnc(WG1unc, syst));
+                            }
+                        }
+
+                        // VBF theory uncertainty
+                        if (proc.has(process_traits::vbf_theory) && syst.is(syst_source::vbf_rivet)) {
+                            evtwt *= event.getVBFTheoryUnc(syst);
+                        }
+
+                        auto efake_pt_shift(1.);
+                        if (syst.is(syst_source::efaket_norm) && tau.getPt() > syst.getLow()) {
+                            efake_pt_shift = syst.isUp() ? 1.1 : 0.9;
+                        }
+                        evtwt *= efake_pt_shift;
+
+                        if (syst.is(syst_source::tau_id_vsmu_vloose, syst_direction::up)) {
+                            evtwt *= tau.getPt() <= 100 ? 1.03 : 1.15;
+                        } else if (syst.is(syst_source::tau_id_vsmu_vloose, syst_direction::down)) {
+                            evtwt *= tau.getPt() <= 100 ? 0.97 : 0.85;
+                        }
+                    } else if (!isData && isEmbed) {
+                        // embedded generator weights
+                        auto genweight(event.getGenWeight());
+                        if (genweight > 1 || genweight < 0) {
+                            genweight = 0;
+                        }
+                        evtwt *= genweight;
+
+                        // tracking sf
+                        evtwt *= helper->embed_tracking(tau.getDecayMode(), syst);
+
+                        // set workspace variables
+                        sf.set(sf_e_pt, electron.getPt());
+                        sf.set(sf_e_eta, electron.getEta());
+                        sf.set(sf_t_pt, tau.getPt());
+                        sf.set(sf_t_eta, tau.getEta());
+                        sf.set(sf_t_phi, tau.getPhi());
+                        sf.set(sf_t_dm, tau.getDecayMode());
+                        sf.set(sf_gt1_pt, electron.getGenPt());
+                        sf.set(sf_gt1_eta, electron.getGenEta());
+                        sf.set(sf_gt2_pt, tau.getGenPt());
+                        sf.set(sf_gt2_eta, tau.getGenEta());
+
+                        // start applying weights from workspace
+                        evtwt *= sf.eval(sf_e_trk_embed_ratio);
+                        evtwt *= sf.eval(sf_e_idiso_ic_embed_ratio);
+
+                        // tau ID eff SF
+                        sf_shift id_shift(sf_shift::nominal);
+                        if (syst.is(syst_source::tau_id_pt) && syst.inBin(tau.getPt())) {
+                            id_shift = syst.isUp() ? sf_shift::up : sf_shift::down;
+                        }
+                        if (tau.getGenMatch() == 5) {
+                            evtwt *= sf.eval(sf_t_deeptauid_pt_tightvse_embed_medium, id_shift);
+                        }
+
+                        // electron fake rate SF
+                        sf_shift e_fake_id_shift(sf_shift::nominal);
+                        if (syst.is(syst_source::tau_id_el_disc) && tau.getDecayMode() == syst.getIndex() && syst.inBin(fabs(tau.getEta()))) {
+                            e_fake_id_shift = syst.isUp() ? sf_shift::up : sf_shift::down;
+                        }
+                        if (tau.getGenMatch() == 1 || tau.getGenMatch() == 3) {
+                            evtwt *= sf.eval(sf_t_id_vs_e_eta_tight, e_fake_id_shift);
+                        }
+
+                        if (tau.getGenMatch() == 2 || tau.getGenMatch() == 4) {
+                          evtwt *= sf.eval(sf_t_id_vs_mu_eta_vloose);
+                        }
+
+                        // trigger scale factor
+                        evtwt *= sf.eval(sf_e_trg_ic_embed_ratio);
+                        if (syst.is(syst_source::embed_single_trigger, syst_direction::up)) {
+                            evtwt *= 1.02;  // 2% per light lepton leg
+                        } else if (syst.is(syst_source::embed_single_trigger, syst_direction::down)) {
+                            evtwt *= 0.98;
+                        }
+
+                        // double muon trigger eff in selection
+                        evtwt *= sf.eval(sf_m_sel_trg_ic_ratio);
+
+                        // muon ID eff in selection (leg 1)
+                        sf.set(sf_gt_pt, electron.getGenPt());
+                        sf.set(sf_gt_eta, electron.getGenEta());
+                        evtwt *= sf.eval(sf_m_sel_id_ic_ratio);
+
+                        // muon ID eff in selection (leg 1)
+                        sf.set(sf_gt_pt, tau.getGenPt());
+                        sf.set(sf_gt_eta, tau.getGenEta());
+                        evtwt *= sf.eval(sf_m_sel_id_ic_ratio);
+
+                        if (syst.is(syst_source::tau_id_vsmu_vloose, syst_direction::up)) {
+                            evtwt *= tau.getPt() <= 100 ? 1.05 : 1.15;
+                        } else if (syst.is(syst_source::tau_id_vsmu_vloose, syst_direction::down)) {
+                            evtwt *= tau.getPt() <= 100 ? 0.95 : 0.85;
+                        }
+                    }
+                    return evtwt;
+                };
+
+                // weight-only systematics are stored as extra weights in the nominal tree
+                if (syst.isNominal()) {
+                    for (std::size_t w = 0; w < weight_systs.size(); w++) {
+                        st->weight_shifts.at(w) = evtwt * get_weight(weight_syst_descriptors.at(w));
+                    }
                 }
-            }
-            if (tau.getGenMatch() == 1 || tau.getGenMatch() == 3) {
-                evtwt *= htt_sf->function(e_fake_id_name.c_str())->getVal();
-            }
+                evtwt *= get_weight(syst);
+                fout->cd();
 
-            if (tau.getGenMatch() == 2 || tau.getGenMatch() == 4) {
-              evtwt *= htt_sf->function("t_id_vs_mu_eta_vloose")->getVal();
-            }
+                unsigned tree_cat(0);
 
-            // trigger scale factor
-            evtwt *= htt_sf->function("e_trg_ic_embed_ratio")->getVal();
-            if (syst == "embed_single_trigger_up") {
-                evtwt *= 1.02;  // 2% per light lepton leg
-            } else if (syst == "embed_single_trigger_down") {
-                evtwt *= 0.98;
-            }
+                // regions
+                if (signalRegion) {
+                    tree_cat |= event_category::signal;
+                } else if (antiTauIsoRegion) {
+                    tree_cat |= event_category::antiTauIso;
+                }
 
-            // double muon trigger eff in selection
-            evtwt *= htt_sf->function("m_sel_trg_ic_ratio")->getVal();
+                // event charge
+                if (evt_charge == 0) {
+                    tree_cat |= event_category::OS;
+                }
 
-            // muon ID eff in selection (leg 1)
-            htt_sf->var("gt_pt")->setVal(electron.getGenPt());
-            htt_sf->var("gt_eta")->setVal(electron.getGenEta());
-            evtwt *= htt_sf->function("m_sel_id_ic_ratio")->getVal();
+                Long64_t currentEventID = event.getLumi();
+                currentEventID = currentEventID * 1000000 + event.getEvt();
+                if (doAC) {
+                    st->setACWeights(ac_weights.getWeights(currentEventID, worker));
+                }
 
-            // muon ID eff in selection (leg 1)
-            htt_sf->var("gt_pt")->setVal(tau.getGenPt());
-            htt_sf->var("gt_eta")->setVal(tau.getGenEta());
-            evtwt *= htt_sf->function("m_sel_id_ic_ratio")->getVal();
+                // fill the tree
+                st->fillTree(tree_cat, &electron, &tau, &jets, &met, &event, mt, evtwt, proc);
+            }  // close systematics loop
+        }  // close event loop
 
-            if (syst == "tau_id_vsmu_vloose_Up") {
-                evtwt *= tau.getPt() <= 100 ? 1.05 : 1.15;
-            } else if (syst == "tau_id_vsmu_vloose_Down") {
-                evtwt *= tau.getPt() <= 100 ? 0.95 : 0.85;
-            }
+        auto write_timer = timer.time("write output");
+        for (auto &shift_out : fouts) {
+            shift_out->cd();
+            shift_out->Write();
+            shift_out->Close();
         }
-        fout->cd();
-
-        std::vector<std::string> tree_cat;
-
-        // regions
-        if (signalRegion) {
-            tree_cat.push_back("signal");
-        } else if (antiTauIsoRegion) {
-            tree_cat.push_back("antiTauIso");
+        bytes_read.at(worker) = input->GetBytesRead();
+        if (worker > 0) {
+            input->Close();
         }
-
-        // event charge
-        if (evt_charge == 0) {
-            tree_cat.push_back("OS");
+    };
+
+    stage_timer = timer.time("event loop");
+    stage_timer.addEvents(ntuple->GetEntries());
+    if (ranges.size() == 1) {
+        process_range(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (std::size_t w = 0; w < ranges.size(); w++) {
+            workers.emplace_back(process_range, w);
         }
-
-        std::shared_ptr<std::vector<double>> weights(nullptr);
-        Long64_t currentEventID = event.getLumi();
-        currentEventID = currentEventID * 1000000 + event.getEvt();
-        if (doAC) {
-            weights = std::make_shared<std::vector<double>>(ac_weights.getWeights(currentEventID));
+        for (auto &worker : workers) {
+            worker.join();
         }
 
-        // fill the tree
-        st->fillTree(tree_cat, &electron, &tau, &jets, &met, &event, mt, evtwt, weights, name);
-    }  // close event loop
+        stage_timer = timer.time("merge");
+
+        // merge the parts in order so the output doesn't depend on the number of workers
+        for (auto &shift : systs) {
+            std::string filename = output_name(shift);
+            TFileMerger merger(false);
+            merger.OutputFile(filename.c_str(), "RECREATE");
+            for (std::size_t w = 0; w < ranges.size(); w++) {
+                merger.AddFile((filename + ".part" + std::to_string(w)).c_str(), false);
+            }
+            if (!merger.Merge()) {
+                std::cerr << "Failed to merge the output for " << filename << std::endl;
+                return 1;
+            }
+            for (std::size_t w = 0; w < ranges.size(); w++) {
+                std::remove((filename + ".part" + std::to_string(w)).c_str());
+            }
+        }
+    }
 
     fin->Close();
-    fout->cd();
-    fout->Write();
-    fout->Close();
+    stage_timer.stop();
+    running_log << "Read " << std::accumulate(bytes_read.begin(), bytes_read.end(), Long64_t(0)) / 1024 << " kB from the input and decompressed "
+                << std::accumulate(bytes_unzipped.begin(), bytes_unzipped.end(), Long64_t(0)) / 1024 << " kB" << std::endl;
     running_log << "Finished processing " << sample << std::endl;
+
+    // timing summary next to each output and the log
+    for (auto &shift : systs) {
+        timer.write(timer_utils::sidecar_name(output_name(shift)));
+    }
     if (!condor) {
+        timer.write(timer_utils::sidecar_name(logname));
         logfile.close();
     }
     return 0;
@@ -1,6 +1,13 @@
 // Copyright [2020] Tyler Mitchell
 
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "../include/ApplyFF.h"
@@ -9,45 +16,212 @@
 #include "TH1F.h"
 #include "TTree.h"
 
-std::vector<std::string> ff_syst = {"ff_qcd_0jet_unc1", "ff_qcd_0jet_unc2",    "ff_qcd_1jet_unc1",  "ff_qcd_1jet_unc2",   "ff_qcd_2jet_unc1",
-                                    "ff_qcd_2jet_unc2", "ff_w_0jet_unc1",      "ff_w_0jet_unc2",    "ff_w_1jet_unc1",     "ff_w_1jet_unc2",
-                                    "ff_w_2jet_unc1",   "ff_w_2jet_unc2",      "ff_tt_0jet_unc1",   "ff_tt_0jet_unc2",    "mtclosure_w_unc1",
-                                    "mtclosure_w_unc2", "lptclosure_xtrg_qcd", "lptclosure_xtrg_w", "lptclosure_xtrg_tt", "lptclosure_qcd",
-                                    "lptclosure_w",     "lptclosure_tt",       "osssclosure_qcd"};
+// fractions of W, ttbar and QCD in the anti-isolated region
+struct fake_fractions {
+    Float_t frac_w, frac_tt, frac_qcd;
+};
 
+/////////////////////////////////////////////////////////
+// Purpose: To look up the fake fractions of an event. //
+// The frac_w, frac_tt and frac_qcd histograms of each //
+// category are copied into one table of               //
+// fake_fractions per (vis_mass, njets) bin of the     //
+// frac_data histogram, including under- and overflow, //
+// and the bin is found from copies of its bin edges,  //
+// so a lookup reads one entry of one table.           //
+//                                                     //
+// The bins found from the edges are compared to       //
+// TAxis::FindFixBin on and around every edge when the //
+// table is built. If they ever differ, the table      //
+// finds its bins on the axes instead.                 //
+/////////////////////////////////////////////////////////
 class fake_map {
    private:
+    struct fraction_table {
+        std::vector<double> x_edges, y_edges;
+        std::vector<fake_fractions> fractions;  // x bin major, y bin minor
+        const TAxis *x_axis, *y_axis;
+        bool use_axes;  // find_bin doesn't agree with the axes
+
+        static int find_bin(const std::vector<double> &, double);
+        static bool agrees(const TAxis *, const std::vector<double> &);
+        fake_fractions get(Float_t x, Float_t y) const {
+            if (use_axes) {
+                return fractions[x_axis->FindFixBin(x) * (y_edges.size() + 1) + y_axis->FindFixBin(y)];
+            }
+            return fractions[find_bin(x_edges, x) * (y_edges.size() + 1) + find_bin(y_edges, y)];
+        }
+    };
+
     std::vector<std::string> categories;
-    std::unordered_map<std::string, std::vector<TH1F*>> fractions;
+    std::vector<fraction_table> tables;  // same order as categories
 
    public:
     explicit fake_map(TFile*);
     ~fake_map() {}
 
-    std::vector<Float_t> get_fractions(std::string, Float_t, Float_t);
+    static std::size_t category(Float_t, Float_t);
+    fake_fractions get_fractions(std::size_t cat, Float_t x, Float_t y) const { return tables[cat].get(x, y); }
+    fake_fractions get_fractions(std::string, Float_t, Float_t) const;
+    void get_fractions(ff_columns &, const std::vector<Float_t> &) const;
 };
 
 fake_map::fake_map(TFile* ff_file) : categories({"0jet", "boosted", "vbf"}) {
     for (auto cat : categories) {
-        fractions[cat] = std::vector<TH1F*>{
-            reinterpret_cast<TH1F*>(ff_file->Get((cat + "/frac_w").c_str())),
-            reinterpret_cast<TH1F*>(ff_file->Get((cat + "/frac_tt").c_str())),
-            reinterpret_cast<TH1F*>(ff_file->Get((cat + "/frac_qcd").c_str())),
-            reinterpret_cast<TH1F*>(ff_file->Get((cat + "/frac_data").c_str())),
-        };
+        auto frac_w = reinterpret_cast<TH1F*>(ff_file->Get((cat + "/frac_w").c_str()));
+        auto frac_tt = reinterpret_cast<TH1F*>(ff_file->Get((cat + "/frac_tt").c_str()));
+        auto frac_qcd = reinterpret_cast<TH1F*>(ff_file->Get((cat + "/frac_qcd").c_str()));
+        auto frac_data = reinterpret_cast<TH1F*>(ff_file->Get((cat + "/frac_data").c_str()));
+
+        // bins are found on the axes of the data histogram
+        fraction_table table;
+        for (auto axis : {std::make_pair(frac_data->GetXaxis(), &table.x_edges), std::make_pair(frac_data->GetYaxis(), &table.y_edges)}) {
+            for (auto i = 1; i <= axis.first->GetNbins(); i++) {
+                axis.second->push_back(axis.first->GetBinLowEdge(i));
+            }
+            axis.second->push_back(axis.first->GetBinUpEdge(axis.first->GetNbins()));
+        }
+
+        for (std::size_t xbin = 0; xbin <= table.x_edges.size(); xbin++) {
+            for (std::size_t ybin = 0; ybin <= table.y_edges.size(); ybin++) {
+                table.fractions.push_back(fake_fractions{static_cast<Float_t>(frac_w->GetBinContent(xbin, ybin)),
+                                                         static_cast<Float_t>(frac_tt->GetBinContent(xbin, ybin)),
+                                                         static_cast<Float_t>(frac_qcd->GetBinContent(xbin, ybin))});
+            }
+        }
+
+        table.x_axis = frac_data->GetXaxis();
+        table.y_axis = frac_data->GetYaxis();
+        table.use_axes = !fraction_table::agrees(table.x_axis, table.x_edges) || !fraction_table::agrees(table.y_axis, table.y_edges);
+        if (table.use_axes) {
+            std::cerr << "Bin edges of " << cat << "/frac_data don't reproduce TAxis::FindFixBin, using the axes instead" << std::endl;
+        }
+        tables.push_back(table);
+    }
+}
+
+// 0 below the first edge, nbins + 1 from the last edge on and the bin i with
+// edges[i - 1] <= x < edges[i] in between. TAxis::FindFixBin computes the bin
+// of an axis with fixed bin widths instead of searching, so the two can differ
+// right at an edge, which agrees checks for
+int fake_map::fraction_table::find_bin(const std::vector<double> &edges, double x) {
+    return std::upper_bound(edges.begin(), edges.end(), x) - edges.begin();
+}
+
+// compare find_bin to the axis on every edge, on the nearest float and double
+// values on either side of it (the inputs are Float_t) and in the middle of every bin
+bool fake_map::fraction_table::agrees(const TAxis *axis, const std::vector<double> &edges) {
+    auto inf = std::numeric_limits<double>::infinity();
+    auto float_inf = std::numeric_limits<Float_t>::infinity();
+    std::vector<double> points;
+    for (std::size_t i = 0; i < edges.size(); i++) {
+        auto edge = static_cast<Float_t>(edges[i]);
+        points.insert(points.end(), {edges[i], std::nextafter(edges[i], -inf), std::nextafter(edges[i], inf), edge, std::nextafter(edge, -float_inf),
+                                     std::nextafter(edge, float_inf)});
+        if (i + 1 < edges.size()) {
+            points.push_back((edges[i] + edges[i + 1]) / 2.);
+        }
+    }
+
+    for (auto x : points) {
+        if (find_bin(edges, x) != axis->FindFixBin(x)) {
+            return false;
+        }
     }
+    return true;
 }
 
-std::vector<Float_t> fake_map::get_fractions(std::string cat, Float_t x, Float_t y) {
-    auto hist = fractions.at(cat).at(3);
-    auto xbin = hist->GetXaxis()->FindBin(x);
-    auto ybin = hist->GetYaxis()->FindBin(y);
+fake_fractions fake_map::get_fractions(std::string cat, Float_t x, Float_t y) const {
+    return tables.at(std::find(categories.begin(), categories.end(), cat) - categories.begin()).get(x, y);
+}
 
-    Float_t frac_w = fractions.at(cat).at(0)->GetBinContent(xbin, ybin);
-    Float_t frac_tt = fractions.at(cat).at(1)->GetBinContent(xbin, ybin);
-    Float_t frac_qcd = fractions.at(cat).at(2)->GetBinContent(xbin, ybin);
+// index of the event's category in categories
+std::size_t fake_map::category(Float_t njets, Float_t mjj) {
+    if (njets == 0) {
+        return 0;
+    } else if (njets == 1 || mjj <= 300) {
+        return 1;
+    }
+    return 2;
+}
 
-    return std::vector<Float_t>{frac_w, frac_tt, frac_qcd};
+// fill the fractions of a block of events from their vis_mass, njets and mjj
+void fake_map::get_fractions(ff_columns &columns, const std::vector<Float_t> &mjj) const {
+    for (std::size_t i = 0; i < columns.size(); i++) {
+        auto fractions = get_fractions(category(columns.njets[i], mjj[i]), columns.vis_mass[i], columns.njets[i]);
+        columns.frac_w[i] = fractions.frac_w;
+        columns.frac_tt[i] = fractions.frac_tt;
+        columns.frac_qcd[i] = fractions.frac_qcd;
+    }
+}
+
+////////////////////////////////////////////////////////
+// Purpose: To check the fake factors of a sample of  //
+// events (--validate). The weights from the batch    //
+// get_ff or get_all_ff are compared to get_ff for    //
+// each shift, one event at a time, which has to give //
+// the same result, and to an apply_ff that evaluates //
+// the TF1s instead of their tables, which has to     //
+// agree within the tolerance.                        //
+////////////////////////////////////////////////////////
+class ff_validator {
+   private:
+    apply_ff &ffer;
+    apply_ff reference;  // evaluates the TF1s
+    double tolerance, max_deviation;
+    Long64_t nchecked, nfailed;
+
+    void compare(std::string, Long64_t, Float_t, Float_t, double);
+
+   public:
+    ff_validator(apply_ff &, std::string, std::string, double);
+    ~ff_validator() {}
+
+    void check(Long64_t, const ff_kinematics &, const ff_weights &, bool);
+    bool report() const;
+};
+
+ff_validator::ff_validator(apply_ff &_ffer, std::string path, std::string channel, double _tolerance)
+    : ffer(_ffer), reference(path, channel, false), tolerance(_tolerance), max_deviation(0.), nchecked(0), nfailed(0) {}
+
+// relative difference of a weight to the expected one, the first few failures are printed
+void ff_validator::compare(std::string name, Long64_t entry, Float_t weight, Float_t expected, double max_diff) {
+    auto diff = std::fabs(weight - expected) / std::max(std::fabs(static_cast<double>(expected)), 1e-6);
+    nchecked++;
+    if (diff > max_diff || !std::isfinite(diff)) {
+        if (nfailed < 10) {
+            std::cerr << "entry " << entry << ", " << name << ": " << weight << " instead of " << expected << std::endl;
+        }
+        nfailed++;
+    }
+    if (max_diff > 0.) {
+        max_deviation = std::max(max_deviation, diff);
+    }
+}
+
+// compare the weights of one event, only the nominal one unless syst is set
+void ff_validator::check(Long64_t entry, const ff_kinematics &kin, const ff_weights &weights, bool syst) {
+    compare("nominal", entry, weights[0], ffer.get_ff(kin), 0.);
+    compare("nominal (TF1)", entry, weights[0], reference.get_ff(kin), tolerance);
+    if (!syst) {
+        return;
+    }
+
+    for (std::size_t i = 0; i < ff_systematics::size; i++) {
+        for (auto up : {true, false}) {
+            ff_systematics::shift shift{i, up};
+            auto name = ff_systematics::names.at(i) + (up ? "_up" : "_down");
+            auto weight = weights[up ? ff_systematics::up(i) : ff_systematics::down(i)];
+            compare(name, entry, weight, ffer.get_ff(kin, shift), 0.);
+            compare(name + " (TF1)", entry, weight, reference.get_ff(kin, shift), tolerance);
+        }
+    }
+}
+
+// print a summary, false if any weight was off
+bool ff_validator::report() const {
+    std::cout << "validated " << nchecked << " weights: " << nfailed << " failed, max. deviation from the TF1s " << max_deviation << std::endl;
+    return nfailed == 0;
 }
 
 int main(int argc, char* argv[]) {
@@ -57,9 +231,14 @@ int main(int argc, char* argv[]) {
     std::string fake_factor_path = parser.Option("-f");
     std::string channel = parser.Option("-c");
     bool syst = parser.Flag("-s");
+    bool validate = parser.Flag("--validate");
 
     apply_ff ffer(fake_factor_path, channel);
 
+    // with --validate, every validate_every'th event is checked
+    const Long64_t validate_every(100);
+    std::unique_ptr<ff_validator> validator(validate ? new ff_validator(ffer, fake_factor_path, channel, 1e-3) : nullptr);
+
     std::string lpt_name("mu_pt");
     if (channel == "et") {
         lpt_name = "el_pt";
@@ -79,17 +258,17 @@ int main(int argc, char* argv[]) {
     // Clone the original tree
     auto new_tree = tree->CloneTree(-1, "fast");
 
-    // create new evtwt branch
-    Float_t fake_weight;
-    auto bfake_weight = new_tree->Branch("fake_weight", &fake_weight, "fake_weight/F");
+    // create new evtwt branch. get_all_ff fills the nominal and systematic weights in place
+    ff_weights fake_weights;
+    fake_weights.fill(1.);
+    auto bfake_weight = new_tree->Branch("fake_weight", &fake_weights[0], "fake_weight/F");
 
     // systematic branches
-    std::vector<Float_t> fake_weight_systs_up(23, 1), fake_weight_systs_dn(23, 1);
-    std::vector<TBranch*> bfake_weight_systs_up, bfake_weight_systs_dn;
+    std::vector<TBranch*> bfake_weight_systs;
     if (syst) {
-        for (auto i = 0; i < ff_syst.size(); i++) {
-            bfake_weight_systs_up.push_back(new_tree->Branch((ff_syst.at(i) + "_up").c_str(), &fake_weight_systs_up[i]));
-            bfake_weight_systs_dn.push_back(new_tree->Branch((ff_syst.at(i) + "_down").c_str(), &fake_weight_systs_dn[i]));
+        for (std::size_t i = 0; i < ff_systematics::size; i++) {
+            bfake_weight_systs.push_back(new_tree->Branch((ff_systematics::names.at(i) + "_up").c_str(), &fake_weights[ff_systematics::up(i)]));
+            bfake_weight_systs.push_back(new_tree->Branch((ff_systematics::names.at(i) + "_down").c_str(), &fake_weights[ff_systematics::down(i)]));
         }
     }
 
@@ -105,43 +284,57 @@ int main(int argc, char* argv[]) {
     tree->SetBranchAddress("cross_trigger", &xtrg);
     tree->SetBranchAddress("mjj", &mjj);
 
-    // used to pass fractions to apply_ff
-    Float_t frac_tt, frac_qcd, frac_w;
-    std::string event_cat;
-    std::vector<Float_t> event_fractions;
+    // events are processed in blocks. The tree is still read one entry at a time and each
+    // entry's inputs are copied into the columns, only the fractions and weights are then
+    // computed for the whole block at once before the branches are filled
+    const Long64_t block_size(4096);
+    ff_columns columns;
+    std::vector<Float_t> block_mjj, block_weights;
+    std::vector<ff_weights> block_all_weights;
 
     Long64_t nentries = tree->GetEntries();
-    for (Long64_t i = 0; i < nentries; i++) {
-        tree->GetEntry(i);
-
-        // categorize event to get correct fraction
-        if (njets == 0) {
-            event_cat = "0jet";
-        } else if (njets == 1 || (njets > 1 && mjj <= 300)) {
-            event_cat = "boosted";
-        } else if (njets > 1 && mjj > 300) {
-            event_cat = "vbf";
+    for (Long64_t first = 0; first < nentries; first += block_size) {
+        auto nevents = std::min(block_size, nentries - first);
+        columns.resize(nevents);
+        block_mjj.resize(nevents);
+        for (Long64_t i = 0; i < nevents; i++) {
+            tree->GetEntry(first + i);
+            columns.pt[i] = pt;
+            columns.mt[i] = mt;
+            columns.vis_mass[i] = vis_mass;
+            columns.lpt[i] = lpt;
+            columns.dr[i] = dr;
+            columns.met[i] = met;
+            columns.njets[i] = njets;
+            columns.xtrg[i] = xtrg;
+            block_mjj[i] = mjj;
         }
 
-        // get fractions
-        event_fractions = fractions.get_fractions(event_cat, vis_mass, njets);
-        frac_w = event_fractions.at(0);
-        frac_tt = event_fractions.at(1);
-        frac_qcd = event_fractions.at(2);
+        // categorize events to get the correct fractions
+        fractions.get_fractions(columns, block_mjj);
 
         // fill the weights
-        fake_weight = ffer.get_ff(std::vector<Float_t>{pt, mt, vis_mass, lpt, dr, met, njets, xtrg, frac_tt, frac_qcd, frac_w});
-        bfake_weight->Fill();
-
         if (syst) {
-            for (auto j = 0; j < ff_syst.size(); j++) {
-                fake_weight_systs_up[j] =
-                    ffer.get_ff(std::vector<Float_t>{pt, mt, vis_mass, lpt, dr, met, njets, xtrg, frac_tt, frac_qcd, frac_w}, ff_syst.at(j), "up");
-                bfake_weight_systs_up.at(j)->Fill();
-
-                fake_weight_systs_dn[j] =
-                    ffer.get_ff(std::vector<Float_t>{pt, mt, vis_mass, lpt, dr, met, njets, xtrg, frac_tt, frac_qcd, frac_w}, ff_syst.at(j), "down");
-                bfake_weight_systs_dn.at(j)->Fill();
+            block_all_weights.resize(nevents);
+            ffer.get_all_ff(columns, block_all_weights.data());
+        } else {
+            block_weights.resize(nevents);
+            ffer.get_ff(columns, block_weights.data());
+        }
+
+        for (Long64_t i = 0; i < nevents; i++) {
+            if (syst) {
+                fake_weights = block_all_weights[i];
+                for (auto branch : bfake_weight_systs) {
+                    branch->Fill();
+                }
+            } else {
+                fake_weights[0] = block_weights[i];
+            }
+            bfake_weight->Fill();
+
+            if (validator && (first + i) % validate_every == 0) {
+                validator->check(first + i, columns.row(i), fake_weights, syst);
             }
         }
     }
@@ -149,4 +342,8 @@ int main(int argc, char* argv[]) {
     fout->Close();
     fin->Close();
     ff_file->Close();
+
+    if (validator && !validator->report()) {
+        return 1;
+    }
 }
@@ -0,0 +1,791 @@
+// Copyright [2020] Tyler Mitchell
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../include/CLParser.h"
+#include "../include/branch_manifest.h"
+#include "../include/correction_cache.h"
+#include "../include/electron_factory.h"
+#include "../include/event_info.h"
+#include "../include/jet_factory.h"
+#include "../include/json.hpp"
+#include "../include/met_factory.h"
+#include "../include/muon_factory.h"
+#include "../include/tau_factory.h"
+#include "RooArgList.h"
+#include "RooFormulaVar.h"
+#include "RooMsgService.h"
+#include "RooRealVar.h"
+#include "RooWorkspace.h"
+#include "TError.h"
+#include "TF1.h"
+#include "TFile.h"
+#include "TGraph.h"
+#include "TH1D.h"
+#include "TH1F.h"
+#include "TH2F.h"
+#include "TRandom3.h"
+#include "TTree.h"
+
+//////////////////////////////////////////////////////
+// Purpose: To write synthetic inputs for the whole //
+// chain so it can be run and benchmarked without   //
+// the real ntuples or the remote correction files. //
+//                                                  //
+// Ntuples get every branch the factories bind for  //
+// the requested year, channels and shifts, with    //
+// the leaf types from their manifests. The values  //
+// are drawn from rough but realistic distributions //
+// (falling pT spectra, genuine and fake taus, jet  //
+// multiplicities, Z/H-like di-tau masses), so the  //
+// selection keeps a realistic fraction of events.  //
+//                                                  //
+// The stand-in correction files (scale factor      //
+// workspaces, pileup, NNLOPS, top pT and AC        //
+// weights) are written as a correction mirror to   //
+// use with --mirror. The fake factor and fake      //
+// fraction inputs for create-fakes are written     //
+// too. The workspaces are described in             //
+// configs/synthetic.json.                          //
+//////////////////////////////////////////////////////
+
+struct particle {
+    double pt, eta, phi, m;
+    int q;
+
+    double px() const { return pt * std::cos(phi); }
+    double py() const { return pt * std::sin(phi); }
+    double pz() const { return pt * std::sinh(eta); }
+    double energy() const { return std::sqrt(std::pow(pt * std::cosh(eta), 2) + m * m); }
+};
+
+// one generated event. Branch values are derived from these
+struct synthetic_event {
+    ULong64_t evt;
+    UInt_t run, lumi;
+    particle lep, tau, j1, j2, b1, b2;
+    int lep_gen_match, tau_gen_match, tau_dm, njets, nbtag, ngen_jets;
+    double lep_iso, tau_raw, anti_lep, trigger, veto;
+    double npv, npu, met, met_phi, met_sig, m_sv, pt_sv, mjj, top_pt1, top_pt2;
+    double mela[8];  // uniform numbers for the MELA angles and matrix elements
+};
+
+typedef std::function<double(const synthetic_event &)> branch_rule;
+
+// storage for one branch of any leaf type a factory binds
+class leaf_buffer {
+ private:
+    char type;
+    union {
+        Float_t f;
+        Double_t d;
+        Int_t i;
+        UInt_t ui;
+        Long64_t l;
+        ULong64_t ul;
+        Bool_t o;
+    } value;
+
+ public:
+    explicit leaf_buffer(char _type) : type(_type) { value.d = 0; }
+    void *address() { return &value; }
+    std::string leaflist(std::string name) const { return name + "/" + std::string(1, type); }
+    void set(double);
+};
+
+void leaf_buffer::set(double val) {
+    switch (type) {
+        case 'D':
+            value.d = val;
+            break;
+        case 'I':
+            value.i = static_cast<Int_t>(std::lround(val));
+            break;
+        case 'i':
+            value.ui = static_cast<UInt_t>(std::lround(val));
+            break;
+        case 'L':
+            value.l = static_cast<Long64_t>(std::llround(val));
+            break;
+        case 'l':
+            value.ul = static_cast<ULong64_t>(std::llround(val));
+            break;
+        case 'O':
+            value.o = val != 0;
+            break;
+        default:
+            value.f = static_cast<Float_t>(val);
+    }
+}
+
+branch_manifest factory_manifest(lepton, int, std::vector<std::string>);
+void generate_event(synthetic_event *, TRandom3 *, Long64_t, double);
+branch_rule find_rule(std::string, lepton, double);
+void write_workspace(std::string, nlohmann::json, nlohmann::json);
+void write_pileup(std::string, std::string, std::vector<std::string>);
+void write_nnlops(std::string);
+void write_top_pt(std::string);
+void write_ac_weights(std::string, std::vector<Long64_t>, TRandom3 *);
+std::string ac_weight_file(std::string, std::string);
+void write_fake_factors(std::string, std::vector<std::string>);
+void write_fake_fractions(std::string);
+
+int main(int argc, char *argv[]) {
+    CLParser parser(argc, argv);
+    std::string output_dir = parser.Option("-o");
+    std::string year = parser.Option("-y").empty() ? "2018" : parser.Option("-y");
+    Long64_t nevents = parser.Option("-n").empty() ? 10000 : std::stoll(parser.Option("-n"));
+    std::string config_name = parser.Option("-c").empty() ? "configs/synthetic.json" : parser.Option("-c");
+    unsigned seed = parser.Option("--seed").empty() ? 12345 : std::stoul(parser.Option("--seed"));
+    auto channels = parser.ListOption("-l");
+    auto samples = parser.ListOption("-s");
+    auto shifts = parser.ListOption("-u");
+
+    if (output_dir.empty()) {
+        std::cerr << "Usage: generate-ntuples -o <output dir> [-y year] [-n events per sample] [-l mt,et] [-s sample1,sample2] "
+                  << "[-u shift1,shift2] [-c config] [--seed seed]" << std::endl;
+        return 1;
+    }
+    if (channels.empty()) {
+        channels = {"mt", "et"};
+    }
+    if (samples.empty()) {
+        samples = {"DYJets", "TT", "WJets", "VV", "data", "embed", "ggh125_JHU_a1-prod", "vbf125_powheg"};
+    }
+
+    // shifts are given the same way as to the analyzers with --all-systs
+    std::vector<std::string> systs{""};
+    systs.insert(systs.end(), shifts.begin(), shifts.end());
+
+    std::ifstream config_file(config_name);
+    nlohmann::json config_json;
+    config_file >> config_json;
+    auto year_json = config_json.at(year);
+    int era = std::stoi(year);
+
+    RooMsgService::instance().setGlobalKillBelow(RooFit::WARNING);
+
+    // ntuples
+    std::map<std::string, std::vector<Long64_t>> event_ids;
+    std::vector<std::string> datasets;
+    for (auto &channel : channels) {
+        auto lep = channel == "et" ? lepton::ELECTRON : lepton::MUON;
+        auto tree_name = channel == "et" ? "etau_tree" : "mutau_tree";
+        auto manifest = factory_manifest(lep, era, systs);
+        auto &names = manifest.getBranches();
+
+        auto ntuple_dir = output_dir + "/ntuples/" + year + "/" + channel;
+        if (!cache_utils::make_dirs(ntuple_dir)) {
+            std::cerr << "Unable to create " << ntuple_dir << std::endl;
+            return 1;
+        }
+
+        for (std::size_t s = 0; s < samples.size(); s++) {
+            auto sample = samples.at(s);
+            bool isData = sample.find("data") != std::string::npos;
+            bool isEmbed = sample.find("embed") != std::string::npos;
+            double resonance(0.);
+            if (sample.find("125") != std::string::npos) {
+                resonance = 125.;
+            } else if (sample.find("DYJets") != std::string::npos || isEmbed) {
+                resonance = 91.;
+            }
+
+            // every channel gets the same events for a sample, so they share the AC weights
+            TRandom3 rng(seed + s);
+            auto fout = new TFile((ntuple_dir + "/" + sample + ".root").c_str(), "RECREATE");
+            auto tree = new TTree(tree_name, tree_name);
+
+            // size the buffers before taking any addresses
+            std::vector<leaf_buffer> buffers;
+            std::vector<branch_rule> rules;
+            for (auto &name : names) {
+                buffers.push_back(leaf_buffer(manifest.getType(name)));
+                rules.push_back(find_rule(name, lep, resonance));
+            }
+            for (std::size_t i = 0; i < names.size(); i++) {
+                tree->Branch(names.at(i).c_str(), buffers.at(i).address(), buffers.at(i).leaflist(names.at(i)).c_str());
+            }
+
+            synthetic_event event;
+            std::vector<Long64_t> ids;
+            for (Long64_t entry = 0; entry < nevents; entry++) {
+                generate_event(&event, &rng, entry, resonance);
+                if (isData) {
+                    event.run = 320000;
+                }
+                for (std::size_t i = 0; i < names.size(); i++) {
+                    buffers.at(i).set(rules.at(i)(event));
+                }
+                tree->Fill();
+                ids.push_back(static_cast<Long64_t>(event.lumi) * 1000000 + event.evt);
+            }
+            tree->Write();
+
+            // number of generated events is read from bin 2
+            auto counts = new TH1D("nevents", "nevents", 2, 0.5, 2.5);
+            counts->SetBinContent(1, nevents);
+            counts->SetBinContent(2, nevents);
+            counts->Write();
+
+            // 2017 MC is pileup reweighted per dataset
+            if (year == "2017" && !isData && !isEmbed) {
+                std::string dataset = "/" + sample + "_synthetic/RunIIFall17MiniAODv2/MINIAODSIM";
+                auto dbs_name = new TH1F("MiniAOD_name", dataset.c_str(), 1, 0, 1);
+                dbs_name->Write();
+                std::replace(dataset.begin(), dataset.end(), '/', '#');
+                if (std::find(datasets.begin(), datasets.end(), dataset) == datasets.end()) {
+                    datasets.push_back(dataset);
+                }
+            }
+            fout->Close();
+
+            event_ids[sample] = ids;
+            std::cout << "Wrote " << nevents << " events with " << names.size() << " branches to " << ntuple_dir << "/" << sample << ".root" << std::endl;
+        }
+    }
+
+    // correction files, laid out like the remote files so they can be used with --mirror
+    auto sf_dir = output_dir + "/mirror/" + config_json.at("scale_factor_dir").get<std::string>();
+    auto ac_dir = output_dir + "/mirror/" + config_json.at("ac_weight_dir").get<std::string>() + "/JHU" + year;
+    if (!cache_utils::make_dirs(sf_dir) || !cache_utils::make_dirs(ac_dir)) {
+        std::cerr << "Unable to create the correction mirror in " << output_dir << "/mirror" << std::endl;
+        return 1;
+    }
+    write_workspace(sf_dir + "/" + year_json.at("workspace").get<std::string>(), year_json.at("functions"), config_json.at("inputs"));
+    write_workspace(sf_dir + "/" + year_json.at("madgraph_workspace").get<std::string>(), config_json.at("madgraph_functions"),
+                    config_json.at("inputs"));
+    write_pileup(sf_dir + "/" + year_json.at("pileup_mc").get<std::string>(), "mc", datasets);
+    write_pileup(sf_dir + "/" + year_json.at("pileup_data").get<std::string>(), "data", {});
+    write_nnlops(sf_dir + "/NNLOPS_reweight.root");
+    write_top_pt(sf_dir + "/toppt_correction_to_2016.root");
+
+    TRandom3 ac_rng(seed);
+    for (auto &sample : samples) {
+        auto ac_file = ac_weight_file(sample, ac_dir);
+        if (!ac_file.empty()) {
+            write_ac_weights(ac_file, event_ids.at(sample), &ac_rng);
+        }
+    }
+    std::cout << "Wrote the correction mirror to " << output_dir << "/mirror" << std::endl;
+
+    // fake factor inputs for create-fakes
+    auto ff_dir = output_dir + "/fake_factors/";
+    if (!cache_utils::make_dirs(ff_dir.substr(0, ff_dir.size() - 1))) {
+        std::cerr << "Unable to create " << ff_dir << std::endl;
+        return 1;
+    }
+    write_fake_factors(ff_dir, channels);
+    for (auto &channel : channels) {
+        write_fake_fractions(ff_dir + "fake_fractions_" + channel + ".root");
+    }
+    std::cout << "Wrote the fake factor inputs to " << ff_dir << std::endl;
+    return 0;
+}
+
+// every branch the analyzer factories bind for these shifts. The factories are bound to a scratch
+// tree, so ROOT's complaints about missing branches are silenced
+branch_manifest factory_manifest(lepton lep, int era, std::vector<std::string> systs) {
+    auto error_level = gErrorIgnoreLevel;
+    gErrorIgnoreLevel = kFatal;
+    TTree scratch("scratch", "scratch");
+
+    // madgraph weights and Rivet inputs are only read for some signals. Include them anyway
+    event_info event(&scratch, lep, era, true, systs);
+    event.setRivets(&scratch);
+    tau_factory taus(&scratch, era, systs);
+    jet_factory jets(&scratch, era, systs);
+    met_factory met(&scratch, era, systs);
+
+    branch_manifest manifest;
+    manifest.add(event.getManifest());
+    if (lep == lepton::ELECTRON) {
+        electron_factory electrons(&scratch, era, systs);
+        manifest.add(electrons.getManifest());
+    } else {
+        muon_factory muons(&scratch, era, systs);
+        manifest.add(muons.getManifest());
+    }
+    manifest.add(taus.getManifest());
+    manifest.add(jets.getManifest());
+    manifest.add(met.getManifest());
+    gErrorIgnoreLevel = error_level;
+    return manifest;
+}
+
+// draw one event. resonance is the mass of the di-tau system, or 0 for non-resonant backgrounds
+void generate_event(synthetic_event *event, TRandom3 *rng, Long64_t entry, double resonance) {
+    // unique lumi * 1000000 + evt, like the AC weight trees expect
+    event->run = 1;
+    event->lumi = entry / 100000 + 1;
+    event->evt = entry % 100000 + 1;
+
+    // light lepton. Low enough to hit the cross-triggers some of the time
+    double lep_mass = 0.10566;
+    event->lep = particle{20. + rng->Exp(15.), rng->Uniform(-2.1, 2.1), rng->Uniform(-M_PI, M_PI), lep_mass, rng->Rndm() < 0.5 ? 1 : -1};
+    event->lep_iso = rng->Exp(0.08);
+    double u = rng->Rndm();
+    event->lep_gen_match = u < 0.5 ? 4 : (u < 0.9 ? 2 : 6);
+
+    // tau: 60% genuine, 30% jet fakes and 10% lepton fakes
+    u = rng->Rndm();
+    event->tau_gen_match = u < 0.6 ? 5 : (u < 0.9 ? 6 : 1 + rng->Integer(4));
+    u = rng->Rndm();
+    event->tau_dm = u < 0.25 ? 0 : (u < 0.75 ? 1 : (u < 0.95 ? 10 : 11));
+    double tau_mass = event->tau_dm == 0 ? 0.13957 : std::min(1.7, std::max(0.3, rng->Gaus(event->tau_dm == 1 ? 0.8 : 1.2, 0.2)));
+    event->tau = particle{30. + rng->Exp(20.), rng->Uniform(-2.3, 2.3), rng->Uniform(-M_PI, M_PI), tau_mass,
+                          rng->Rndm() < 0.9 ? -event->lep.q : event->lep.q};
+
+    // isolation discriminant. Genuine taus are mostly isolated and jet fakes mostly aren't
+    event->tau_raw = event->tau_gen_match == 6 ? std::pow(rng->Rndm(), 3) : 1. - 0.4 * std::pow(rng->Rndm(), 2);
+    event->anti_lep = rng->Rndm();
+
+    // jets
+    event->njets = std::min(rng->Poisson(1.2), 6);
+    event->ngen_jets = std::min(event->njets + rng->Poisson(0.2), 4);
+    particle no_jet{-10000., 0., 0., 0., 0};
+    event->j1 = event->njets > 0 ? particle{30. + rng->Exp(50.), rng->Uniform(-4.7, 4.7), rng->Uniform(-M_PI, M_PI), 0., 0} : no_jet;
+    event->j2 = event->njets > 1 ? particle{30. + rng->Exp(25.), rng->Uniform(-4.7, 4.7), rng->Uniform(-M_PI, M_PI), 0., 0} : no_jet;
+    if (event->j2.pt > event->j1.pt) {
+        std::swap(event->j1, event->j2);
+    }
+    event->mjj = event->njets > 1 ? std::sqrt(2 * event->j1.pt * event->j2.pt *
+                                               (std::cosh(event->j1.eta - event->j2.eta) - std::cos(event->j1.phi - event->j2.phi)))
+                                  : -10000.;
+    event->nbtag = std::min(rng->Poisson(0.15), 2);
+    event->b1 = event->nbtag > 0 ? particle{20. + rng->Exp(40.), rng->Uniform(-2.4, 2.4), rng->Uniform(-M_PI, M_PI), 0., 0} : no_jet;
+    event->b2 = event->nbtag > 1 ? particle{20. + rng->Exp(30.), rng->Uniform(-2.4, 2.4), rng->Uniform(-M_PI, M_PI), 0., 0} : no_jet;
+    event->top_pt1 = 50. + rng->Exp(80.);
+    event->top_pt2 = 50. + rng->Exp(80.);
+
+    // MET, pileup and SVFit
+    event->met = rng->Exp(30.);
+    event->met_phi = rng->Uniform(-M_PI, M_PI);
+    event->met_sig = rng->Exp(3.);
+    event->npu = std::min(99., std::max(0., rng->Gaus(32., 12.)));
+    event->npv = std::max(1, rng->Poisson(event->npu * 0.9));
+    event->m_sv = resonance > 0 ? std::max(10., rng->Gaus(resonance, 0.15 * resonance)) : 40. + rng->Exp(70.);
+    event->pt_sv = rng->Exp(50.);
+
+    event->trigger = rng->Rndm();
+    event->veto = rng->Rndm();
+    for (auto &m : event->mela) {
+        m = rng->Rndm();
+    }
+}
+
+// working point rank in the tau discriminant names. 0 if the name has no working point
+int working_point(std::string name) {
+    std::vector<std::string> wps{"VVVLoose", "VVLoose", "VLoose", "Loose", "Medium", "VVTight", "VTight", "Tight"};
+    std::vector<int> ranks{1, 2, 3, 4, 5, 8, 7, 6};
+    for (std::size_t i = 0; i < wps.size(); i++) {
+        if (name.find(wps.at(i)) != std::string::npos) {
+            return ranks.at(i);
+        }
+    }
+    return 0;
+}
+
+// how each input branch is filled from the generated event
+branch_rule find_rule(std::string name, lepton lep, double resonance) {
+    auto end = std::string::npos;
+    bool muon_channel = lep == lepton::MUON;
+    double gen_mass = resonance > 0 ? resonance : 91.;
+
+    static const std::map<std::string, branch_rule> rules{
+        // light lepton
+        {"px_1", [](const synthetic_event &e) { return e.lep.px(); }},
+        {"py_1", [](const synthetic_event &e) { return e.lep.py(); }},
+        {"pz_1", [](const synthetic_event &e) { return e.lep.pz(); }},
+        {"pt_1", [](const synthetic_event &e) { return e.lep.pt; }},
+        {"eta_1", [](const synthetic_event &e) { return e.lep.eta; }},
+        {"phi_1", [](const synthetic_event &e) { return e.lep.phi; }},
+        {"m_1", [](const synthetic_event &e) { return e.lep.m; }},
+        {"q_1", [](const synthetic_event &e) { return e.lep.q; }},
+        {"gen_match_1", [](const synthetic_event &e) { return e.lep_gen_match; }},
+        {"mRelPFIsoDBDefault", [](const synthetic_event &e) { return e.lep_iso; }},
+        {"eRelPFIsoRho", [](const synthetic_event &e) { return e.lep_iso; }},
+        {"mGenPt", [](const synthetic_event &e) { return e.lep.pt; }},
+        {"mGenEta", [](const synthetic_event &e) { return e.lep.eta; }},
+        {"mGenPhi", [](const synthetic_event &e) { return e.lep.phi; }},
+        {"mGenEnergy", [](const synthetic_event &e) { return e.lep.energy(); }},
+        {"eGenPt", [](const synthetic_event &e) { return e.lep.pt; }},
+        {"eGenEta", [](const synthetic_event &e) { return e.lep.eta; }},
+        {"eGenPhi", [](const synthetic_event &e) { return e.lep.phi; }},
+        {"eGenEnergy", [](const synthetic_event &e) { return e.lep.energy(); }},
+        {"eCorrectedEt", [](const synthetic_event &e) { return e.lep.energy(); }},
+        {"eEnergyScaleUp", [](const synthetic_event &e) { return 1.005 * e.lep.energy(); }},
+        {"eEnergyScaleDown", [](const synthetic_event &e) { return 0.995 * e.lep.energy(); }},
+        {"eEnergySigmaUp", [](const synthetic_event &e) { return 1.002 * e.lep.energy(); }},
+        {"eEnergySigmaDown", [](const synthetic_event &e) { return 0.998 * e.lep.energy(); }},
+
+        // tau
+        {"pt_2", [](const synthetic_event &e) { return e.tau.pt; }},
+        {"eta_2", [](const synthetic_event &e) { return e.tau.eta; }},
+        {"phi_2", [](const synthetic_event &e) { return e.tau.phi; }},
+        {"m_2", [](const synthetic_event &e) { return e.tau.m; }},
+        {"e_2", [](const synthetic_event &e) { return e.tau.energy(); }},
+        {"q_2", [](const synthetic_event &e) { return e.tau.q; }},
+        {"gen_match_2", [](const synthetic_event &e) { return e.tau_gen_match; }},
+        {"tZTTGenPt", [](const synthetic_event &e) { return e.tau.pt; }},
+        {"tZTTGenEta", [](const synthetic_event &e) { return e.tau.eta; }},
+        {"tZTTGenPhi", [](const synthetic_event &e) { return e.tau.phi; }},
+        {"tDecayMode", [](const synthetic_event &e) { return e.tau_dm; }},
+        {"tDecayModeFinding", [](const synthetic_event &e) { return e.tau_dm != 11; }},
+        {"tDecayModeFindingNewDMs", [](const synthetic_event &e) { return 1.; }},
+        {"tRerunMVArun2v2DBoldDMwLTraw", [](const synthetic_event &e) { return 2 * e.tau_raw - 1; }},
+        {"tDeepTau2017v2p1VSjetraw", [](const synthetic_event &e) { return e.tau_raw; }},
+        {"tes_syst_up", [](const synthetic_event &e) { return 0.008; }},
+        {"tes_syst_down", [](const synthetic_event &e) { return -0.008; }},
+        {"ftes_syst_up", [](const synthetic_event &e) { return 0.01; }},
+        {"ftes_syst_down", [](const synthetic_event &e) { return -0.01; }},
+
+        // jets
+        {"nbtag", [](const synthetic_event &e) { return e.nbtag; }},
+        {"j1pt", [](const synthetic_event &e) { return e.j1.pt; }},
+        {"j1eta", [](const synthetic_event &e) { return e.j1.eta; }},
+        {"j1phi", [](const synthetic_event &e) { return e.j1.phi; }},
+        {"j1csv", [](const synthetic_event &e) { return e.njets > 0 ? e.mela[5] * 0.4 : -10000.; }},
+        {"j2pt", [](const synthetic_event &e) { return e.j2.pt; }},
+        {"j2eta", [](const synthetic_event &e) { return e.j2.eta; }},
+        {"j2phi", [](const synthetic_event &e) { return e.j2.phi; }},
+        {"j2csv", [](const synthetic_event &e) { return e.njets > 1 ? e.mela[6] * 0.4 : -10000.; }},
+        {"jb1pt", [](const synthetic_event &e) { return e.b1.pt; }},
+        {"jb1eta", [](const synthetic_event &e) { return e.b1.eta; }},
+        {"jb1phi", [](const synthetic_event &e) { return e.b1.phi; }},
+        {"deepcsvb1_btagscore", [](const synthetic_event &e) { return e.nbtag > 0 ? 0.5 + 0.5 * e.mela[5] : -10000.; }},
+        {"jb1hadronflavor", [](const synthetic_event &e) { return e.nbtag > 0 ? 5 : 0; }},
+        {"jb2pt", [](const synthetic_event &e) { return e.b2.pt; }},
+        {"jb2eta", [](const synthetic_event &e) { return e.b2.eta; }},
+        {"jb2phi", [](const synthetic_event &e) { return e.b2.phi; }},
+        {"deepcsvb2_btagscore", [](const synthetic_event &e) { return e.nbtag > 1 ? 0.5 + 0.5 * e.mela[6] : -10000.; }},
+        {"jb2hadronflavor", [](const synthetic_event &e) { return e.nbtag > 1 ? 5 : 0; }},
+        {"topQuarkPt1", [](const synthetic_event &e) { return e.top_pt1; }},
+        {"topQuarkPt2", [](const synthetic_event &e) { return e.top_pt2; }},
+
+        // MET
+        {"metSig", [](const synthetic_event &e) { return e.met_sig; }},
+        {"metcov00", [](const synthetic_event &e) { return 400.; }},
+        {"metcov01", [](const synthetic_event &e) { return 20.; }},
+        {"metcov10", [](const synthetic_event &e) { return 20.; }},
+        {"metcov11", [](const synthetic_event &e) { return 400.; }},
+        {"met_px", [](const synthetic_event &e) { return e.met * std::cos(e.met_phi); }},
+        {"met_py", [](const synthetic_event &e) { return e.met * std::sin(e.met_phi); }},
+
+        // event
+        {"evt", [](const synthetic_event &e) { return e.evt; }},
+        {"run", [](const synthetic_event &e) { return e.run; }},
+        {"lumi", [](const synthetic_event &e) { return e.lumi; }},
+        {"nvtx", [](const synthetic_event &e) { return e.npv; }},
+        {"nTruePU", [](const synthetic_event &e) { return e.npu; }},
+        {"genpX", [](const synthetic_event &e) { return e.lep.px() + e.tau.px(); }},
+        {"genpY", [](const synthetic_event &e) { return e.lep.py() + e.tau.py(); }},
+        {"genpT", [](const synthetic_event &e) { return std::hypot(e.lep.px() + e.tau.px(), e.lep.py() + e.tau.py()); }},
+        {"tZTTGenDR", [](const synthetic_event &e) { return 0.01; }},
+        {"numGenJets", [](const synthetic_event &e) { return e.ngen_jets; }},
+        {"GenWeight", [](const synthetic_event &e) { return 1.; }},
+        {"prefiring_weight", [](const synthetic_event &e) { return 0.99; }},
+        {"prefiring_weight_up", [](const synthetic_event &e) { return 1.; }},
+        {"prefiring_weight_down", [](const synthetic_event &e) { return 0.98; }},
+        {"dimuonVeto", [](const synthetic_event &e) { return e.veto < 0.02; }},
+        {"dielectronVeto", [](const synthetic_event &e) { return e.veto > 0.98; }},
+        {"sm_weight_nlo", [](const synthetic_event &e) { return 1.; }},
+        {"mm_weight_nlo", [](const synthetic_event &e) { return 1.; }},
+        {"ps_weight_nlo", [](const synthetic_event &e) { return 1.; }},
+        {"Rivet_nJets30", [](const synthetic_event &e) { return e.njets; }},
+        {"Rivet_higgsPt", [](const synthetic_event &e) { return e.pt_sv; }},
+        {"Rivet_stage1_cat_pTjet30GeV", [](const synthetic_event &e) { return 101 + std::min(e.njets, 2); }},
+
+        // MELA
+        {"D_CP_VBF", [](const synthetic_event &e) { return 2 * e.mela[0] - 1; }},
+        {"D_CP_ggH", [](const synthetic_event &e) { return 2 * e.mela[1] - 1; }},
+        {"Phi0", [](const synthetic_event &e) { return M_PI * (2 * e.mela[2] - 1); }},
+        {"Phi1", [](const synthetic_event &e) { return M_PI * (2 * e.mela[3] - 1); }},
+        {"costheta1", [](const synthetic_event &e) { return 2 * e.mela[4] - 1; }},
+        {"costheta2", [](const synthetic_event &e) { return 2 * e.mela[5] - 1; }},
+        {"costhetastar", [](const synthetic_event &e) { return 2 * e.mela[6] - 1; }},
+        {"Q2V1", [](const synthetic_event &e) { return 1000. * e.mela[7] * e.mela[7]; }},
+        {"Q2V2", [](const synthetic_event &e) { return 1000. * e.mela[0] * e.mela[7]; }},
+    };
+
+    auto found = rules.find(name);
+    if (found != rules.end()) {
+        return found->second;
+    }
+
+    // rules that depend on the channel or sample
+    if (name == "muVetoZTTp001dxyzR0") {
+        return [muon_channel](const synthetic_event &e) { return (muon_channel ? 1. : 0.) + (e.veto < 0.02); };
+    } else if (name == "eVetoZTTp001dxyzR0") {
+        return [muon_channel](const synthetic_event &e) { return (muon_channel ? 0. : 1.) + (e.veto > 0.98); };
+    } else if (name == "genM") {
+        return [gen_mass](const synthetic_event &e) { return gen_mass; };
+    }
+
+    // families of branches
+    if (name.find("Flag_") == 0) {
+        return [](const synthetic_event &e) { return 0.; };  // 0 passes
+    } else if (name.find("Pass") != end || name.find("Matches") != end || name.find("MatchEmbedded") != end) {
+        return [](const synthetic_event &e) { return e.trigger < 0.9; };
+    } else if (name.find("ME_") == 0) {
+        double scale = name.find("_ps_") != end ? 0.5e-3 : 1e-3;
+        return [scale](const synthetic_event &e) { return scale * (e.mela[4] + 0.001); };
+    } else if (name.find("bjetDeepCSVVeto20") == 0) {
+        return [](const synthetic_event &e) { return e.nbtag; };
+    } else if (name.find("tAgainst") == 0 || name.find("DeepTau2017v2p1VSe") != end || name.find("DeepTau2017v2p1VSmu") != end) {
+        double threshold = 0.02 * working_point(name);
+        return [threshold](const synthetic_event &e) { return e.anti_lep > threshold; };
+    } else if (name.find("tRerunMVArun2v2DBoldDMwLT") == 0 || name.find("DeepTau2017v2p1VSjet") != end) {
+        double threshold = 0.1 * working_point(name);
+        return [threshold](const synthetic_event &e) { return e.tau_raw > threshold; };
+    }
+
+    // shifted branches (i.e. m_sv_DM0_Up or vbfMass_JetAbsoluteUp)
+    double shift(1.);
+    if (name.find("Up") != end) {
+        shift = 1.01;
+    } else if (name.find("Down") != end) {
+        shift = 0.99;
+    }
+    if (name.find("m_sv") == 0) {
+        return [shift](const synthetic_event &e) { return shift * e.m_sv; };
+    } else if (name.find("pt_sv") == 0) {
+        return [shift](const synthetic_event &e) { return shift * e.pt_sv; };
+    } else if (name.find("vbfMass") == 0) {
+        return [shift](const synthetic_event &e) { return e.mjj > 0 ? shift * e.mjj : e.mjj; };
+    } else if (name.find("jetVeto30") == 0) {
+        return [](const synthetic_event &e) { return e.njets; };
+    } else if (name.find("metphi") == 0) {
+        return [shift](const synthetic_event &e) { return e.met_phi; };
+    } else if (name.find("met") == 0) {
+        return [shift](const synthetic_event &e) { return shift * e.met; };
+    }
+
+    std::cerr << "No rule for branch " << name << ". Filling it with 1" << std::endl;
+    return [](const synthetic_event &e) { return 1.; };
+}
+
+// RooWorkspace "w" with every function in the config and its _up/_down variations. Each function is
+// a product of smooth shapes in its inputs, so evaluating it costs about as much as a real one
+void write_workspace(std::string filename, nlohmann::json functions, nlohmann::json inputs) {
+    RooWorkspace workspace("w", "w");
+    std::map<std::string, RooRealVar *> vars;
+    for (auto &input : inputs.items()) {
+        auto range = input.value();
+        auto min = range.at(0).get<double>(), max = range.at(1).get<double>();
+        vars[input.key()] = new RooRealVar(input.key().c_str(), input.key().c_str(), (min + max) / 2, min, max);
+        workspace.import(*vars.at(input.key()), RooFit::Silence());
+    }
+
+    for (auto &function : functions.items()) {
+        RooArgList args;
+        std::string formula("1");
+        for (auto &input : function.value()) {
+            auto name = input.get<std::string>();
+            args.add(*vars.at(name));
+            if (name.find("eta") != std::string::npos) {
+                formula += "*(0.98+0.01*" + name + "*" + name + ")";
+            } else if (name.find("pt") != std::string::npos || name.find("pT") != std::string::npos) {
+                formula += "*(1.05-0.1*exp(-" + name + "/25))";
+            } else {
+                formula += "*(1+0.0002*" + name + ")";
+            }
+        }
+        for (auto &variation : std::vector<std::pair<std::string, std::string>>{{"", "1"}, {"_up", "1.02"}, {"_down", "0.98"}}) {
+            auto name = function.key() + variation.first;
+            RooFormulaVar func(name.c_str(), name.c_str(), (variation.second + "*" + formula).c_str(), args);
+            workspace.import(func, RooFit::RecycleConflictNodes(), RooFit::Silence());
+        }
+    }
+
+    TFile fout(filename.c_str(), "RECREATE");
+    workspace.Write();
+    fout.Close();
+}
+
+// pileup profiles. The 2017 MC file has one profile per dataset in pua/
+void write_pileup(std::string filename, std::string type, std::vector<std::string> datasets) {
+    TFile fout(filename.c_str(), "RECREATE");
+    double mean = type == "data" ? 30. : 32., width = type == "data" ? 11. : 13.;
+    auto fill = [mean, width](TH1F *hist) {
+        for (int bin = 1; bin <= 100; bin++) {
+            hist->SetBinContent(bin, std::exp(-0.5 * std::pow((bin - 0.5 - mean) / width, 2)));
+        }
+        hist->Write();
+    };
+    fill(new TH1F("pileup", "pileup", 100, 0, 100));
+    if (!datasets.empty()) {
+        fout.mkdir("pua");
+        fout.cd("pua");
+        for (auto &dataset : datasets) {
+            fill(new TH1F(("#" + dataset).c_str(), dataset.c_str(), 100, 0, 100));
+        }
+    }
+    fout.Close();
+}
+
+void write_nnlops(std::string filename) {
+    TFile fout(filename.c_str(), "RECREATE");
+    std::vector<double> x, y;
+    for (int i = 0; i <= 40; i++) {
+        x.push_back(25. * i);
+        y.push_back(1. + 0.1 * std::exp(-x.back() / 100.));
+    }
+    for (auto generator : {"powheg", "mcatnlo"}) {
+        for (int njets = 0; njets < 4; njets++) {
+            TGraph graph(x.size(), x.data(), y.data());
+            graph.Write(("gr_NNLOPSratio_pt_" + std::string(generator) + "_" + std::to_string(njets) + "jet").c_str());
+        }
+    }
+    fout.Close();
+}
+
+void write_top_pt(std::string filename) {
+    TFile fout(filename.c_str(), "RECREATE");
+    TF1 ratio("toppt_ratio_to_2016", "1.+0.0001*x", 0, 2000);
+    ratio.Write("toppt_ratio_to_2016");
+    fout.Close();
+}
+
+// AC weight file ACWeighter reads for a sample, or an empty string if it isn't a JHU signal
+std::string ac_weight_file(std::string sample, std::string ac_dir) {
+    if (sample.find("JHU") == std::string::npos) {
+        return "";
+    }
+
+    std::string prefix;
+    if (sample.find("ggh125") != std::string::npos) {
+        prefix = "ggh_ac_";
+    } else if (sample.find("vbf125") != std::string::npos) {
+        prefix = "vbf_ac_";
+    } else if (sample.find("wh125") != std::string::npos || sample.find("wplus125") != std::string::npos ||
+               sample.find("wminus125") != std::string::npos) {
+        prefix = "wh_ac_";
+    } else if (sample.find("zh125") != std::string::npos) {
+        prefix = "zh_ac_";
+    } else {
+        return "";
+    }
+
+    // same order as ACWeighter
+    std::vector<std::pair<std::string, std::string>> couplings{
+        {"a1-prod", "a1"},       {"nominal", "a1"},      {"a3-prod", "a3"},  {"ps_decay", "a3"},     {"a3int-prod", "a3int"},
+        {"maxmix_prod", "a3int"}, {"a2-prod", "a2"},      {"a2int-prod", "a2int"}, {"l1-prod", "L1"}, {"l1int-prod", "L1int"},
+        {"l1zg-prod", "L1Zg"},   {"l1zgint-prod", "L1Zgint"}};
+    for (auto &coupling : couplings) {
+        if (sample.find(coupling.first) != std::string::npos) {
+            return ac_dir + "/" + prefix + coupling.second + ".root";
+        }
+    }
+    return "";
+}
+
+void write_ac_weights(std::string filename, std::vector<Long64_t> ids, TRandom3 *rng) {
+    TFile fout(filename.c_str(), "RECREATE");
+    TTree tree("weights", "weights");
+    Long64_t eventID;
+    std::vector<std::string> names{"wt_a1", "wt_a2", "wt_a3", "wt_L1", "wt_L1Zg", "wt_a2int", "wt_a3int", "wt_L1int", "wt_L1Zgint"};
+    std::vector<Double_t> weights(names.size());
+    tree.Branch("eventID", &eventID, "eventID/L");
+    for (std::size_t i = 0; i < names.size(); i++) {
+        tree.Branch(names.at(i).c_str(), &weights.at(i), (names.at(i) + "/D").c_str());
+    }
+    for (auto id : ids) {
+        eventID = id;
+        weights.at(0) = 1.;
+        for (std::size_t i = 1; i < weights.size(); i++) {
+            weights.at(i) = std::exp(rng->Gaus(0., 0.5));
+        }
+        tree.Fill();
+    }
+    tree.Write();
+    fout.Close();
+}
+
+// every TF1 apply_ff reads, for each channel
+void write_fake_factors(std::string ff_dir, std::vector<std::string> channels) {
+    auto write = [](std::string name, std::string formula, double max) {
+        for (auto &variation : std::vector<std::pair<std::string, std::string>>{
+                 {"", "1"}, {"_unc1_up", "1.1"}, {"_unc1_down", "0.9"}, {"_unc2_up", "1.05"}, {"_unc2_down", "0.95"}}) {
+            TF1 func((name + variation.first).c_str(), (variation.second + "*" + formula).c_str(), 0, max);
+            func.Write((name + variation.first).c_str());
+        }
+    };
+
+    TFile closure_file((ff_dir + "FF_corrections_1.root").c_str(), "RECREATE");
+    for (auto &channel : channels) {
+        for (auto &process : {"qcd", "w"}) {
+            for (auto &njets : {"0jet", "1jet", "2jet"}) {
+                write("closure_mvis_" + channel + "_" + njets + "_" + process, "(1+0.0005*(x-100))", 1000);
+            }
+        }
+        write("closure_mvis_" + channel + "_ttmc", "(1+0.0005*(x-100))", 1000);
+
+        auto tau_pt_bins = channel == "mt" ? std::vector<std::string>{"taupt30to50", "taupt50to70", "tauptgt70"}
+                                           : std::vector<std::string>{"taupt30to40", "taupt40to50", "tauptgt50"};
+        for (auto &bin : tau_pt_bins) {
+            for (auto &trigger : {"", "xtrg_"}) {
+                for (auto &process : {"w", "qcd", "ttmc"}) {
+                    write("closure_lpt_" + bin + "_" + trigger + channel + "_" + process, "(1+0.001*(x-40))", 1000);
+                }
+            }
+        }
+    }
+    closure_file.Close();
+
+    TFile osss_file((ff_dir + "FF_QCDcorrectionOSSS.root").c_str(), "RECREATE");
+    for (auto &channel : channels) {
+        write("closure_OSSS_dr_flat_" + channel + "_qcd", "(1.05-0.02*x)", 10);
+        write("closure_mt_" + channel + "_w", "(1+0.002*(x-25))", 1000);
+    }
+    osss_file.Close();
+
+    for (auto &channel : channels) {
+        TFile raw_file((ff_dir + "uncorrected_fakefactors_" + channel + ".root").c_str(), "RECREATE");
+        for (auto &process : {"qcd", "w"}) {
+            for (auto &njets : {"0jet", "1jet", "2jet"}) {
+                write("rawFF_" + channel + "_" + process + "_" + njets, "(0.05+0.2*exp(-(x-20)/40))", 1000);
+            }
+        }
+        write("mc_rawFF_" + channel + "_tt", "(0.05+0.15*exp(-(x-20)/40))", 1000);
+        raw_file.Close();
+
+        TFile tau_pt_file((ff_dir + "tauptcorrection_" + channel + ".root").c_str(), "RECREATE");
+        write("mt_0jet_qcd_taupt_iso", "(1+0.001*(x-40))", 1000);
+        write("mt_0jet_w_taupt_iso", "(1+0.001*(x-40))", 1000);
+        tau_pt_file.Close();
+    }
+}
+
+// fake fractions in vis_mass vs njets for each category
+void write_fake_fractions(std::string filename) {
+    TFile fout(filename.c_str(), "RECREATE");
+    for (auto &category : {"0jet", "boosted", "vbf"}) {
+        fout.mkdir(category);
+        fout.cd(category);
+        std::vector<TH2F *> fractions;
+        for (auto &process : {"frac_w", "frac_tt", "frac_qcd", "frac_data"}) {
+            fractions.push_back(new TH2F(process, process, 30, 0, 300, 5, -0.5, 4.5));
+        }
+        for (int xbin = 1; xbin <= 30; xbin++) {
+            for (int ybin = 1; ybin <= 5; ybin++) {
+                double frac_w = 0.3 + 0.01 * xbin, frac_tt = 0.02 * ybin;
+                fractions.at(0)->SetBinContent(xbin, ybin, frac_w);
+                fractions.at(1)->SetBinContent(xbin, ybin, frac_tt);
+                fractions.at(2)->SetBinContent(xbin, ybin, 1 - frac_w - frac_tt);
+                fractions.at(3)->SetBinContent(xbin, ybin, 1.);
+            }
+        }
+        for (auto hist : fractions) {
+            hist->Write();
+        }
+    }
+    fout.Close();
+}
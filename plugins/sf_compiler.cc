@@ -0,0 +1,201 @@
+// Copyright [2020] Tyler Mitchell
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/CLParser.h"
+#include "../include/json.hpp"
+#include "../include/sf_table.h"
+#include "RooAbsReal.h"
+#include "RooMsgService.h"
+#include "RooRealVar.h"
+#include "RooWorkspace.h"
+#include "TFile.h"
+#include "TRandom3.h"
+
+//////////////////////////////////////////////////////
+// Purpose: To tabulate the scale factor functions  //
+// used by the analyzers from a RooWorkspace into   //
+// sf_tables. Every function is sampled at the bin  //
+// centers of the grid in configs/sf_tables.json,   //
+// then compared against RooFit at random points.   //
+// The table is stored binned or interpolated,      //
+// whichever is closer to RooFit, and the maximum   //
+// deviation is reported for each function. The job //
+// fails if any deviation is above the tolerance    //
+// (1e-3 unless --tolerance is given).              //
+//////////////////////////////////////////////////////
+
+struct deviation {
+    double abs, rel;
+};
+
+deviation validate(RooAbsReal *, sf_table *, std::vector<RooRealVar *>, TRandom3 *, int);
+
+int main(int argc, char *argv[]) {
+    CLParser parser(argc, argv);
+    std::string input_name = parser.Option("-i");
+    std::string output_name = parser.Option("-o");
+    std::string config_name = parser.Option("-c").empty() ? "configs/sf_tables.json" : parser.Option("-c");
+    std::string key = parser.Option("-k");
+    int npoints = parser.Option("-n").empty() ? 10000 : std::stoi(parser.Option("-n"));
+    // largest absolute deviation from RooFit any table may have, a negative value disables the check
+    double tolerance = parser.Option("--tolerance").empty() ? 1e-3 : std::stod(parser.Option("--tolerance"));
+
+    if (input_name.empty() || output_name.empty() || key.empty()) {
+        std::cerr << "Usage: sf-compiler -i <workspace file> -o <output json> -k <config key> [-c config] [-n points] [--tolerance max_abs_dev]" << std::endl;
+        return 1;
+    }
+
+    RooMsgService::instance().setGlobalKillBelow(RooFit::WARNING);
+
+    // read the workspace
+    auto sf_file = TFile::Open(input_name.c_str());
+    if (!sf_file || sf_file->IsZombie()) {
+        std::cerr << "Unable to open " << input_name << std::endl;
+        return 1;
+    }
+    auto workspace = reinterpret_cast<RooWorkspace *>(sf_file->Get("w"));
+    sf_file->Close();
+
+    // process json config
+    std::ifstream config_file(config_name);
+    nlohmann::json config_json;
+    config_file >> config_json;
+    auto default_binning = config_json.at("inputs");
+    auto functions = config_json.at(key);
+
+    // every input named anywhere in the config. Used to catch functions that depend on an input that isn't tabulated
+    std::vector<std::string> all_inputs;
+    for (auto &binning : default_binning.items()) {
+        all_inputs.push_back(binning.key());
+    }
+    for (auto &function : functions.items()) {
+        for (auto &input : function.value()) {
+            auto var_name = input.is_string() ? input.get<std::string>() : input.at(0).get<std::string>();
+            if (std::find(all_inputs.begin(), all_inputs.end(), var_name) == all_inputs.end()) {
+                all_inputs.push_back(var_name);
+            }
+        }
+    }
+
+    sf_tables tables;
+    TRandom3 rng(12345);
+    bool failed(false);
+    double worst(0.);
+    for (auto &function : functions.items()) {
+        auto name = function.key();
+        auto func = workspace->function(name.c_str());
+        if (!func) {
+            std::cerr << "\033[91m[ERROR]\033[0m " << name << " is not in the workspace" << std::endl;
+            failed = true;
+            continue;
+        }
+
+        // build the grid
+        std::vector<std::string> names;
+        std::vector<int> nbins;
+        std::vector<double> mins, maxs;
+        std::vector<RooRealVar *> vars;
+        for (auto &input : function.value()) {
+            // inputs are either a name using the default binning or [name, nbins, min, max]
+            nlohmann::json binning;
+            if (input.is_string()) {
+                names.push_back(input.get<std::string>());
+                binning = default_binning.at(names.back());
+            } else {
+                names.push_back(input.at(0).get<std::string>());
+                binning = {input.at(1), input.at(2), input.at(3)};
+            }
+            nbins.push_back(binning.at(0).get<int>());
+            mins.push_back(binning.at(1).get<double>());
+            maxs.push_back(binning.at(2).get<double>());
+            vars.push_back(workspace->var(names.back().c_str()));
+            if (!vars.back()) {
+                std::cerr << "\033[91m[ERROR]\033[0m input " << names.back() << " of " << name << " is not in the workspace" << std::endl;
+                failed = true;
+            }
+        }
+        if (std::find(vars.begin(), vars.end(), nullptr) != vars.end()) {
+            continue;
+        }
+
+        // make sure nothing else the function reads changes from event to event
+        bool missing_input(false);
+        for (auto &var_name : all_inputs) {
+            auto var = workspace->var(var_name.c_str());
+            if (var && std::find(names.begin(), names.end(), var_name) == names.end() && func->dependsOn(*var)) {
+                std::cerr << "\033[91m[ERROR]\033[0m " << name << " depends on " << var_name << ", which isn't one of its table inputs" << std::endl;
+                missing_input = true;
+            }
+        }
+        if (missing_input) {
+            failed = true;
+            continue;
+        }
+
+        // sample the function at every bin center. The last input varies fastest
+        std::size_t nvalues(1);
+        for (auto n : nbins) {
+            nvalues *= n;
+        }
+        std::vector<float> values(nvalues);
+        for (std::size_t flat = 0; flat < nvalues; flat++) {
+            auto remainder = flat;
+            for (int i = static_cast<int>(vars.size()) - 1; i >= 0; i--) {
+                auto bin = remainder % nbins.at(i);
+                remainder /= nbins.at(i);
+                vars.at(i)->setVal(mins.at(i) + (bin + 0.5) * (maxs.at(i) - mins.at(i)) / nbins.at(i));
+            }
+            values.at(flat) = func->getVal();
+        }
+
+        // keep whichever evaluation is closer to RooFit
+        auto table = tables.add(name, false, names, nbins, mins, maxs, values);
+        if (!table) {
+            failed = true;
+            continue;
+        }
+        auto binned = validate(func, table, vars, &rng, npoints);
+        table->setInterpolated(true);
+        auto interpolated = validate(func, table, vars, &rng, npoints);
+        table->setInterpolated(interpolated.abs < binned.abs);
+        auto best = table->isInterpolated() ? interpolated : binned;
+        worst = std::max(worst, best.abs);
+
+        std::cout << name << ": " << nvalues << " bins, " << (table->isInterpolated() ? "interpolated" : "binned")
+                  << ", max deviation " << best.abs << " (" << 100 * best.rel << "%)" << std::endl;
+        if (tolerance >= 0 && best.abs > tolerance) {
+            std::cerr << "\033[91m[ERROR]\033[0m " << name << " deviates from RooFit by more than " << tolerance << ". Use a finer grid" << std::endl;
+            failed = true;
+        }
+    }
+
+    tables.write(output_name);
+    std::cout << "Wrote " << tables.size() << " tables to " << output_name << " with a maximum deviation of " << worst << std::endl;
+    return failed ? 1 : 0;
+}
+
+// compare the table to RooFit at random points inside the grid
+deviation validate(RooAbsReal *func, sf_table *table, std::vector<RooRealVar *> vars, TRandom3 *rng, int npoints) {
+    deviation dev{0., 0.};
+    auto &axes = table->getAxes();
+    for (int point = 0; point < npoints; point++) {
+        for (std::size_t i = 0; i < vars.size(); i++) {
+            auto val = rng->Uniform(axes.at(i).min, axes.at(i).max);
+            vars.at(i)->setVal(val);
+            axes.at(i).input->setVal(val);
+        }
+        double expected = func->getVal();
+        double diff = std::fabs(table->getVal() - expected);
+        dev.abs = std::max(dev.abs, diff);
+        if (expected != 0.) {
+            dev.rel = std::max(dev.rel, diff / std::fabs(expected));
+        }
+    }
+    return dev;
+}
@@ -22,12 +22,16 @@
 #include "../include/CLParser.h"
 #include "../include/ComputeWG1Unc.h"
 #include "../include/LumiReweightingStandAlone.h"
+#include "../include/event_category.h"
 #include "../include/event_info.h"
 #include "../include/jet_factory.h"
 #include "../include/met_factory.h"
 #include "../include/muon_factory.h"
+#include "../include/process_info.h"
+#include "../include/sf_context.h"
 #include "../include/slim_tree.h"
 #include "../include/swiss_army_class.h"
+#include "../include/syst_descriptor.h"
 #include "../include/tau_factory.h"
 
 typedef std::vector<double> NumV;
@@ -45,6 +49,7 @@ int main(int argc, char *argv[]) {
     std::string sample = parser.Option("-s");
     std::string output_dir = parser.Option("-d");
     std::string signal_type = parser.Option("--stype");
+    std::string sf_table_file = parser.Option("--sf-tables");
     std::string fname = path + sample + ".root";
     bool isData = sample.find("data") != std::string::npos;
     bool isEmbed = sample.find("embed") != std::string::npos || name.find("embed") != std::string::npos;
@@ -56,6 +61,7 @@ int main(int argc, char *argv[]) {
     if (!syst.empty()) {
         systname = "SYST_" + syst;
     }
+    syst_descriptor shift(syst);
 
     // create output path
     auto suffix = "_output.root";
@@ -84,6 +90,7 @@ int main(int argc, char *argv[]) {
     logfile << "\t sample: " << sample << std::endl;
     logfile << "\t output_dir: " << output_dir << std::endl;
     logfile << "\t signal_type: " << signal_type << std::endl;
+    logfile << "\t sf_tables: " << sf_table_file << std::endl;
     logfile << "\t isData: " << isData << " isEmbed: " << isEmbed << " doAC: " << doAC << std::endl;
 
     auto fin = TFile::Open(fname.c_str());
@@ -122,6 +129,9 @@ int main(int argc, char *argv[]) {
         gen_number = 1.;
     }
 
+    // resolve the process once so the event loop doesn't compare strings
+    process_info proc(name, sample, signal_type);
+
     // reweighter for anomolous coupling samples
     ACWeighter ac_weights = ACWeighter(original, sample, signal_type, "2018");
     ac_weights.fillWeightMap();
@@ -146,6 +156,38 @@ int main(int argc, char *argv[]) {
     RooWorkspace *htt_sf = reinterpret_cast<RooWorkspace *>(htt_sf_file.Get("w"));
     htt_sf_file.Close();
 
+    // resolve every scale factor input and function once, instead of looking them up by name for every event
+    sf_context sf(htt_sf, sf_table_file);
+    auto sf_m_pt = sf.var("m_pt");
+    auto sf_m_eta = sf.var("m_eta");
+    auto sf_t_pt = sf.var("t_pt");
+    auto sf_t_eta = sf.var("t_eta");
+    auto sf_t_phi = sf.var("t_phi");
+    auto sf_t_dm = sf.var("t_dm");
+    auto sf_z_gen_mass = sf.var("z_gen_mass");
+    auto sf_z_gen_pt = sf.var("z_gen_pt");
+    auto sf_gt1_pt = sf.var("gt1_pt");
+    auto sf_gt1_eta = sf.var("gt1_eta");
+    auto sf_gt2_pt = sf.var("gt2_pt");
+    auto sf_gt2_eta = sf.var("gt2_eta");
+    auto sf_gt_pt = sf.var("gt_pt");
+    auto sf_gt_eta = sf.var("gt_eta");
+    auto sf_m_trk_ratio = sf.function("m_trk_ratio");
+    auto sf_m_idiso_ic_ratio = sf.function("m_idiso_ic_ratio");
+    auto sf_t_deeptauid_pt_medium = sf.function("t_deeptauid_pt_medium");
+    auto sf_t_id_vs_mu_eta_tight = sf.function("t_id_vs_mu_eta_tight");
+    auto sf_m_trg_20_ic_ratio = sf.function("m_trg_20_ic_ratio");
+    auto sf_t_trg_pog_deeptau_medium_mutau_ratio = sf.function("t_trg_pog_deeptau_medium_mutau_ratio");
+    auto sf_m_trg_ic_ratio = sf.function("m_trg_ic_ratio");
+    auto sf_zptmass_weight_nom = sf.function("zptmass_weight_nom");
+    auto sf_m_idiso_ic_embed_ratio = sf.function("m_idiso_ic_embed_ratio");
+    auto sf_t_deeptauid_pt_embed_medium = sf.function("t_deeptauid_pt_embed_medium");
+    auto sf_m_trg_20_ic_embed_ratio = sf.function("m_trg_20_ic_embed_ratio");
+    auto sf_t_trg_mediumDeepTau_mutau_embed_ratio = sf.function("t_trg_mediumDeepTau_mutau_embed_ratio");
+    auto sf_m_trg_ic_embed_ratio = sf.function("m_trg_ic_embed_ratio");
+    auto sf_m_sel_trg_ratio = sf.function("m_sel_trg_ratio");
+    auto sf_m_sel_id_ic_ratio = sf.function("m_sel_id_ic_ratio");
+
     // MadGraph Higgs pT file
     RooWorkspace *mg_sf;
     if (signal_type == "madgraph") {
@@ -192,7 +234,7 @@ int main(int argc, char *argv[]) {
 
         // find the event weight (not lumi*xs if looking at W or Drell-Yan)
         Float_t evtwt(norm), corrections(1.), sf_trig(1.), sf_id(1.), sf_iso(1.), sf_reco(1.);
-        if (name == "W") {
+        if (proc.has(process_traits::w_stitched)) {
             if (event.getNumGenJets() == 1) {
                 evtwt = 9.679;
             } else if (event.getNumGenJets() == 2) {
@@ -206,7 +248,7 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        if (name == "ZTT" || name == "ZLL" || name == "ZL" || name == "ZJ") {
+        if (proc.has(process_traits::dy_stitched)) {
             if (event.getNumGenJets() == 1) {
                 evtwt = 0.671;
             } else if (event.getNumGenJets() == 2) {
@@ -234,14 +276,10 @@ int main(int argc, char *argv[]) {
         }
 
         // Separate processes
-        if ((name == "ZL" || name == "TTL" || name == "VVL" || name == "STL") && tau.getGenMatch() > 4) {
-            continue;
-        } else if ((name == "ZTT" || name == "TTT" || name == "VVT" || name == "STT") && tau.getGenMatch() != 5) {
-            continue;
-        } else if ((name == "ZJ" || name == "TTJ" || name == "VVJ" || name == "STJ") && tau.getGenMatch() != 6) {
-            continue;
-        } else {
+        if (proc.passGenMatch(tau.getGenMatch())) {
             histos->at("cutflow")->Fill(3., 1.);
+        } else {
+            continue;
         }
 
         // only opposite-sign
@@ -253,7 +291,7 @@ int main(int argc, char *argv[]) {
         }
 
         // build Higgs
-        TLorentzVector Higgs = muon.getP4() + tau.getP4() + met.getP4();
+        auto Higgs = muon.getP4() + tau.getP4() + met.getP4();
 
         // calculate mt
         double met_x = met.getMet() * cos(met.getMetPhi());
@@ -285,7 +323,7 @@ int main(int argc, char *argv[]) {
         bool signalRegion = (tau.getMediumIsoDeep() && muon.getIso() < 0.15);
         bool antiTauIsoRegion = (tau.getMediumIsoDeep() == 0 && tau.getVVVLooseIsoDeep() > 0 && muon.getIso() < 0.15);
 
-        if (signal_type != "None") {
+        if (proc.isSignal()) {
             antiTauIsoRegion = false;  // don't need anti-tau iso region in signal
         }
 
@@ -308,48 +346,48 @@ int main(int argc, char *argv[]) {
             evtwt *= jets.getBWeight();
 
             // set workspace variables
-            htt_sf->var("m_pt")->setVal(muon.getPt());
-            htt_sf->var("m_eta")->setVal(muon.getEta());
-            htt_sf->var("t_pt")->setVal(tau.getPt());
-            htt_sf->var("t_eta")->setVal(tau.getEta());
-            htt_sf->var("t_phi")->setVal(tau.getPhi());
-            htt_sf->var("t_dm")->setVal(tau.getDecayMode());
-            htt_sf->var("z_gen_mass")->setVal(event.getGenM());
-            htt_sf->var("z_gen_pt")->setVal(event.getGenPt());
+            sf.set(sf_m_pt, muon.getPt());
+            sf.set(sf_m_eta, muon.getEta());
+            sf.set(sf_t_pt, tau.getPt());
+            sf.set(sf_t_eta, tau.getEta());
+            sf.set(sf_t_phi, tau.getPhi());
+            sf.set(sf_t_dm, tau.getDecayMode());
+            sf.set(sf_z_gen_mass, event.getGenM());
+            sf.set(sf_z_gen_pt, event.getGenPt());
 
             // start applying weights from workspace
-            evtwt *= htt_sf->function("m_trk_ratio")->getVal();
-            evtwt *= htt_sf->function("m_idiso_ic_ratio")->getVal();
+            evtwt *= sf.eval(sf_m_trk_ratio);
+            evtwt *= sf.eval(sf_m_idiso_ic_ratio);
 
             // tau ID efficiency SF and systematics
-            std::string id_name = "t_deeptauid_pt_medium";  // nominal
+            sf_shift id_shift(sf_shift::nominal);
             if (syst.find("tau_id_") != std::string::npos) {
-                id_name += syst.find("Up") != std::string::npos ? "_up" : "_down";
+                id_shift = syst.find("Up") != std::string::npos ? sf_shift::up : sf_shift::down;
             }
-            evtwt *= htt_sf->function(id_name.c_str())->getVal();
+            evtwt *= sf.eval(sf_t_deeptauid_pt_medium, id_shift);
 
             // muon fake rate SF
             if (tau.getDecayMode() == 2 || tau.getDecayMode() == 4) {
-                evtwt *= htt_sf->function("t_id_vs_mu_eta_tight")->getVal();
+                evtwt *= sf.eval(sf_t_id_vs_mu_eta_tight);
             }
 
             // trigger scale factors
             if (muon.getPt() < 25) {  // cross-trigger
-                evtwt *= htt_sf->function("m_trg_20_ic_ratio")->getVal();
+                evtwt *= sf.eval(sf_m_trg_20_ic_ratio);
                 if (syst == "trigger_up") {
-                    evtwt *= htt_sf->function("t_trg_pog_deeptau_medium_mutau_ratio_up")->getVal();
+                    evtwt *= sf.eval(sf_t_trg_pog_deeptau_medium_mutau_ratio, sf_shift::up);
                 } else if (syst == "trigger_down") {
-                    evtwt *= htt_sf->function("t_trg_pog_deeptau_medium_mutau_ratio_down")->getVal();
+                    evtwt *= sf.eval(sf_t_trg_pog_deeptau_medium_mutau_ratio, sf_shift::down);
                 } else {
-                    evtwt *= htt_sf->function("t_trg_pog_deeptau_medium_mutau_ratio")->getVal();
+                    evtwt *= sf.eval(sf_t_trg_pog_deeptau_medium_mutau_ratio);
                 }
             } else {  // muon trigger
-                evtwt *= htt_sf->function("m_trg_ic_ratio")->getVal();
+                evtwt *= sf.eval(sf_m_trg_ic_ratio);
             }
 
             // Z-pT Reweighting
-            if (name == "EWKZ2l" || name == "EWKZ2nu" || name == "ZTT" || name == "ZLL" || name == "ZL" || name == "ZJ") {
-                auto nom_zpt_weight = htt_sf->function("zptmass_weight_nom")->getVal();
+            if (proc.has(process_traits::z_pt_reweight)) {
+                auto nom_zpt_weight = sf.eval(sf_zptmass_weight_nom);
                 if (syst == "dyShape_Up") {
                     nom_zpt_weight = nom_zpt_weight + ((nom_zpt_weight - 1) * 0.1);
                 } else if (syst == "dyShape_Down") {
@@ -359,7 +397,7 @@ int main(int argc, char *argv[]) {
             }
 
             // top-pT Reweighting
-            if (name == "TTT" || name == "TTJ" || name == "TTL" || name == "STT" || name == "STJ" || name == "STL") {
+            if (proc.has(process_traits::top_pt_reweight)) {
                 float pt_top1 = std::min(static_cast<float>(400.), jets.getTopPt1());
                 float pt_top2 = std::min(static_cast<float>(400.), jets.getTopPt2());
                 if (syst == "ttbarShape_Up") {
@@ -372,19 +410,19 @@ int main(int argc, char *argv[]) {
             }
 
             // NNLOPS ggH reweighting
-            if (sample == "ggh125" && signal_type == "powheg") {
+            if (proc.has(process_traits::ggh_nnlops)) {
                 if (event.getNjetsRivet() == 0) evtwt *= g_NNLOPS_0jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(125.0)));
                 if (event.getNjetsRivet() == 1) evtwt *= g_NNLOPS_1jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(625.0)));
                 if (event.getNjetsRivet() == 2) evtwt *= g_NNLOPS_2jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(800.0)));
                 if (event.getNjetsRivet() >= 3) evtwt *= g_NNLOPS_3jet->Eval(std::min(event.getHiggsPtRivet(), static_cast<float>(925.0)));
                 NumV WG1unc = qcd_ggF_uncert_2017(event.getNjetsRivet(), event.getHiggsPtRivet(), event.getJetPtRivet());
-                if (syst.find("Rivet") != std::string::npos) {
-                    evtwt *= (1 + event.getRivetUnc(WG1unc, syst));
+                if (shift.is(syst_source::ggh_rivet)) {
+                    evtwt *= (1 + event.getRivetUnc(WG1unc, shift));
                 }
             }
 
             // MadGraph Higgs pT correction
-            if (signal_type == "madgraph") {
+            if (proc.getSignalType() == signal_kind::madgraph) {
                 mg_sf->var("HpT")->setVal(Higgs.Pt());
                 evtwt *= mg_sf->function("ggH_quarkmass_corr")->getVal();
             }
@@ -392,7 +430,8 @@ int main(int argc, char *argv[]) {
             // begin systematics
 
             // jet to tau fake rate systematics
-            if (tau.getGenMatch() == 6 && name == "TTJ" || name == "ZJ" || name == "W" || name == "VVJ") {
+            if (tau.getGenMatch() == 6 && proc.getProcess() == process_type::TTJ || proc.getProcess() == process_type::ZJ ||
+                proc.getProcess() == process_type::W || proc.getProcess() == process_type::VVJ) {
                 auto temp_tau_pt = std::min(200., static_cast<double>(tau.getPt()));
                 if (syst == "jetToTauFake_Up") {
                     evtwt *= (1 - (0.2 * temp_tau_pt / 100));
@@ -414,85 +453,84 @@ int main(int argc, char *argv[]) {
             evtwt *= helper->embed_tracking(tau.getDecayMode());
 
             // set workspace variables
-            htt_sf->var("m_pt")->setVal(muon.getPt());
-            htt_sf->var("m_eta")->setVal(muon.getEta());
-            htt_sf->var("t_pt")->setVal(tau.getPt());
-            htt_sf->var("t_eta")->setVal(tau.getEta());
-            htt_sf->var("t_phi")->setVal(tau.getPhi());
-            htt_sf->var("t_dm")->setVal(tau.getDecayMode());
-            htt_sf->var("gt1_pt")->setVal(muon.getGenPt());
-            htt_sf->var("gt1_eta")->setVal(muon.getGenEta());
-            htt_sf->var("gt2_pt")->setVal(tau.getGenPt());
-            htt_sf->var("gt2_eta")->setVal(tau.getGenEta());
+            sf.set(sf_m_pt, muon.getPt());
+            sf.set(sf_m_eta, muon.getEta());
+            sf.set(sf_t_pt, tau.getPt());
+            sf.set(sf_t_eta, tau.getEta());
+            sf.set(sf_t_phi, tau.getPhi());
+            sf.set(sf_t_dm, tau.getDecayMode());
+            sf.set(sf_gt1_pt, muon.getGenPt());
+            sf.set(sf_gt1_eta, muon.getGenEta());
+            sf.set(sf_gt2_pt, tau.getGenPt());
+            sf.set(sf_gt2_eta, tau.getGenEta());
 
             // start applying weights from workspace
-            evtwt *= htt_sf->function("m_trk_ratio")->getVal();
-            evtwt *= htt_sf->function("m_idiso_ic_embed_ratio")->getVal();
+            evtwt *= sf.eval(sf_m_trk_ratio);
+            evtwt *= sf.eval(sf_m_idiso_ic_embed_ratio);
 
             // tau ID eff SF
-            std::string embed_id_name = "t_deeptauid_pt_embed_medium";
+            sf_shift embed_id_shift(sf_shift::nominal);
             if (syst.find("tau_id_") != std::string::npos) {
-                embed_id_name += syst.find("Up") != std::string::npos ? "_up" : "_down";
+                embed_id_shift = syst.find("Up") != std::string::npos ? sf_shift::up : sf_shift::down;
             }
-            evtwt *= htt_sf->function(embed_id_name.c_str())->getVal();
+            evtwt *= sf.eval(sf_t_deeptauid_pt_embed_medium, embed_id_shift);
 
             // trigger scale factors
             if (muon.getPt() < 25) {  // cross-trigger
                 // muon-leg
-                evtwt *= htt_sf->function("m_trg_20_ic_embed_ratio")->getVal();
+                evtwt *= sf.eval(sf_m_trg_20_ic_embed_ratio);
                 // tau-leg
-                std::string tau_leg_name("t_trg_mediumDeepTau_mutau_embed_ratio");
+                sf_shift tau_leg_shift(sf_shift::nominal);
                 if (syst.find("trigger") != std::string::npos) {
-                    tau_leg_name += syst.find("Up") != std::string::npos ? "_up" : "_down";
+                    tau_leg_shift = syst.find("Up") != std::string::npos ? sf_shift::up : sf_shift::down;
                 }
-                evtwt *= htt_sf->function(tau_leg_name.c_str())->getVal();
+                evtwt *= sf.eval(sf_t_trg_mediumDeepTau_mutau_embed_ratio, tau_leg_shift);
             } else {  // muon trigger
-                evtwt *= htt_sf->function("m_trg_ic_embed_ratio")->getVal();
+                evtwt *= sf.eval(sf_m_trg_ic_embed_ratio);
             }
 
             // muon fake rate SF
             if (tau.getDecayMode() == 2 || tau.getDecayMode() == 4) {
-                evtwt *= htt_sf->function("t_id_vs_mu_eta_tight")->getVal();
+                evtwt *= sf.eval(sf_t_id_vs_mu_eta_tight);
             }
 
             // double muon trigger eff in selection
-            evtwt *= htt_sf->function("m_sel_trg_ratio")->getVal();
+            evtwt *= sf.eval(sf_m_sel_trg_ratio);
 
             // muon ID eff in selection (leg 1)
-            htt_sf->var("gt_pt")->setVal(muon.getGenPt());
-            htt_sf->var("gt_eta")->setVal(muon.getGenEta());
-            evtwt *= htt_sf->function("m_sel_id_ic_ratio")->getVal();
+            sf.set(sf_gt_pt, muon.getGenPt());
+            sf.set(sf_gt_eta, muon.getGenEta());
+            evtwt *= sf.eval(sf_m_sel_id_ic_ratio);
 
             // muon ID eff in selection (leg 2)
-            htt_sf->var("gt_pt")->setVal(tau.getGenPt());
-            htt_sf->var("gt_eta")->setVal(tau.getGenEta());
-            evtwt *= htt_sf->function("m_sel_id_ic_ratio")->getVal();
+            sf.set(sf_gt_pt, tau.getGenPt());
+            sf.set(sf_gt_eta, tau.getGenEta());
+            evtwt *= sf.eval(sf_m_sel_id_ic_ratio);
         }
         fout->cd();
 
-        std::vector<std::string> tree_cat;
+        unsigned tree_cat(0);
 
         // regions
         if (signalRegion) {
-            tree_cat.push_back("signal");
+            tree_cat |= event_category::signal;
         } else if (antiTauIsoRegion) {
-            tree_cat.push_back("antiTauIso");
+            tree_cat |= event_category::antiTauIso;
         }
 
         // event charge
         if (evt_charge == 0) {
-            tree_cat.push_back("OS");
+            tree_cat |= event_category::OS;
         }
 
-        std::shared_ptr<std::vector<double>> weights(nullptr);
         Long64_t currentEventID = event.getLumi();
         currentEventID = currentEventID * 1000000 + event.getEvt();
         if (doAC) {
-            weights = std::make_shared<std::vector<double>>(ac_weights.getWeights(currentEventID));
+            st->setACWeights(ac_weights.getWeights(currentEventID));
         }
 
         // fill the tree
-        st->fillTree(tree_cat, &muon, &tau, &jets, &met, &event, mt, evtwt, weights, name);
+        st->fillTree(tree_cat, &muon, &tau, &jets, &met, &event, mt, evtwt, proc);
     }  // close event loop
 
     fin->Close();
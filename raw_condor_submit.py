@@ -3,7 +3,7 @@ import sys
 import pwd
 
 
-def submit_command(jobName, job_configs, dryrun=False):
+def submit_command(jobName, job_configs, dryrun=False, cpus=1):
     print "Begin submitting skims..."
 
     head_dir = '/nfs_scratch/{}/{}'.format(
@@ -28,7 +28,7 @@ WhenToTransferOutput = ON_EXIT
 Requirements = (MY.RequiresSharedFS=!=true || TARGET.HasAFS_OSG) && (TARGET.OSG_major =!= undefined || TARGET.IS_GLIDEIN=?=true) && (TARGET.HasParrotCVMFS=?=true || (TARGET.CMS_CVMFS_Exists && TARGET.CMS_CVMFS_Revision >= 89991 )) && TARGET.HAS_CMS_HDFS
 request_memory       = 9000
 request_disk         = 2048000
-request_cpus         = 1
+request_cpus         = {4}
 Transfer_Input_Files = {2},{3}
 Output = {1}/out_$(Cluster)_$(Process).out
 Error = {1}/run_$(Cluster)_$(Process).err
@@ -36,7 +36,7 @@ Log = {1}/running_$(Cluster).log
 x509userproxy = /tmp/x509up_u23269
 Arguments=$(process)
 Queue {0}
-    '''.format(len(job_configs), log_dir, exe_dir, config_dir)
+    '''.format(len(job_configs), log_dir, exe_dir, config_dir, cpus)
     with open(config_name, 'w') as file:
         file.write(condorConfig)
 
@@ -77,6 +77,8 @@ tar xvzf ana_code.tar.gz \n'''.format(config_dir)
         bashScript = bashScriptSetup + config['command'] + '\n'
         bashScript += 'xrdcp *_output.root root://cmsxrootd.hep.wisc.edu:1094//store/user/{}/{}/{}/ \n'.format(
             pwd.getpwuid(os.getuid())[0], jobName, config['syst'])
+        bashScript += 'xrdcp *_timing.json root://cmsxrootd.hep.wisc.edu:1094//store/user/{}/{}/{}/ \n'.format(
+            pwd.getpwuid(os.getuid())[0], jobName, config['syst'])
         with open(bash_name, 'w') as file:
             file.write(bashScript)
         os.system('chmod +x {}'.format(bash_name))